@@ -18,6 +18,7 @@
  */
 
 #include "actionrest_p.h"
+#include "request_p.h"
 #include "context.h"
 #include "controller.h"
 #include "dispatcher.h"
@@ -48,90 +49,108 @@ bool ActionREST::dispatch(Context *c)
         return false;
     }
 
-    return d->dispatchRestMethod(c, c->request()->method());
+    return d->dispatchRestMethod(c);
 }
 
-bool ActionRESTPrivate::dispatchRestMethod(Context *c, const QString &httpMethod) const
+bool ActionREST::dispatcherReady(const Dispatcher *dispatch, Controller *controller)
 {
-    Q_Q(const ActionREST);
-    const QString &restMethod = q->name() % QLatin1Char('_') % httpMethod;
-
-    Controller *controller = c->controller();
-    Action *action = controller->actionFor(restMethod);
-    if (!action) {
-        // Look for non registered actions in this controller
-        ActionList actions = controller->actions();
-        Q_FOREACH (Action *controllerAction, actions) {
-            if (controllerAction->name() == restMethod) {
-                action = controllerAction;
-                break;
-            }
-        }
+    Q_D(ActionREST);
+
+    d->setupMethods(controller);
+
+    return Action::dispatcherReady(dispatch, controller);
+}
+
+bool ActionRESTPrivate::dispatchRestMethod(Context *c) const
+{
+    Request *request = c->request();
+    Request::HttpMethod httpMethod = request->httpMethod();
+
+    Action *action;
+    if (httpMethod == Request::Other) {
+        action = otherMethods.value(request->method());
+    } else {
+        // HEAD already falls back to GET here
+        action = methods[httpMethod];
     }
 
     if (action) {
         return c->execute(action);
     }
 
-    bool ret = false;
-    if (httpMethod == "OPTIONS") {
-        ret = returnOptions(c, q->name());
-    } else if (httpMethod == "HEAD") {
-        // redispatch to GET
-        ret = dispatchRestMethod(c, QStringLiteral("GET"));
-    } else if (httpMethod != "not_implemented") {
+    if (httpMethod == Request::Options) {
+        return returnOptions(c);
+    } else if (notImplemented) {
         // try dispatching to foo_not_implemented
-        ret = dispatchRestMethod(c, QStringLiteral("not_implemented"));
-    } else {
-        // not_implemented
-        ret = returnNotImplemented(c, q->name());
+        return c->execute(notImplemented);
     }
 
-    return ret;
+    return returnNotImplemented(c);
 }
 
-bool ActionRESTPrivate::returnOptions(Context *c, const QString &methodName) const
+bool ActionRESTPrivate::returnOptions(Context *c) const
 {
     Response *response = c->response();
     response->setContentType(QStringLiteral("text/plain"));
     response->setStatus(Response::OK); // 200
-    response->headers().insert(QStringLiteral("Allow"),
-                               getAllowedMethods(c->controller(), methodName));
+    response->headers().insert(QStringLiteral("Allow"), allowedMethods);
     response->body().clear();
     return true;
 }
 
-bool ActionRESTPrivate::returnNotImplemented(Context *c, const QString &methodName) const
+bool ActionRESTPrivate::returnNotImplemented(Context *c) const
 {
+    Q_Q(const ActionREST);
+
     Response *response = c->response();
     response->setContentType(QStringLiteral("text/plain"));
     response->setStatus(Response::MethodNotAllowed); // 405
-    response->headers().insert(QStringLiteral("Allow"),
-                               getAllowedMethods(c->controller(), methodName));
+    response->headers().insert(QStringLiteral("Allow"), allowedMethods);
     response->body() = "Method " + c->req()->method().toLatin1() + " not implemented for "
-            + c->uriFor(methodName).toString().toLatin1();
+            + c->uriFor(q->name()).toString().toLatin1();
     return true;
 }
 
-QString Cutelyst::ActionRESTPrivate::getAllowedMethods(Controller *controller, const QString &methodName) const
+void ActionRESTPrivate::setupMethods(Controller *controller)
 {
-    QStringList methods;
-    QString name = methodName % QLatin1Char('_');
-    ActionList actions = controller->actions();
+    Q_Q(const ActionREST);
+
+    // Scan the controller only once, dispatching
+    // becomes a lookup on the method table
+    QStringList allowed;
+    const QString name = q->name() % QLatin1Char('_');
+    const ActionList &actions = controller->actions();
     Q_FOREACH (Action *action, actions) {
-        const QString &method = action->name();
-        if (method.startsWith(name)) {
-            methods.append(method.mid(name.size()));
+        const QString &actionName = action->name();
+        if (!actionName.startsWith(name)) {
+            continue;
         }
+
+        const QString &method = actionName.mid(name.size());
+        if (method == QLatin1String("not_implemented")) {
+            notImplemented = action;
+            continue;
+        }
+
+        Request::HttpMethod httpMethod = RequestPrivate::parseHttpMethod(method);
+        if (httpMethod == Request::Other) {
+            otherMethods.insert(method, action);
+        } else {
+            methods[httpMethod] = action;
+        }
+        allowed.append(method);
     }
 
-    if (methods.contains(QStringLiteral("GET"))) {
-        methods.append(QStringLiteral("HEAD"));
+    if (methods[Request::Get]) {
+        if (!methods[Request::Head]) {
+            // redispatch HEAD to GET
+            methods[Request::Head] = methods[Request::Get];
+        }
+        allowed.append(QStringLiteral("HEAD"));
     }
 
-    methods.removeAll(QStringLiteral("not_implemented"));
-    methods.sort();
-    methods.removeDuplicates();
+    allowed.sort();
+    allowed.removeDuplicates();
 
-    return methods.join(QStringLiteral(", ")).toLatin1();
+    allowedMethods = allowed.join(QStringLiteral(", "));
 }
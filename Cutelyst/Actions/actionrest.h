@@ -37,6 +37,12 @@ protected:
     ActionRESTPrivate *d_ptr;
 
     bool dispatch(Context *c) Q_DECL_FINAL;
+
+    /**
+     * Builds the method dispatch table and the
+     * Allow header value for this action
+     */
+    virtual bool dispatcherReady(const Dispatcher *dispatch, Controller *controller) Q_DECL_OVERRIDE;
 };
 
 }
@@ -22,18 +22,28 @@
 
 #include "actionrest.h"
 
+#include <Cutelyst/request.h>
+
+#include <QtCore/QHash>
+
 namespace Cutelyst {
 
 class ActionRESTPrivate
 {
     Q_DECLARE_PUBLIC(ActionREST)
 public:
-    bool dispatchRestMethod(Context *c, const QString &restMethod) const;
-    bool returnOptions(Context *c, const QString &methodName) const;
-    bool returnNotImplemented(Context *c, const QString &methodName) const;
-    QString getAllowedMethods(Controller *controller, const QString &methodName) const;
+    bool dispatchRestMethod(Context *c) const;
+    bool returnOptions(Context *c) const;
+    bool returnNotImplemented(Context *c) const;
+    void setupMethods(Controller *controller);
 
     ActionREST *q_ptr;
+    // Indexed by Request::HttpMethod, Request::Other is never set
+    Action *methods[Request::Connect + 1] = {};
+    // Methods that are not in Request::HttpMethod
+    QHash<QString, Action *> otherMethods;
+    Action *notImplemented = 0;
+    QString allowedMethods;
 };
 
 }
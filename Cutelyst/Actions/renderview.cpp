@@ -66,7 +66,7 @@ bool RenderView::doExecute(Cutelyst::Context *c)
         res->setContentType(QStringLiteral("text/html; charset=utf-8"));
     }
 
-    if (c->req()->method() == QStringLiteral("HEAD")) {
+    if (c->req()->httpMethod() == Request::Head) {
         return true;
     }
 
@@ -26,9 +26,24 @@
 #include <Cutelyst/Dispatcher>
 
 #include <QMap>
+#include <QHash>
+#include <QReadWriteLock>
 
 using namespace Cutelyst;
 
+#define ROLEACL_USER_ROLES "__roleacl_user_roles" // in authentication.cpp
+
+// Role names interned to bit positions, written on init() which
+// each engine thread runs for its own Application while others
+// might already be serving requests
+struct RoleACLRoleIds
+{
+    QReadWriteLock lock;
+    QHash<QString, int> ids;
+};
+
+Q_GLOBAL_STATIC(RoleACLRoleIds, s_roleIds)
+
 RoleACL::RoleACL() :
     d_ptr(new RoleACLPrivate)
 {
@@ -59,14 +74,19 @@ bool RoleACL::init(Cutelyst::Application *application, const QVariantHash &args)
                     << "requires at least one RequiresRole or AllowedRole attribute";
         return false;
     } else {
-        QStringList required = attributes.values("RequiresRole");
+        const QStringList &required = attributes.values("RequiresRole");
         Q_FOREACH (const QString &role, required) {
-            d->requiresRole.append(role);
+            int id = RoleACLPrivate::roleId(role);
+            d->requiresRole.resize(qMax(d->requiresRole.size(), id + 1));
+            d->requiresRole.setBit(id);
         }
+        d->requiresRoleCount = d->requiresRole.count(true);
 
-        QStringList allowed = attributes.values("AllowedRole");
+        const QStringList &allowed = attributes.values("AllowedRole");
         Q_FOREACH (const QString &role, allowed) {
-            d->allowedRole.append(role);
+            int id = RoleACLPrivate::roleId(role);
+            d->allowedRole.resize(qMax(d->allowedRole.size(), id + 1));
+            d->allowedRole.setBit(id);
         }
     }
 
@@ -98,43 +118,22 @@ bool RoleACL::canVisit(Context *c) const
 {
     Q_D(const RoleACL);
 
-    Authentication *auth = c->plugin<Authentication*>();
-    if (auth) {
-        QStringList user_has = auth->user(c).values(QStringLiteral("roles"));
-
-        QStringList required = d->requiresRole;
-        QStringList allowed = d->allowedRole;
-
-        if (!required.isEmpty() && !allowed.isEmpty()) {
-            Q_FOREACH (const QString &role, required) {
-                if (!user_has.contains(role)) {
-                    return false;
-                }
-            }
-            Q_FOREACH (const QString &role, allowed) {
-                if (user_has.contains(role)) {
-                    return true;
-                }
-            }
-            return false;
-        }  else if (!required.isEmpty()) {
-            Q_FOREACH (const QString &role, required) {
-                if (!user_has.contains(role)) {
-                    return false;
-                }
-            }
-            return true;
-        } else if (!allowed.isEmpty()) {
-            Q_FOREACH (const QString &role, allowed) {
-                if (user_has.contains(role)) {
-                    return true;
-                }
-            }
+    const QBitArray &userHas = RoleACLPrivate::userRoles(c);
+    if (userHas.isNull()) {
+        return false;
+    }
+
+    if (d->requiresRoleCount) {
+        if ((userHas & d->requiresRole).count(true) != d->requiresRoleCount) {
             return false;
         }
     }
 
-    return false;
+    if (!d->allowedRole.isEmpty()) {
+        return (userHas & d->allowedRole).count(true) != 0;
+    }
+
+    return d->requiresRoleCount != 0;
 }
 
 bool RoleACL::dispatcherReady(const Dispatcher *dispatcher, Cutelyst::Controller *controller)
@@ -154,3 +153,58 @@ bool RoleACL::dispatcherReady(const Dispatcher *dispatcher, Cutelyst::Controller
 
     return true;
 }
+
+int RoleACLPrivate::roleId(const QString &role)
+{
+    RoleACLRoleIds *roleIds = s_roleIds();
+    {
+        QReadLocker locker(&roleIds->lock);
+        QHash<QString, int>::ConstIterator it = roleIds->ids.constFind(role);
+        if (it != roleIds->ids.constEnd()) {
+            return it.value();
+        }
+    }
+
+    QWriteLocker locker(&roleIds->lock);
+    // Another thread might have interned it meanwhile
+    QHash<QString, int>::ConstIterator it = roleIds->ids.constFind(role);
+    if (it != roleIds->ids.constEnd()) {
+        return it.value();
+    }
+
+    int id = roleIds->ids.size();
+    roleIds->ids.insert(role, id);
+    return id;
+}
+
+QBitArray RoleACLPrivate::userRoles(Context *c)
+{
+    // Several ACL'd actions can be visited in the same request
+    // so the user roles are only converted once
+    const QVariant &cached = c->property(ROLEACL_USER_ROLES);
+    if (!cached.isNull()) {
+        return cached.toBitArray();
+    }
+
+    Authentication *auth = c->plugin<Authentication*>();
+    if (!auth) {
+        return QBitArray();
+    }
+
+    // Roles no action refers to are not interned and can be ignored
+    const QStringList &roles = auth->user(c).values(QStringLiteral("roles"));
+
+    RoleACLRoleIds *roleIds = s_roleIds();
+    QReadLocker locker(&roleIds->lock);
+    QBitArray ret(roleIds->ids.size());
+    Q_FOREACH (const QString &role, roles) {
+        QHash<QString, int>::ConstIterator it = roleIds->ids.constFind(role);
+        if (it != roleIds->ids.constEnd()) {
+            ret.setBit(it.value());
+        }
+    }
+    locker.unlock();
+
+    c->setProperty(ROLEACL_USER_ROLES, ret);
+    return ret;
+}
@@ -22,13 +22,19 @@
 
 #include "roleacl.h"
 
+#include <QtCore/QBitArray>
+
 namespace Cutelyst {
 
 class RoleACLPrivate
 {
 public:
-    QStringList requiresRole;
-    QStringList allowedRole;
+    static int roleId(const QString &role);
+    static QBitArray userRoles(Context *c);
+
+    QBitArray requiresRole;
+    QBitArray allowedRole;
+    int requiresRoleCount = 0;
     QString aclDetachTo;
     QString actionReverse;
     Action *detachTo;
@@ -22,10 +22,13 @@
 #include "context.h"
 #include "action.h"
 #include "response.h"
+#include "segmentedbuffer.h"
 
 #include <QString>
 #include <QStringBuilder>
 #include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
 #include <QtCore/QLoggingCategory>
 
 Q_LOGGING_CATEGORY(CUTELYST_CLEARSILVER, "cutelyst.clearsilver")
@@ -85,7 +88,15 @@ NEOERR* cutelyst_render(void *user, char *data)
     if (body) {
         body->append(data);
     }
-//    qDebug() << "_render" << body << data;
+    return 0;
+}
+
+NEOERR* cutelyst_render_buffer(void *user, char *data)
+{
+    SegmentedBuffer *body = static_cast<SegmentedBuffer*>(user);
+    if (body) {
+        body->append(data, qstrlen(data));
+    }
     return 0;
 }
 
@@ -107,35 +118,71 @@ bool ClearSilver::render(Context *c)
     }
 
     qCDebug(CUTELYST_CLEARSILVER) << "Rendering template" <<templateFile;
-    QByteArray output;
-    if (!d->render(c, templateFile, stash, output)) {
-        return false;
-    }
 
+    // Context properties are only serialized if a template uses them,
+    // templates not parsed yet are assumed to use them
+    ClearSilverTemplate *tmpl = d->cachedTemplate(templateFile);
+    ClearSilverTemplate *wrapper = 0;
+    bool withContext = !tmpl || tmpl->usesContext;
     if (!d->wrapper.isEmpty()) {
-        QString wrapperFile = d->wrapper;
+        wrapper = d->cachedTemplate(d->wrapper);
+        withContext |= !wrapper || wrapper->usesContext;
+    }
 
-        QVariantHash data = stash;
-        data.insert(QStringLiteral("content"), output);
+    // The same HDF is used by the template and the wrapper
+    HDF *hdf = d->hdfForStash(c, stash, withContext);
 
-        if (!d->render(c, wrapperFile, data, output)) {
-            return false;
+    bool ok = false;
+    if (!tmpl) {
+        tmpl = d->parse(c, templateFile, hdf);
+    }
+
+    if (tmpl) {
+        Response *res = c->response();
+        if (d->wrapper.isEmpty()) {
+            SegmentedBuffer *body = res->bodyBuffer();
+            body->clear();
+            ok = d->render(c, tmpl, hdf, body, cutelyst_render_buffer);
+        } else {
+            QByteArray content;
+            if (d->render(c, tmpl, hdf, &content, cutelyst_render)) {
+                hdf_set_value(hdf, "content", content.constData());
+
+                if (!wrapper) {
+                    wrapper = d->parse(c, d->wrapper, hdf);
+                }
+
+                if (wrapper) {
+                    SegmentedBuffer *body = res->bodyBuffer();
+                    body->clear();
+                    ok = d->render(c, wrapper, hdf, body, cutelyst_render_buffer);
+                }
+            }
         }
     }
 
-    c->res()->body() = output;
-    return true;
+    d->releaseTemplate(tmpl);
+    d->releaseTemplate(wrapper);
+    hdf_destroy(&hdf);
+
+    if (!d->cache) {
+        d->clearTemplates();
+    }
+
+    return ok;
 }
 
 NEOERR* findFile(void *c, HDF *hdf, const char *filename, char **contents)
 {
+    Q_UNUSED(hdf)
+
     ClearSilverPrivate *priv = static_cast<ClearSilverPrivate*>(c);
     if (!priv) {
         return nerr_raise(NERR_NOMEM, "Cound not cast ClearSilverPrivate");
     }
 
     Q_FOREACH (const QString &includePath, priv->includePaths) {
-        QFile file(includePath % QLatin1Char('/') % filename);
+        QFile file(includePath % QLatin1Char('/') % QString::fromUtf8(filename));
 
         if (file.exists()) {
             if (!file.open(QFile::ReadOnly)) {
@@ -143,8 +190,25 @@ NEOERR* findFile(void *c, HDF *hdf, const char *filename, char **contents)
                 return nerr_raise(NERR_IO, "Cound not open file: %s", file.errorString().toLocal8Bit().data());
             }
 
-            *contents = qstrdup(file.readAll().data());
-            qCDebug(CUTELYST_CLEARSILVER) << "Rendering template:" << file.fileName();;
+            const QByteArray data = file.readAll();
+            if (priv->parsing) {
+                // Needed to tell if the parsed template is still current
+                priv->parsing->files.append(qMakePair(file.fileName(), QFileInfo(file).lastModified()));
+                const QString text = QString::fromUtf8(data);
+                if (!priv->parsing->usesContext) {
+                    static const QRegularExpression contextRE(QStringLiteral("\\bc\\.|<\\?cs\\s+linclude\\b"));
+                    priv->parsing->usesContext = contextRE.match(text).hasMatch();
+                }
+                if (priv->parsing->cacheable) {
+                    // Only includes of a quoted file name are the same on every request
+                    static const QRegularExpression includeRE(QStringLiteral("<\\?cs\\s+include\\s*[:!]\\s*(?!\"[^\"]*\"\\s*\\?>)"));
+                    priv->parsing->cacheable = !includeRE.match(text).hasMatch();
+                }
+            }
+
+            // ClearSilver releases it with free()
+            *contents = strdup(data.constData());
+            qCDebug(CUTELYST_CLEARSILVER) << "Loaded template:" << file.fileName();
             return 0;
         }
     }
@@ -153,70 +217,141 @@ NEOERR* findFile(void *c, HDF *hdf, const char *filename, char **contents)
     return nerr_raise(NERR_NOT_FOUND, "Cound not find file: %s", filename);
 }
 
-bool ClearSilverPrivate::render(Context *c, const QString &filename, const QVariantHash &stash, QByteArray &output)
+ClearSilverPrivate::~ClearSilverPrivate()
+{
+    clearTemplates();
+}
+
+ClearSilverTemplate *ClearSilverPrivate::cachedTemplate(const QString &filename)
+{
+    ClearSilverTemplate *tmpl = templates.value(filename);
+    if (!tmpl) {
+        return 0;
+    }
+
+    // Only the modification times are checked, files are not read
+    typedef QPair<QString, QDateTime> FileTime;
+    Q_FOREACH (const FileTime &file, tmpl->files) {
+        if (QFileInfo(file.first).lastModified() != file.second) {
+            qCDebug(CUTELYST_CLEARSILVER) << "Template changed:" << file.first;
+            templates.remove(filename);
+            cs_destroy(&tmpl->cs);
+            delete tmpl;
+            return 0;
+        }
+    }
+    return tmpl;
+}
+
+ClearSilverTemplate *ClearSilverPrivate::parse(Context *c, const QString &filename, HDF *hdf)
 {
-    HDF *hdf = hdfForStash(c, stash);
-    CSPARSE *cs;
+    ClearSilverTemplate *tmpl = new ClearSilverTemplate;
     NEOERR *error;
 
-    error = cs_init(&cs, hdf);
+    error = cs_init(&tmpl->cs, hdf);
     if (error) {
-        STRING *msg = new STRING;
-        string_init(msg);
-        nerr_error_traceback(error, msg);
+        STRING msg;
+        string_init(&msg);
+        nerr_error_traceback(error, &msg);
         QString errorMsg;
-        errorMsg = QString::fromLatin1("Failed to init ClearSilver:\n%1").arg(msg->buf);
+        errorMsg = QString::fromLatin1("Failed to init ClearSilver:\n%1").arg(QString::fromUtf8(msg.buf));
         renderError(c, errorMsg);
 
-        hdf_destroy(&hdf);
+        string_clear(&msg);
         nerr_ignore(&error);
-        return false;
+        delete tmpl;
+        return 0;
     }
 
-    cs_register_fileload(cs, this, findFile);
+    cs_register_fileload(tmpl->cs, this, findFile);
 
-    error = cs_parse_file(cs, filename.toLocal8Bit().data());
+    // Includes are resolved against the HDF of
+    // the request that parses the template
+    parsing = tmpl;
+    error = cs_parse_file(tmpl->cs, filename.toUtf8().data());
+    parsing = 0;
     if (error) {
-        STRING *msg = new STRING;
-        string_init(msg);
-        nerr_error_traceback(error, msg);
+        STRING msg;
+        string_init(&msg);
+        nerr_error_traceback(error, &msg);
         QString errorMsg;
-        errorMsg = QString::fromLatin1("Failed to parse template file: %1\n%2").arg(filename, msg->buf);
+        errorMsg = QString::fromLatin1("Failed to parse template file: %1\n%2").arg(filename, QString::fromUtf8(msg.buf));
         renderError(c, errorMsg);
 
+        string_clear(&msg);
         nerr_log_error(error);
-        hdf_destroy(&hdf);
         nerr_ignore(&error);
-        return false;
+        cs_destroy(&tmpl->cs);
+        delete tmpl;
+        return 0;
     }
 
-    cs_render(cs, &output, cutelyst_render);
+    if (tmpl->cacheable) {
+        templates.insert(filename, tmpl);
+    } else {
+        qCDebug(CUTELYST_CLEARSILVER) << "Not caching template with a variable include:" << filename;
+    }
+    return tmpl;
+}
 
-    cs_destroy(&cs);
-    hdf_destroy(&hdf);
+bool ClearSilverPrivate::render(Context *c, ClearSilverTemplate *tmpl, HDF *hdf, void *output, CSOUTFUNC cb) const
+{
+    // The parse tree doesn't depend on the data
+    tmpl->cs->hdf = hdf;
+
+    NEOERR *error = cs_render(tmpl->cs, output, cb);
+    if (error) {
+        STRING msg;
+        string_init(&msg);
+        nerr_error_traceback(error, &msg);
+        renderError(c, QString::fromLatin1("Failed to render template:\n%1").arg(QString::fromUtf8(msg.buf)));
 
+        string_clear(&msg);
+        nerr_ignore(&error);
+        return false;
+    }
     return true;
 }
 
+void ClearSilverPrivate::releaseTemplate(ClearSilverTemplate *tmpl)
+{
+    // Cached templates are released by clearTemplates()
+    if (tmpl && !tmpl->cacheable) {
+        cs_destroy(&tmpl->cs);
+        delete tmpl;
+    }
+}
+
+void ClearSilverPrivate::clearTemplates()
+{
+    Q_FOREACH (ClearSilverTemplate *tmpl, templates) {
+        cs_destroy(&tmpl->cs);
+        delete tmpl;
+    }
+    templates.clear();
+}
+
 void ClearSilverPrivate::renderError(Context *c, const QString &error) const
 {
     qCCritical(CUTELYST_CLEARSILVER) << error;
     c->res()->body() = error.toUtf8();
 }
 
-HDF *ClearSilverPrivate::hdfForStash(Context *c, const QVariantHash &stash) const
+HDF *ClearSilverPrivate::hdfForStash(Context *c, const QVariantHash &stash, bool withContext) const
 {
     HDF *hdf = 0;
     hdf_init(&hdf);
 
     serializeHash(hdf, stash);
 
-    const QMetaObject *meta = c->metaObject();
-    for (int i = 0; i < meta->propertyCount(); ++i) {
-        QMetaProperty prop = meta->property(i);
-        QString name = QLatin1String("c.") % prop.name();
-        QVariant value = prop.read(c);
-        serializeVariant(hdf, value, name);
+    if (withContext) {
+        const QMetaObject *meta = c->metaObject();
+        for (int i = 0; i < meta->propertyCount(); ++i) {
+            QMetaProperty prop = meta->property(i);
+            QString name = QLatin1String("c.") % prop.name();
+            QVariant value = prop.read(c);
+            serializeVariant(hdf, value, name);
+        }
     }
     return hdf;
 }
@@ -251,14 +386,15 @@ void ClearSilverPrivate::serializeMap(HDF *hdf, const QVariantMap &map, const QS
 
 void ClearSilverPrivate::serializeVariant(HDF *hdf, const QVariant &value, const QString &key) const
 {
-//    qDebug() << key;
-
     switch (value.type()) {
     case QMetaType::QString:
-        hdf_set_value(hdf, key.toLocal8Bit().data(), value.toString().toLocal8Bit().data());
+        hdf_set_value(hdf, key.toUtf8().constData(), value.toString().toUtf8().constData());
+        break;
+    case QMetaType::QByteArray:
+        hdf_set_value(hdf, key.toUtf8().constData(), value.toByteArray().constData());
         break;
     case QMetaType::Int:
-        hdf_set_int_value(hdf, key.toLocal8Bit().data(), value.toInt());
+        hdf_set_int_value(hdf, key.toUtf8().constData(), value.toInt());
         break;
     case QMetaType::QVariantHash:
         serializeHash(hdf, value.toHash(), key);
@@ -268,19 +404,23 @@ void ClearSilverPrivate::serializeVariant(HDF *hdf, const QVariant &value, const
         break;
     default:
         if (value.canConvert(QMetaType::QString)) {
-            hdf_set_value(hdf, key.toLocal8Bit().data(), value.toString().toLocal8Bit().data());
+            hdf_set_value(hdf, key.toUtf8().constData(), value.toString().toUtf8().constData());
         }
         break;
     }
 }
 
-
 bool Cutelyst::ClearSilver::isCaching() const
 {
-    return false;
+    Q_D(const ClearSilver);
+    return d->cache;
 }
 
 void ClearSilver::setCache(bool enable)
 {
-    Q_UNUSED(enable)
+    Q_D(ClearSilver);
+    d->cache = enable;
+    if (!enable) {
+        d->clearTemplates();
+    }
 }
@@ -24,21 +24,57 @@
 
 #include <ClearSilver/ClearSilver.h>
 
+#include <QtCore/QDateTime>
+#include <QtCore/QHash>
+#include <QtCore/QStringList>
+
 namespace Cutelyst {
 
+/**
+ * A parsed template, rendered again by pointing it to
+ * the HDF of each request.
+ *
+ * Parsed templates are kept per view, and thus per thread,
+ * since ClearSilver keeps the render state in the CSPARSE.
+ */
+struct ClearSilverTemplate
+{
+    CSPARSE *cs = 0;
+    // Every file read while parsing and its modification time
+    QList<QPair<QString, QDateTime> > files;
+    // Whether any of the files mentions the c. variables,
+    // or has a linclude, which is only loaded when rendering
+    bool usesContext = false;
+    // False if an include depends on the HDF, as it's
+    // resolved when parsing, the template is then parsed
+    // again on every render
+    bool cacheable = true;
+};
+
 class ClearSilverPrivate
 {
 public:
-    HDF *hdfForStash(Context *c, const QVariantHash &stash) const;
+    ~ClearSilverPrivate();
+
+    ClearSilverTemplate *cachedTemplate(const QString &filename);
+    ClearSilverTemplate *parse(Context *c, const QString &filename, HDF *hdf);
+    bool render(Context *c, ClearSilverTemplate *tmpl, HDF *hdf, void *output, CSOUTFUNC cb) const;
+    void clearTemplates();
+    void releaseTemplate(ClearSilverTemplate *tmpl);
+
+    HDF *hdfForStash(Context *c, const QVariantHash &stash, bool withContext) const;
     void serializeHash(HDF *hdf, const QVariantHash &hash, const QString &prefix = QString()) const;
     void serializeMap(HDF *hdf, const QVariantMap &map, const QString &prefix = QString()) const;
     void serializeVariant(HDF *hdf, const QVariant &value, const QString &key) const;
-    bool render(Context *c, const QString &filename, const QVariantHash &stash, QByteArray &output);
     void renderError(Context *c, const QString &error) const;
 
     QStringList includePaths;
     QString extension;
     QString wrapper;
+    QHash<QString, ClearSilverTemplate *> templates;
+    // Receives the files read by findFile() while parsing
+    ClearSilverTemplate *parsing = 0;
+    bool cache = false;
 };
 
 }
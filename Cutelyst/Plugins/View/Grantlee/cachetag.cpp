@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "cachetag.h"
+#include "expirycache_p.h"
+
+#include <grantlee/exception.h>
+#include <grantlee/parser.h>
+#include <grantlee/util.h>
+
+#include <QtCore/QDateTime>
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QTextStream>
+
+using namespace Cutelyst;
+
+#define CACHETAG_MAX_FRAGMENTS 4096
+
+struct CacheFragment
+{
+    QString content;
+    qint64 expires;
+};
+
+// Shared by the Grantlee engines of every thread
+struct CacheTagStore
+{
+    CacheTagStore() : fragments(CACHETAG_MAX_FRAGMENTS) {}
+
+    QReadWriteLock lock;
+    ExpiryCache<QString, CacheFragment> fragments;
+};
+
+Q_GLOBAL_STATIC(CacheTagStore, s_store)
+
+Grantlee::Node *CacheNodeFactory::getNode(const QString &tagContent, Grantlee::Parser *p) const
+{
+    const QStringList expr = smartSplit(tagContent);
+    if (expr.size() < 3) {
+        throw Grantlee::Exception(Grantlee::TagSyntaxError,
+                                  QStringLiteral("cache tag requires at least a key and a ttl"));
+    }
+
+    QList<Grantlee::FilterExpression> vary;
+    for (int i = 3; i < expr.size(); ++i) {
+        vary.append(Grantlee::FilterExpression(expr.at(i), p));
+    }
+
+    CacheNode *n = new CacheNode(Grantlee::FilterExpression(expr.at(1), p),
+                                 Grantlee::FilterExpression(expr.at(2), p),
+                                 vary,
+                                 p);
+
+    const Grantlee::NodeList list = p->parse(n, QStringLiteral("endcache"));
+    n->setNodeList(list);
+    p->removeNextToken();
+
+    return n;
+}
+
+CacheNode::CacheNode(const Grantlee::FilterExpression &key,
+                     const Grantlee::FilterExpression &ttl,
+                     const QList<Grantlee::FilterExpression> &vary,
+                     QObject *parent) : Grantlee::Node(parent)
+  , m_key(key)
+  , m_ttl(ttl)
+  , m_vary(vary)
+{
+
+}
+
+void CacheNode::setNodeList(const Grantlee::NodeList &list)
+{
+    m_list = list;
+}
+
+void CacheNode::render(Grantlee::OutputStream *stream, Grantlee::Context *c) const
+{
+    const int ttl = m_ttl.resolve(c).toInt();
+    if (ttl <= 0) {
+        m_list.render(stream, c);
+        return;
+    }
+
+    QString key = Grantlee::getSafeString(m_key.resolve(c)).get();
+    Q_FOREACH (const Grantlee::FilterExpression &vary, m_vary) {
+        key.append(QLatin1Char('\n') + Grantlee::getSafeString(vary.resolve(c)).get());
+    }
+
+    CacheTagStore *store = s_store();
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    {
+        QReadLocker locker(&store->lock);
+        const CacheFragment *cached = store->fragments.value(key);
+        if (cached && cached->expires > now) {
+            // Already escaped when it was rendered
+            (*stream) << cached->content;
+            return;
+        }
+    }
+
+    CacheFragment fragment;
+    QTextStream textStream(&fragment.content);
+    QSharedPointer<Grantlee::OutputStream> temp = stream->clone(&textStream);
+    m_list.render(temp.data(), c);
+    textStream.flush();
+    fragment.expires = now + ttl * 1000LL;
+
+    (*stream) << fragment.content;
+
+    QWriteLocker locker(&store->lock);
+    store->fragments.insert(key, fragment, fragment.expires, now);
+}
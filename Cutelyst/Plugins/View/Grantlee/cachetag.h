@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CUTELYST_GRANTLEE_CACHETAG_H
+#define CUTELYST_GRANTLEE_CACHETAG_H
+
+#include <grantlee/node.h>
+#include <grantlee/filterexpression.h>
+
+namespace Cutelyst {
+
+class CacheNodeFactory : public Grantlee::AbstractNodeFactory
+{
+    Q_OBJECT
+public:
+    virtual Grantlee::Node *getNode(const QString &tagContent, Grantlee::Parser *p) const Q_DECL_OVERRIDE;
+};
+
+class CacheNode : public Grantlee::Node
+{
+    Q_OBJECT
+public:
+    CacheNode(const Grantlee::FilterExpression &key,
+              const Grantlee::FilterExpression &ttl,
+              const QList<Grantlee::FilterExpression> &vary,
+              QObject *parent = 0);
+
+    void setNodeList(const Grantlee::NodeList &list);
+
+    virtual void render(Grantlee::OutputStream *stream, Grantlee::Context *c) const Q_DECL_OVERRIDE;
+
+private:
+    Grantlee::FilterExpression m_key;
+    Grantlee::FilterExpression m_ttl;
+    QList<Grantlee::FilterExpression> m_vary;
+    Grantlee::NodeList m_list;
+};
+
+}
+
+#endif // CUTELYST_GRANTLEE_CACHETAG_H
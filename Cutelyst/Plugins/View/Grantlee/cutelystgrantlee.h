@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CUTELYST_GRANTLEE_H
+#define CUTELYST_GRANTLEE_H
+
+#include <grantlee/taglibraryinterface.h>
+
+namespace Cutelyst {
+
+/**
+ * Grantlee tag library loaded by GrantleeView as the
+ * "grantlee_cutelyst" default library, it provides:
+ *
+ * \b {% cache key ttl [vary ...] %}...{% endcache %} - Renders
+ * the content once and keeps the output for \p ttl seconds in a
+ * process wide cache, keyed by \p key and the optional vary
+ * expressions, e.g. {% cache "menu" 300 user.language %}
+ */
+class CutelystGrantlee : public QObject, public Grantlee::TagLibraryInterface
+{
+    Q_OBJECT
+    Q_INTERFACES(Grantlee::TagLibraryInterface)
+    Q_PLUGIN_METADATA(IID "org.grantlee.TagLibraryInterface")
+public:
+    explicit CutelystGrantlee(QObject *parent = 0);
+
+    virtual QHash<QString, Grantlee::AbstractNodeFactory *> nodeFactories(const QString &name = QString()) Q_DECL_OVERRIDE;
+};
+
+}
+
+#endif // CUTELYST_GRANTLEE_H
@@ -23,25 +23,50 @@
 #include "context.h"
 #include "action.h"
 #include "response.h"
+#include "segmentedbuffer.h"
 
 #include <QString>
 #include <QStringBuilder>
-#include <QDirIterator>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QReadWriteLock>
 #include <QtCore/QLoggingCategory>
 
 Q_LOGGING_CATEGORY(CUTELYST_GRANTLEE, "cutelyst.grantlee")
 
 using namespace Cutelyst;
 
+struct GrantleeSourceStore
+{
+    QReadWriteLock lock;
+    // Absolute file path to template source
+    QHash<QString, QString> sources;
+};
+
+Q_GLOBAL_STATIC(GrantleeSourceStore, s_sources)
+
+static Grantlee::Engine *createEngine(QObject *parent)
+{
+    Grantlee::Engine *engine = new Grantlee::Engine(parent);
+
+    // Provides the {% cache %} tag
+    engine->addPluginPath(QStringLiteral(CUTELYST_PLUGINS_DIR));
+    engine->addDefaultLibrary(QStringLiteral("grantlee_cutelyst"));
+
+    return engine;
+}
+
 GrantleeView::GrantleeView(QObject *parent) :
     ViewInterface(parent),
     d_ptr(new GrantleeViewPrivate)
 {
     Q_D(GrantleeView);
 
-    d->loader = QSharedPointer<Grantlee::FileSystemTemplateLoader>(new Grantlee::FileSystemTemplateLoader);
+    d->loader = QSharedPointer<GrantleeTemplateLoader>(new GrantleeTemplateLoader);
 
-    d->engine = new Grantlee::Engine(this);
+    d->engine = createEngine(this);
     d->engine->addTemplateLoader(d->loader);
 
     Application *app = qobject_cast<Application *>(parent);
@@ -109,8 +134,11 @@ void GrantleeView::setCache(bool enable)
     }
 
     delete d->engine;
-    d->engine = new Grantlee::Engine(this);
+    d->engine = createEngine(this);
 
+    // Templates are compiled when first used, reading
+    // the sources from the process wide store
+    d->loader->setShared(enable);
     if (enable) {
         d->cache = QSharedPointer<Grantlee::CachingLoaderDecorator>(new Grantlee::CachingLoaderDecorator(d->loader));
         d->engine->addTemplateLoader(d->cache);
@@ -118,23 +146,6 @@ void GrantleeView::setCache(bool enable)
         d->cache.clear();
         d->engine->addTemplateLoader(d->loader);
     }
-
-    Q_FOREACH (const QString &includePath, d->includePaths) {
-        QDirIterator it(includePath,
-                        QDir::Files | QDir::NoDotAndDotDot,
-                        QDirIterator::Subdirectories);
-        while (it.hasNext()) {
-            QString path = it.next();
-            path.remove(includePath);
-            if (path.startsWith(QLatin1Char('/'))) {
-                path.remove(0, 1);
-            }
-
-            if (d->cache->canLoadTemplate(path)) {
-                d->cache->loadByName(path, d->engine);
-            }
-        }
-    }
 }
 
 bool GrantleeView::isCaching() const
@@ -170,27 +181,122 @@ bool GrantleeView::render(Context *c)
     Grantlee::Context gc(stash);
 
     Grantlee::Template tmpl = d->engine->loadByName(templateFile);
-    QString content = tmpl->render(&gc);
-    if (tmpl->error() != Grantlee::NoError) {
-        qCCritical(CUTELYST_GRANTLEE) << "Error while rendering template" << tmpl->errorString();
-        c->res()->body() = tr("Internal server error.").toUtf8();
+
+    Response *res = c->response();
+    SegmentedBuffer *body = res->bodyBuffer();
+    body->clear();
+
+    bool ok = true;
+    {
+        // Encodes the output straight into the body segments
+        QTextStream textStream(body);
+        textStream.setCodec("UTF-8");
+        Grantlee::OutputStream output(&textStream);
+
+        if (d->wrapper.isEmpty()) {
+            tmpl->render(&output, &gc);
+            if (tmpl->error() != Grantlee::NoError) {
+                qCCritical(CUTELYST_GRANTLEE) << "Error while rendering template" << tmpl->errorString();
+                ok = false;
+            }
+        } else {
+            const QString content = tmpl->render(&gc);
+            if (tmpl->error() != Grantlee::NoError) {
+                qCCritical(CUTELYST_GRANTLEE) << "Error while rendering template" << tmpl->errorString();
+                ok = false;
+            } else {
+                Grantlee::Template wrapper = d->engine->loadByName(d->wrapper);
+                Grantlee::SafeString safeContent(content, true);
+                gc.insert(QStringLiteral("content"), safeContent);
+                wrapper->render(&output, &gc);
+
+                if (wrapper->error() != Grantlee::NoError) {
+                    qCCritical(CUTELYST_GRANTLEE) << "Error while rendering wrapper template" << wrapper->errorString();
+                    ok = false;
+                }
+            }
+        }
+
+        textStream.flush();
+    }
+
+    if (!ok) {
+        res->body() = tr("Internal server error.").toUtf8();
         return false;
     }
 
-    if (!d->wrapper.isEmpty()) {
-        Grantlee::Template wrapper = d->engine->loadByName(d->wrapper);
-        Grantlee::SafeString safeContent(content, true);
-        gc.insert(QStringLiteral("content"), safeContent);
-        content = wrapper->render(&gc);
+    return true;
+}
 
-        if (wrapper->error() != Grantlee::NoError) {
-            qCCritical(CUTELYST_GRANTLEE) << "Error while rendering wrapper template" << tmpl->errorString();
-            c->res()->body() = tr("Internal server error.").toUtf8();
-            return false;
+QStringList GrantleeTemplateLoader::templateDirs() const
+{
+    return m_templateDirs;
+}
+
+void GrantleeTemplateLoader::setTemplateDirs(const QStringList &dirs)
+{
+    m_templateDirs = dirs;
+}
+
+void GrantleeTemplateLoader::setShared(bool shared)
+{
+    m_shared = shared;
+}
+
+bool GrantleeTemplateLoader::canLoadTemplate(const QString &name) const
+{
+    return !findFile(name).isEmpty();
+}
+
+Grantlee::Template GrantleeTemplateLoader::loadByName(const QString &name, const Grantlee::Engine *engine) const
+{
+    const QString path = findFile(name);
+    if (path.isEmpty()) {
+        return Grantlee::Template();
+    }
+
+    GrantleeSourceStore *store = s_sources();
+    if (m_shared) {
+        QReadLocker locker(&store->lock);
+        QHash<QString, QString>::ConstIterator it = store->sources.constFind(path);
+        if (it != store->sources.constEnd()) {
+            return engine->newTemplate(it.value(), name);
         }
     }
 
-    c->res()->body() = content.toUtf8();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qCWarning(CUTELYST_GRANTLEE) << "Failed to open template" << path << file.errorString();
+        return Grantlee::Template();
+    }
+    const QString source = QString::fromUtf8(file.readAll());
+
+    if (m_shared) {
+        QWriteLocker locker(&store->lock);
+        store->sources.insert(path, source);
+    }
 
-    return true;
+    return engine->newTemplate(source, name);
+}
+
+QPair<QString, QString> GrantleeTemplateLoader::getMediaUri(const QString &fileName) const
+{
+    Q_FOREACH (const QString &templateDir, m_templateDirs) {
+        const QDir dir(templateDir);
+        if (dir.exists(fileName)) {
+            return qMakePair(dir.absolutePath() + QLatin1Char('/'), fileName);
+        }
+    }
+    return QPair<QString, QString>();
+}
+
+QString GrantleeTemplateLoader::findFile(const QString &name) const
+{
+    Q_FOREACH (const QString &templateDir, m_templateDirs) {
+        const QFileInfo info(QDir(templateDir), name);
+        if (info.isFile()) {
+            return info.absoluteFilePath();
+        }
+    }
+    return QString();
 }
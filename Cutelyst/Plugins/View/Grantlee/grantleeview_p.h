@@ -28,6 +28,40 @@
 
 namespace Cutelyst {
 
+/**
+ * Finds templates in the include paths like
+ * Grantlee::FileSystemTemplateLoader, but when shared the
+ * sources are read once per process and kept in a store
+ * used by the views of every thread.
+ *
+ * Compiled templates stay per Grantlee::Engine (and thus per
+ * thread), Grantlee nodes like cycle and ifchanged keep their
+ * state in the node and templates store the last error, so
+ * the same compiled template can't be rendered concurrently.
+ */
+class GrantleeTemplateLoader : public Grantlee::AbstractTemplateLoader
+{
+public:
+    QStringList templateDirs() const;
+    void setTemplateDirs(const QStringList &dirs);
+
+    /**
+     * Shared loaders never read a file again,
+     * used when the view caches the templates
+     */
+    void setShared(bool shared);
+
+    virtual bool canLoadTemplate(const QString &name) const Q_DECL_OVERRIDE;
+    virtual Grantlee::Template loadByName(const QString &name, const Grantlee::Engine *engine) const Q_DECL_OVERRIDE;
+    virtual QPair<QString, QString> getMediaUri(const QString &fileName) const Q_DECL_OVERRIDE;
+
+private:
+    QString findFile(const QString &name) const;
+
+    QStringList m_templateDirs;
+    bool m_shared = false;
+};
+
 class GrantleeViewPrivate
 {
 public:
@@ -36,7 +70,7 @@ public:
     QString wrapper;
     QString cutelystVar;
     Grantlee::Engine *engine;
-    QSharedPointer<Grantlee::FileSystemTemplateLoader> loader;
+    QSharedPointer<GrantleeTemplateLoader> loader;
     QSharedPointer<Grantlee::CachingLoaderDecorator> cache;
 };
 
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "precompiledview_p.h"
+
+#include "application.h"
+#include "context.h"
+#include "action.h"
+#include "response.h"
+#include "segmentedbuffer.h"
+#include "Plugins/precompiledtemplates.h"
+
+#include <QString>
+#include <QStringBuilder>
+#include <QDir>
+#include <QtCore/QLoggingCategory>
+
+Q_LOGGING_CATEGORY(CUTELYST_PRECOMPILED, "cutelyst.precompiled")
+
+using namespace Cutelyst;
+
+PrecompiledView::PrecompiledView(QObject *parent) :
+    ViewInterface(parent),
+    d_ptr(new PrecompiledViewPrivate)
+{
+    Q_D(PrecompiledView);
+
+    Application *app = qobject_cast<Application *>(parent);
+    if (app) {
+        setIncludePaths({ app->config("root").toString() });
+
+        // If CUTELYST_VAR is set the template might have become
+        // {{ Cutelyst.req.base }} instead of {{ c.req.base }}
+        d->cutelystVar = app->config("CUTELYST_VAR", QStringLiteral("c")).toString();
+    } else {
+        setIncludePaths({ QDir::currentPath() });
+        d->cutelystVar = QStringLiteral("c");
+    }
+}
+
+PrecompiledView::~PrecompiledView()
+{
+    delete d_ptr;
+}
+
+QStringList PrecompiledView::includePaths() const
+{
+    Q_D(const PrecompiledView);
+    return d->includePaths;
+}
+
+void PrecompiledView::setIncludePaths(const QStringList &paths)
+{
+    Q_D(PrecompiledView);
+    d->includePaths = paths;
+}
+
+QString PrecompiledView::templateExtension() const
+{
+    Q_D(const PrecompiledView);
+    return d->extension;
+}
+
+void PrecompiledView::setTemplateExtension(const QString &extension)
+{
+    Q_D(PrecompiledView);
+    d->extension = extension;
+}
+
+QString PrecompiledView::wrapper() const
+{
+    Q_D(const PrecompiledView);
+    return d->wrapper;
+}
+
+void PrecompiledView::setWrapper(const QString &name)
+{
+    Q_D(PrecompiledView);
+    d->wrapper = name;
+}
+
+bool PrecompiledView::isCaching() const
+{
+    return true;
+}
+
+void PrecompiledView::setCache(bool enable)
+{
+    Q_UNUSED(enable)
+}
+
+bool PrecompiledView::render(Context *c)
+{
+    Q_D(const PrecompiledView);
+
+    QVariantHash &stash = c->stash();
+    QString templateFile = stash.value(QStringLiteral("template")).toString();
+    if (templateFile.isEmpty()) {
+        if (c->action() && !c->action()->reverse().isEmpty()) {
+            templateFile = c->action()->reverse() % d->extension;
+            if (templateFile.startsWith(QLatin1Char('/'))) {
+                templateFile.remove(0, 1);
+            }
+        }
+
+        if (templateFile.isEmpty()) {
+            qCCritical(CUTELYST_PRECOMPILED) << "Cannot render template, template name or template stash key not defined";
+            return false;
+        }
+    }
+
+    qCDebug(CUTELYST_PRECOMPILED) << "Rendering template" << templateFile;
+
+    Response *res = c->response();
+
+    PrecompiledTemplates::RenderFunction tmpl = PrecompiledTemplates::find(templateFile);
+    if (!tmpl) {
+        qCCritical(CUTELYST_PRECOMPILED) << "Template not precompiled" << templateFile;
+        res->body() = tr("Internal server error.").toUtf8();
+        return false;
+    }
+
+    PrecompiledTemplates::RenderFunction wrapper = 0;
+    if (!d->wrapper.isEmpty()) {
+        wrapper = PrecompiledTemplates::find(d->wrapper);
+        if (!wrapper) {
+            qCCritical(CUTELYST_PRECOMPILED) << "Wrapper template not precompiled" << d->wrapper;
+            res->body() = tr("Internal server error.").toUtf8();
+            return false;
+        }
+    }
+
+    stash.insert(d->cutelystVar, QVariant::fromValue(c));
+
+    PrecompiledTemplates::Scope scope(stash);
+
+    SegmentedBuffer *body = res->bodyBuffer();
+    body->clear();
+
+    if (wrapper) {
+        SegmentedBuffer content;
+        tmpl(scope, &content);
+
+        scope.push(QStringLiteral("content"), QString::fromUtf8(content.toByteArray()), true);
+        wrapper(scope, body);
+        scope.pop();
+    } else {
+        tmpl(scope, body);
+    }
+
+    return true;
+}
@@ -36,6 +36,7 @@ char *Authentication::defaultRealm = const_cast<char *>("cutelyst_authentication
 #define AUTHENTICATION_USER "__authentication_user"
 #define SESSION_USER_REALM "__authentication_user_realm"
 #define SESSION_AUTHENTICATION_USER_REALM "__authentication_user_realm" // in realm.cpp
+#define ROLEACL_USER_ROLES "__roleacl_user_roles" // in roleacl.cpp
 
 Authentication::Authentication(Application *parent) : Plugin(parent)
   , d_ptr(new AuthenticationPrivate)
@@ -110,6 +111,9 @@ Cutelyst::AuthenticationUser Cutelyst::Authentication::user(Cutelyst::Context *c
 
 void Authentication::setUser(Context *c, const AuthenticationUser &user)
 {
+    // Invalidates the roles RoleACL cached for the previous user
+    c->setProperty(ROLEACL_USER_ROLES, QVariant());
+
     if (user.isNull()) {
         c->setProperty(AUTHENTICATION_USER, QVariant());
     } else {
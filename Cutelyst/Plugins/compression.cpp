@@ -0,0 +1,327 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "compression_p.h"
+#include "application.h"
+#include "request.h"
+#include "response.h"
+#include "context.h"
+#include "segmentedbuffer.h"
+
+#include <QBuffer>
+#include <QStringBuilder>
+#include <QLoggingCategory>
+
+#include <cstring>
+
+using namespace Cutelyst;
+
+Q_LOGGING_CATEGORY(C_COMPRESSION, "cutelyst.plugin.compression")
+
+Compression::Compression(Application *parent) : Plugin(parent)
+  , d_ptr(new CompressionPrivate)
+{
+
+}
+
+Compression::~Compression()
+{
+    delete d_ptr;
+}
+
+void Compression::setContentTypes(const QStringList &contentTypes)
+{
+    Q_D(Compression);
+    d->contentTypes.clear();
+    Q_FOREACH (const QString &contentType, contentTypes) {
+        d->contentTypes.append(contentType.toLower());
+    }
+}
+
+QStringList Compression::contentTypes() const
+{
+    Q_D(const Compression);
+    return d->contentTypes;
+}
+
+void Compression::setMinimumSize(qint64 size)
+{
+    Q_D(Compression);
+    d->minimumSize = size;
+}
+
+qint64 Compression::minimumSize() const
+{
+    Q_D(const Compression);
+    return d->minimumSize;
+}
+
+void Compression::setLevel(const QString &encoding, int level)
+{
+    Q_D(Compression);
+    level = qBound(1, level, 9);
+    if (encoding.compare(QLatin1String("gzip"), Qt::CaseInsensitive) == 0) {
+        d->gzipLevel = level;
+    } else if (encoding.compare(QLatin1String("deflate"), Qt::CaseInsensitive) == 0) {
+        d->deflateLevel = level;
+    } else {
+        qCWarning(C_COMPRESSION) << "Unsupported encoding" << encoding;
+    }
+}
+
+int Compression::level(const QString &encoding) const
+{
+    Q_D(const Compression);
+    if (encoding.compare(QLatin1String("gzip"), Qt::CaseInsensitive) == 0) {
+        return d->gzipLevel;
+    } else if (encoding.compare(QLatin1String("deflate"), Qt::CaseInsensitive) == 0) {
+        return d->deflateLevel;
+    }
+    return 0;
+}
+
+bool Compression::setup(Application *app)
+{
+    connect(app, &Application::beforeFinalizeHeaders,
+            this, &Compression::beforeFinalizeHeaders);
+    return true;
+}
+
+void Compression::beforeFinalizeHeaders(Context *c)
+{
+    Q_D(const Compression);
+
+    Response *res = c->response();
+    const quint16 status = res->status();
+    if (status < 200 || status == Response::NoContent || status == Response::NotModified) {
+        return;
+    }
+
+    // Already encoded by someone else
+    if (res->bodyEncoder() || !res->contentEncoding().isEmpty()) {
+        return;
+    }
+
+    if (!d->compressible(res->contentType())) {
+        return;
+    }
+
+    // The response depends on Accept-Encoding even when
+    // it's not compressed, otherwise a cache could serve
+    // a compressed response to a client that can't read it
+    Headers &headers = res->headers();
+    const QString vary = headers.header(QStringLiteral("Vary"));
+    if (vary.isEmpty()) {
+        headers.setHeader(QStringLiteral("Vary"), QStringLiteral("Accept-Encoding"));
+    } else if (vary != QLatin1String("*") && !vary.contains(QLatin1String("Accept-Encoding"), Qt::CaseInsensitive)) {
+        headers.setHeader(QStringLiteral("Vary"), vary % QLatin1String(", Accept-Encoding"));
+    }
+
+    QIODevice *body = res->bodyDevice();
+    if (body && body->size() < d->minimumSize) {
+        return;
+    }
+
+    const CompressionPrivate::Encoding encoding = d->negotiate(c->request()->header(QStringLiteral("Accept-Encoding")));
+    if (encoding == CompressionPrivate::Identity) {
+        return;
+    }
+
+    const bool gzip = encoding == CompressionPrivate::Gzip;
+    ZlibEncoder *encoder = new ZlibEncoder(gzip, gzip ? d->gzipLevel : d->deflateLevel);
+    if (!encoder->isValid()) {
+        qCWarning(C_COMPRESSION) << "Failed to initialize zlib";
+        delete encoder;
+        return;
+    }
+
+    QBuffer *buffer = qobject_cast<QBuffer *>(body);
+    SegmentedBuffer *segmented = qobject_cast<SegmentedBuffer *>(body);
+    if (buffer || segmented) {
+        // Bodies in memory are compressed at once and keep a Content-Length
+        QByteArray output;
+        output.reserve(int(body->size() / 4));
+        bool ok = true;
+        if (buffer) {
+            ok = encoder->append(buffer->buffer().constData(), buffer->buffer().size(), output);
+        } else {
+            // A single deflate stream across the segments
+            for (int i = 0; ok && i < segmented->segmentCount(); ++i) {
+                ok = encoder->append(segmented->segmentData(i), segmented->segmentSize(i), output);
+            }
+        }
+        ok = ok && encoder->finish(output);
+        delete encoder;
+
+        if (!ok) {
+            qCWarning(C_COMPRESSION) << "Failed to compress body";
+            return;
+        }
+
+        if (output.size() >= body->size()) {
+            qCDebug(C_COMPRESSION) << "Compressed body is not smaller, sending it as is";
+            return;
+        }
+
+        SegmentedBuffer *compressed = new SegmentedBuffer;
+        compressed->append(output);
+        res->setBody(compressed);
+        res->setContentLength(output.size());
+    } else {
+        // Other devices and Response::write() are compressed
+        // as they are written, which needs chunked encoding
+        if (c->request()->protocol() != QLatin1String("HTTP/1.1")) {
+            delete encoder;
+            return;
+        }
+        res->setBodyEncoder(encoder);
+    }
+
+    res->setContentEncoding(gzip ? QStringLiteral("gzip") : QStringLiteral("deflate"));
+
+    // A strong ETag of the uncompressed body no longer
+    // identifies the bytes sent
+    const QString etag = headers.header(QStringLiteral("ETag"));
+    if (!etag.isEmpty() && !etag.startsWith(QLatin1String("W/"))) {
+        headers.setHeader(QStringLiteral("ETag"), QLatin1String("W/") % etag);
+    }
+}
+
+CompressionPrivate::Encoding CompressionPrivate::negotiate(const QString &acceptEncoding) const
+{
+    if (acceptEncoding.isEmpty()) {
+        return Identity;
+    }
+
+    // Accept-Encoding: gzip;q=1.0, deflate;q=0.5, *;q=0 (RFC 7231 section 5.3.4)
+    double gzipQ = -1;
+    double deflateQ = -1;
+    double anyQ = -1;
+    Q_FOREACH (const QStringRef &part, acceptEncoding.splitRef(QLatin1Char(','))) {
+        const QVector<QStringRef> params = part.split(QLatin1Char(';'));
+        const QStringRef coding = params.first().trimmed();
+
+        double q = 1;
+        for (int i = 1; i < params.size(); ++i) {
+            const QStringRef param = params.at(i).trimmed();
+            if (param.startsWith(QLatin1String("q="), Qt::CaseInsensitive)) {
+                bool ok;
+                q = param.mid(2).toDouble(&ok);
+                if (!ok) {
+                    q = 0;
+                }
+            }
+        }
+
+        if (coding.compare(QLatin1String("gzip"), Qt::CaseInsensitive) == 0 ||
+                coding.compare(QLatin1String("x-gzip"), Qt::CaseInsensitive) == 0) {
+            gzipQ = q;
+        } else if (coding.compare(QLatin1String("deflate"), Qt::CaseInsensitive) == 0) {
+            deflateQ = q;
+        } else if (coding == QLatin1String("*")) {
+            anyQ = q;
+        }
+    }
+
+    // Codings not listed get the "*" q-value
+    if (gzipQ < 0) {
+        gzipQ = anyQ;
+    }
+    if (deflateQ < 0) {
+        deflateQ = anyQ;
+    }
+
+    if (gzipQ <= 0 && deflateQ <= 0) {
+        return Identity;
+    }
+    // On a tie prefer gzip, some clients expect raw deflate data
+    return gzipQ >= deflateQ ? Gzip : Deflate;
+}
+
+bool CompressionPrivate::compressible(const QString &contentType) const
+{
+    if (contentType.isEmpty()) {
+        return false;
+    }
+
+    Q_FOREACH (const QString &type, contentTypes) {
+        if (type.contains(QLatin1Char('/'))) {
+            if (contentType == type) {
+                return true;
+            }
+        } else if (contentType.startsWith(type) &&
+                   contentType.size() > type.size() &&
+                   contentType.at(type.size()) == QLatin1Char('/')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ZlibEncoder::ZlibEncoder(bool gzip, int level)
+{
+    memset(&m_stream, 0, sizeof(m_stream));
+    // A window of 15 bits plus 16 writes a gzip header
+    m_valid = deflateInit2(&m_stream, level, Z_DEFLATED,
+                           gzip ? MAX_WBITS + 16 : MAX_WBITS,
+                           8, Z_DEFAULT_STRATEGY) == Z_OK;
+}
+
+ZlibEncoder::~ZlibEncoder()
+{
+    if (m_valid) {
+        deflateEnd(&m_stream);
+    }
+}
+
+bool ZlibEncoder::encode(const char *data, qint64 len, QByteArray &output)
+{
+    m_stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    m_stream.avail_in = uInt(len);
+    // Flushing on every write keeps streamed responses responsive
+    return deflateTo(Z_SYNC_FLUSH, output);
+}
+
+bool ZlibEncoder::append(const char *data, qint64 len, QByteArray &output)
+{
+    m_stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    m_stream.avail_in = uInt(len);
+    return deflateTo(Z_NO_FLUSH, output);
+}
+
+bool ZlibEncoder::finish(QByteArray &output)
+{
+    m_stream.next_in = 0;
+    m_stream.avail_in = 0;
+    return deflateTo(Z_FINISH, output);
+}
+
+bool ZlibEncoder::deflateTo(int flush, QByteArray &output)
+{
+    char buffer[16 * 1024];
+    do {
+        m_stream.next_out = reinterpret_cast<Bytef *>(buffer);
+        m_stream.avail_out = sizeof(buffer);
+        if (deflate(&m_stream, flush) == Z_STREAM_ERROR) {
+            return false;
+        }
+        output.append(buffer, int(sizeof(buffer) - m_stream.avail_out));
+    } while (m_stream.avail_out == 0);
+    return true;
+}
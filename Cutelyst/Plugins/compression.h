@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CPCOMPRESSION_H
+#define CPCOMPRESSION_H
+
+#include <Cutelyst/plugin.h>
+
+namespace Cutelyst {
+
+class Context;
+class CompressionPrivate;
+/**
+ * Compresses responses with gzip or deflate, chosen from
+ * the Accept-Encoding request header and its q-values.
+ *
+ * Buffered bodies are compressed at once and keep a
+ * Content-Length, while file bodies and data sent with
+ * Response::write() are compressed as they are written,
+ * using chunked transfer-encoding (HTTP/1.1 only).
+ *
+ * Responses that can be compressed always get
+ * "Vary: Accept-Encoding" so caches store each variant.
+ */
+class Compression : public Plugin
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(Compression)
+public:
+    Compression(Application *parent);
+    virtual ~Compression();
+
+    /**
+     * Sets the content types that are compressed, a type
+     * without a subtype like "text" matches all of its
+     * subtypes. Defaults to text, JSON, JavaScript, XML and SVG.
+     */
+    void setContentTypes(const QStringList &contentTypes);
+    QStringList contentTypes() const;
+
+    /**
+     * Bodies smaller than \p size are not compressed,
+     * defaults to 1024 bytes
+     */
+    void setMinimumSize(qint64 size);
+    qint64 minimumSize() const;
+
+    /**
+     * Sets the zlib compression \p level (1 to 9) used for
+     * \p encoding, "gzip" or "deflate", defaults to 6
+     */
+    void setLevel(const QString &encoding, int level);
+    int level(const QString &encoding) const;
+
+    virtual bool setup(Application *app);
+
+protected:
+    CompressionPrivate *d_ptr;
+
+private:
+    void beforeFinalizeHeaders(Context *c);
+};
+
+}
+
+#endif // CPCOMPRESSION_H
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef COMPRESSION_P_H
+#define COMPRESSION_P_H
+
+#include "compression.h"
+
+#include <Cutelyst/bodyencoder.h>
+
+#include <QtCore/QStringList>
+
+#include <zlib.h>
+
+namespace Cutelyst {
+
+class CompressionPrivate
+{
+public:
+    enum Encoding {
+        Identity,
+        Deflate,
+        Gzip
+    };
+
+    Encoding negotiate(const QString &acceptEncoding) const;
+    bool compressible(const QString &contentType) const;
+
+    QStringList contentTypes = {
+        QStringLiteral("text"),
+        QStringLiteral("application/json"),
+        QStringLiteral("application/javascript"),
+        QStringLiteral("application/xml"),
+        QStringLiteral("application/xhtml+xml"),
+        QStringLiteral("image/svg+xml")
+    };
+    qint64 minimumSize = 1024;
+    int gzipLevel = 6;
+    int deflateLevel = 6;
+};
+
+class ZlibEncoder : public BodyEncoder
+{
+public:
+    ZlibEncoder(bool gzip, int level);
+    virtual ~ZlibEncoder();
+
+    bool isValid() const { return m_valid; }
+
+    /**
+     * Compresses \p data without flushing, for bodies
+     * in memory that are followed by finish()
+     */
+    bool append(const char *data, qint64 len, QByteArray &output);
+
+    virtual bool encode(const char *data, qint64 len, QByteArray &output) Q_DECL_OVERRIDE;
+    virtual bool finish(QByteArray &output) Q_DECL_OVERRIDE;
+
+private:
+    bool deflateTo(int flush, QByteArray &output);
+
+    z_stream m_stream;
+    bool m_valid;
+};
+
+}
+
+#endif // COMPRESSION_P_H
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "conditionalresponse_p.h"
+#include "application.h"
+#include "request.h"
+#include "response.h"
+#include "context.h"
+#include "segmentedbuffer.h"
+#include "xxhash_p.h"
+
+#include <QBuffer>
+#include <QStringBuilder>
+#include <QLoggingCategory>
+
+using namespace Cutelyst;
+
+Q_LOGGING_CATEGORY(C_CONDITIONALRESPONSE, "cutelyst.plugin.conditionalresponse")
+
+ConditionalResponse::ConditionalResponse(Application *parent) : Plugin(parent)
+  , d_ptr(new ConditionalResponsePrivate)
+{
+
+}
+
+ConditionalResponse::~ConditionalResponse()
+{
+    delete d_ptr;
+}
+
+void ConditionalResponse::setWeak(bool weak)
+{
+    Q_D(ConditionalResponse);
+    d->weak = weak;
+}
+
+bool ConditionalResponse::weak() const
+{
+    Q_D(const ConditionalResponse);
+    return d->weak;
+}
+
+bool ConditionalResponse::setup(Application *app)
+{
+    connect(app, &Application::beforeFinalizeHeaders,
+            this, &ConditionalResponse::beforeFinalizeHeaders);
+    return true;
+}
+
+void ConditionalResponse::beforeFinalizeHeaders(Context *c)
+{
+    Q_D(const ConditionalResponse);
+
+    Response *res = c->response();
+    if (res->status() != Response::OK) {
+        return;
+    }
+
+    Request *req = c->request();
+    const Request::HttpMethod method = req->httpMethod();
+    if (method != Request::Get && method != Request::Head) {
+        return;
+    }
+
+    Headers &headers = res->headers();
+    QString etag = headers.header(QStringLiteral("ETag"));
+    if (etag.isEmpty()) {
+        etag = ConditionalResponsePrivate::hashBody(res->bodyDevice());
+        if (etag.isEmpty()) {
+            // Streamed or not in memory
+            return;
+        }
+
+        if (d->weak) {
+            etag.prepend(QLatin1String("W/"));
+        }
+        headers.setHeader(QStringLiteral("ETag"), etag);
+    }
+
+    const QString ifNoneMatch = req->headers().header(QStringLiteral("If-None-Match"));
+    if (!ifNoneMatch.isEmpty() && ConditionalResponsePrivate::matches(ifNoneMatch, etag)) {
+        qCDebug(C_CONDITIONALRESPONSE) << "Not modified" << etag;
+        res->setStatus(Response::NotModified);
+        res->setBody(0);
+        headers.removeHeader(QStringLiteral("Content-Length"));
+        headers.removeHeader(QStringLiteral("Content-Type"));
+    }
+}
+
+QString ConditionalResponsePrivate::hashBody(QIODevice *body)
+{
+    XXHash64 hash;
+    QBuffer *buffer = qobject_cast<QBuffer *>(body);
+    SegmentedBuffer *segmented = qobject_cast<SegmentedBuffer *>(body);
+    if (buffer) {
+        hash.update(buffer->buffer().constData(), buffer->buffer().size());
+    } else if (segmented) {
+        for (int i = 0; i < segmented->segmentCount(); ++i) {
+            hash.update(segmented->segmentData(i), segmented->segmentSize(i));
+        }
+    } else {
+        return QString();
+    }
+
+    return QLatin1Char('"') % QString::number(hash.digest(), 16) % QLatin1Char('"');
+}
+
+bool ConditionalResponsePrivate::matches(const QString &ifNoneMatch, const QString &etag)
+{
+    if (ifNoneMatch.trimmed() == QLatin1String("*")) {
+        return true;
+    }
+
+    // If-None-Match uses the weak comparison (RFC 7232 section 3.2)
+    const QStringRef opaque = etag.startsWith(QLatin1String("W/")) ? etag.midRef(2) : etag.midRef(0);
+    Q_FOREACH (const QStringRef &part, ifNoneMatch.splitRef(QLatin1Char(','))) {
+        QStringRef tag = part.trimmed();
+        if (tag.startsWith(QLatin1String("W/"))) {
+            tag = tag.mid(2);
+        }
+        if (tag == opaque) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CPCONDITIONALRESPONSE_H
+#define CPCONDITIONALRESPONSE_H
+
+#include <Cutelyst/plugin.h>
+
+namespace Cutelyst {
+
+class Context;
+class ConditionalResponsePrivate;
+/**
+ * Sets an ETag on successful GET and HEAD responses with a
+ * body in memory, hashing the body with XXH64, and replies
+ * with 304 Not Modified when it matches If-None-Match, so
+ * clients polling a resource only download it when it changes.
+ *
+ * Responses that already have an ETag keep it and are
+ * only checked against If-None-Match.
+ */
+class ConditionalResponse : public Plugin
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(ConditionalResponse)
+public:
+    ConditionalResponse(Application *parent);
+    virtual ~ConditionalResponse();
+
+    /**
+     * Generates weak ETags (W/"...") instead of strong ones,
+     * defaults to false
+     */
+    void setWeak(bool weak);
+    bool weak() const;
+
+    virtual bool setup(Application *app);
+
+protected:
+    ConditionalResponsePrivate *d_ptr;
+
+private:
+    void beforeFinalizeHeaders(Context *c);
+};
+
+}
+
+#endif // CPCONDITIONALRESPONSE_H
@@ -0,0 +1,302 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "precompiledtemplates.h"
+
+#include "segmentedbuffer.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QLoggingCategory>
+
+using namespace Cutelyst;
+
+Q_LOGGING_CATEGORY(C_PRECOMPILEDTEMPLATES, "cutelyst.plugin.precompiledtemplates")
+
+struct PrecompiledTemplatesRegistry
+{
+    QReadWriteLock lock;
+    QHash<QString, PrecompiledTemplates::RenderFunction> templates;
+};
+
+Q_GLOBAL_STATIC(PrecompiledTemplatesRegistry, s_registry)
+
+static QVariant lookup(const QVariant &value, const QString &key)
+{
+    switch (value.userType()) {
+    case QMetaType::QVariantHash:
+        return value.toHash().value(key);
+    case QMetaType::QVariantMap:
+        return value.toMap().value(key);
+    case QMetaType::QVariantList:
+    case QMetaType::QStringList:
+    {
+        bool ok;
+        const int index = key.toInt(&ok);
+        const QVariantList list = value.toList();
+        if (ok && index >= 0 && index < list.size()) {
+            return list.at(index);
+        }
+        return QVariant();
+    }
+    default:
+        break;
+    }
+
+    QObject *object = value.value<QObject *>();
+    if (object) {
+        return object->property(key.toLatin1().constData());
+    }
+    return QVariant();
+}
+
+PrecompiledTemplates::Scope::Scope(const QVariantHash &stash) : m_stash(stash)
+{
+
+}
+
+QVariant PrecompiledTemplates::Scope::value(const QStringList &path) const
+{
+    if (path.isEmpty()) {
+        return QVariant();
+    }
+
+    const QString &root = path.first();
+    if (path.size() == 2 && root == QLatin1String("forloop")) {
+        return forloop(path.at(1));
+    }
+
+    QVariant ret;
+    const Local *var = local(root);
+    if (var) {
+        ret = var->value;
+    } else {
+        ret = m_stash.value(root);
+    }
+
+    for (int i = 1; i < path.size() && ret.isValid(); ++i) {
+        ret = lookup(ret, path.at(i));
+    }
+    return ret;
+}
+
+void PrecompiledTemplates::Scope::write(SegmentedBuffer *out, const QStringList &path, bool escape) const
+{
+    if (escape && !path.isEmpty()) {
+        const Local *var = local(path.first());
+        if (var && var->safe) {
+            escape = false;
+        }
+    }
+
+    const QString text = value(path).toString();
+    if (escape) {
+        PrecompiledTemplates::writeEscaped(out, text);
+    } else {
+        out->append(text);
+    }
+}
+
+void PrecompiledTemplates::Scope::push(const QString &name, const QVariant &value, bool safe)
+{
+    m_locals.append({ name, value, 0, -1, safe });
+}
+
+void PrecompiledTemplates::Scope::pop()
+{
+    m_locals.removeLast();
+}
+
+void PrecompiledTemplates::Scope::beginLoop(const QString &name, int size)
+{
+    m_locals.append({ name, QVariant(), 0, size, false });
+}
+
+void PrecompiledTemplates::Scope::nextLoop(int index, const QVariant &value)
+{
+    Local &var = m_locals.last();
+    var.index = index;
+    var.value = value;
+}
+
+void PrecompiledTemplates::Scope::endLoop()
+{
+    m_locals.removeLast();
+}
+
+const PrecompiledTemplates::Scope::Local *PrecompiledTemplates::Scope::local(const QString &name) const
+{
+    for (int i = m_locals.size() - 1; i >= 0; --i) {
+        const Local &var = m_locals.at(i);
+        if (var.name == name) {
+            return &var;
+        }
+    }
+    return 0;
+}
+
+QVariant PrecompiledTemplates::Scope::forloop(const QString &key) const
+{
+    for (int i = m_locals.size() - 1; i >= 0; --i) {
+        const Local &var = m_locals.at(i);
+        if (var.size == -1) {
+            continue;
+        }
+
+        if (key == QLatin1String("counter")) {
+            return var.index + 1;
+        } else if (key == QLatin1String("counter0")) {
+            return var.index;
+        } else if (key == QLatin1String("revcounter")) {
+            return var.size - var.index;
+        } else if (key == QLatin1String("revcounter0")) {
+            return var.size - var.index - 1;
+        } else if (key == QLatin1String("first")) {
+            return var.index == 0;
+        } else if (key == QLatin1String("last")) {
+            return var.index == var.size - 1;
+        }
+        break;
+    }
+    return QVariant();
+}
+
+void PrecompiledTemplates::registerTemplate(const QString &name, RenderFunction render)
+{
+    PrecompiledTemplatesRegistry *registry = s_registry();
+    QWriteLocker locker(&registry->lock);
+    if (registry->templates.contains(name)) {
+        qCWarning(C_PRECOMPILEDTEMPLATES) << "Replacing precompiled template" << name;
+    }
+    registry->templates.insert(name, render);
+}
+
+PrecompiledTemplates::RenderFunction PrecompiledTemplates::find(const QString &name)
+{
+    PrecompiledTemplatesRegistry *registry = s_registry();
+    QReadLocker locker(&registry->lock);
+    return registry->templates.value(name);
+}
+
+QStringList PrecompiledTemplates::names()
+{
+    PrecompiledTemplatesRegistry *registry = s_registry();
+    QReadLocker locker(&registry->lock);
+    return registry->templates.keys();
+}
+
+bool PrecompiledTemplates::render(const QString &name, Scope &scope, SegmentedBuffer *out)
+{
+    RenderFunction render = find(name);
+    if (!render) {
+        qCWarning(C_PRECOMPILEDTEMPLATES) << "Template not found" << name;
+        return false;
+    }
+
+    render(scope, out);
+    return true;
+}
+
+bool PrecompiledTemplates::isTrue(const QVariant &value)
+{
+    switch (value.userType()) {
+    case QMetaType::UnknownType:
+        return false;
+    case QMetaType::Bool:
+        return value.toBool();
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+        return value.toLongLong() != 0;
+    case QMetaType::Double:
+    case QMetaType::Float:
+        return value.toDouble() != 0.0;
+    case QMetaType::QString:
+        return !value.toString().isEmpty();
+    case QMetaType::QByteArray:
+        return !value.toByteArray().isEmpty();
+    case QMetaType::QStringList:
+    case QMetaType::QVariantList:
+        return !value.toList().isEmpty();
+    case QMetaType::QVariantHash:
+        return !value.toHash().isEmpty();
+    case QMetaType::QVariantMap:
+        return !value.toMap().isEmpty();
+    default:
+        break;
+    }
+
+    if (QMetaType::typeFlags(value.userType()) & QMetaType::PointerToQObject) {
+        return value.value<QObject *>() != 0;
+    }
+    return !value.isNull();
+}
+
+QVariantList PrecompiledTemplates::toList(const QVariant &value)
+{
+    if (value.canConvert<QVariantList>()) {
+        return value.toList();
+    }
+    return QVariantList();
+}
+
+QStringList PrecompiledTemplates::splitPath(const QString &path)
+{
+    return path.split(QLatin1Char('.'));
+}
+
+void PrecompiledTemplates::writeEscaped(SegmentedBuffer *out, const QString &text)
+{
+    int from = 0;
+    for (int i = 0; i < text.size(); ++i) {
+        const char *entity;
+        switch (text.at(i).unicode()) {
+        case '&':
+            entity = "&amp;";
+            break;
+        case '<':
+            entity = "&lt;";
+            break;
+        case '>':
+            entity = "&gt;";
+            break;
+        case '"':
+            entity = "&quot;";
+            break;
+        case '\'':
+            entity = "&#39;";
+            break;
+        default:
+            continue;
+        }
+
+        if (i > from) {
+            out->append(text.mid(from, i - from));
+        }
+        out->append(entity, qstrlen(entity));
+        from = i + 1;
+    }
+
+    if (from == 0) {
+        out->append(text);
+    } else if (from < text.size()) {
+        out->append(text.mid(from));
+    }
+}
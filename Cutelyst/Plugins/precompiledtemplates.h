@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CPPRECOMPILEDTEMPLATES_H
+#define CPPRECOMPILEDTEMPLATES_H
+
+#include <QtCore/QVariant>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+namespace Cutelyst {
+
+class SegmentedBuffer;
+/**
+ * Runtime support for templates compiled to C++ with the
+ * cutelyst_precompile_templates() CMake function.
+ *
+ * The generated code registers one render function per
+ * template, named by its path relative to the templates
+ * directory, and the "Precompiled" view engine renders
+ * them by name, with no template parsing at run time.
+ */
+class PrecompiledTemplates
+{
+public:
+    class Scope;
+    typedef void (*RenderFunction)(Scope &scope, SegmentedBuffer *out);
+
+    /**
+     * The variables of a render, locals and loop
+     * variables are looked up first, then the stash.
+     */
+    class Scope
+    {
+    public:
+        explicit Scope(const QVariantHash &stash);
+
+        /**
+         * Resolves a path like user.name, looking into hashes,
+         * maps, lists (by index) and QObject properties, the
+         * forloop variable refers to the innermost loop
+         */
+        QVariant value(const QStringList &path) const;
+
+        /**
+         * Writes the value of \p path as UTF-8, HTML escaped
+         * unless \p escape is false or the variable is safe
+         */
+        void write(SegmentedBuffer *out, const QStringList &path, bool escape) const;
+
+        /**
+         * Adds a local variable, safe variables are never escaped
+         */
+        void push(const QString &name, const QVariant &value, bool safe = false);
+        void pop();
+
+        /**
+         * Adds the variable of a loop over \p size items, which
+         * nextLoop() sets to each item until endLoop() removes it
+         */
+        void beginLoop(const QString &name, int size);
+        void nextLoop(int index, const QVariant &value);
+        void endLoop();
+
+    private:
+        struct Local {
+            QString name;
+            QVariant value;
+            int index;
+            // -1 when not a loop variable
+            int size;
+            bool safe;
+        };
+
+        const Local *local(const QString &name) const;
+        QVariant forloop(const QString &key) const;
+
+        const QVariantHash &m_stash;
+        QVector<Local> m_locals;
+    };
+
+    static void registerTemplate(const QString &name, RenderFunction render);
+
+    /**
+     * Returns the render function of \p name or 0
+     */
+    static RenderFunction find(const QString &name);
+
+    static QStringList names();
+
+    /**
+     * Renders the template \p name, used by includes
+     */
+    static bool render(const QString &name, Scope &scope, SegmentedBuffer *out);
+
+    /**
+     * Same rules as Grantlee's {% if %}
+     */
+    static bool isTrue(const QVariant &value);
+
+    static QVariantList toList(const QVariant &value);
+
+    static QStringList splitPath(const QString &path);
+
+    /**
+     * Appends \p text as UTF-8 escaping &<>"' as HTML entities
+     */
+    static void writeEscaped(SegmentedBuffer *out, const QString &text);
+};
+
+}
+
+#endif // CPPRECOMPILEDTEMPLATES_H
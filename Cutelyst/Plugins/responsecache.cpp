@@ -0,0 +1,423 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "responsecache_p.h"
+#include "application.h"
+#include "request.h"
+#include "response.h"
+#include "context.h"
+#include "action.h"
+#include "segmentedbuffer.h"
+#include "xxhash_p.h"
+
+#include <QBuffer>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QStringBuilder>
+#include <QLoggingCategory>
+
+using namespace Cutelyst;
+
+Q_LOGGING_CATEGORY(C_RESPONSECACHE, "cutelyst.plugin.responsecache")
+
+#define RESPONSECACHE_KEY "__responsecache_key"
+#define RESPONSECACHE_FLIGHT "__responsecache_flight"
+
+struct ResponseCacheStore
+{
+    ~ResponseCacheStore() {
+        Q_FOREACH (ResponseCacheShard *set, shards) {
+            delete [] set;
+        }
+    }
+
+    QMutex mutex;
+    // Application class name to it's shards, so that each engine
+    // thread, which has it's own Application, shares the entries
+    QHash<QByteArray, ResponseCacheShard *> shards;
+};
+
+Q_GLOBAL_STATIC(ResponseCacheStore, s_store)
+
+ResponseCache::ResponseCache(Application *parent) : Plugin(parent)
+  , d_ptr(new ResponseCachePrivate)
+{
+    Q_D(ResponseCache);
+
+    const QByteArray appClass = parent ? QByteArray(parent->metaObject()->className()) : QByteArray();
+
+    ResponseCacheStore *store = s_store();
+    QMutexLocker locker(&store->mutex);
+    d->shards = store->shards.value(appClass);
+    if (!d->shards) {
+        d->shards = new ResponseCacheShard[RESPONSECACHE_SHARDS];
+        store->shards.insert(appClass, d->shards);
+    }
+}
+
+ResponseCache::~ResponseCache()
+{
+    delete d_ptr;
+}
+
+void ResponseCache::setDefaultTtl(int seconds)
+{
+    Q_D(ResponseCache);
+    d->defaultTtl = seconds;
+}
+
+int ResponseCache::defaultTtl() const
+{
+    Q_D(const ResponseCache);
+    return d->defaultTtl;
+}
+
+void ResponseCache::setCacheAll(bool enable)
+{
+    Q_D(ResponseCache);
+    d->cacheAll = enable;
+}
+
+bool ResponseCache::cacheAll() const
+{
+    Q_D(const ResponseCache);
+    return d->cacheAll;
+}
+
+void ResponseCache::setVaryHeaders(const QStringList &headers)
+{
+    Q_D(ResponseCache);
+    d->varyHeaders = headers;
+}
+
+QStringList ResponseCache::varyHeaders() const
+{
+    Q_D(const ResponseCache);
+    return d->varyHeaders;
+}
+
+void ResponseCache::setMaxEntries(int entries)
+{
+    Q_D(ResponseCache);
+    d->maxEntries = entries;
+}
+
+int ResponseCache::maxEntries() const
+{
+    Q_D(const ResponseCache);
+    return d->maxEntries;
+}
+
+void ResponseCache::setMaxBodySize(qint64 size)
+{
+    Q_D(ResponseCache);
+    d->maxBodySize = size;
+}
+
+qint64 ResponseCache::maxBodySize() const
+{
+    Q_D(const ResponseCache);
+    return d->maxBodySize;
+}
+
+void ResponseCache::setCoalesceTimeout(int msecs)
+{
+    Q_D(ResponseCache);
+    d->coalesceTimeout = msecs;
+}
+
+int ResponseCache::coalesceTimeout() const
+{
+    Q_D(const ResponseCache);
+    return d->coalesceTimeout;
+}
+
+void ResponseCache::clear()
+{
+    Q_D(ResponseCache);
+    for (int i = 0; i < RESPONSECACHE_SHARDS; ++i) {
+        ResponseCacheShard &shard = d->shards[i];
+        QWriteLocker locker(&shard.lock);
+        shard.entries.clear();
+    }
+}
+
+bool ResponseCache::setup(Application *app)
+{
+    connect(app, &Application::beforePrepareAction,
+            this, &ResponseCache::beforePrepareAction);
+    connect(app, &Application::beforeFinalizeHeaders,
+            this, &ResponseCache::beforeFinalizeHeaders);
+    return true;
+}
+
+void ResponseCache::beforePrepareAction(Context *c, bool *skipMethod)
+{
+    Q_D(ResponseCache);
+
+    if (*skipMethod) {
+        return;
+    }
+
+    Request *req = c->request();
+    const Request::HttpMethod method = req->httpMethod();
+    if (method != Request::Get && method != Request::Head) {
+        return;
+    }
+
+    const QByteArray key = d->cacheKey(c);
+    if (key.isEmpty()) {
+        return;
+    }
+
+    const quint64 hash = XXHash64::hash(key.constData(), key.size());
+    ResponseCacheEntry entry;
+    ResponseCachePrivate::Lookup result = d->lookup(hash, key, entry);
+    // The action isn't known yet, only keys that were cached
+    // before are coalesced so other requests never pay for it
+    if (result == ResponseCachePrivate::Expired && d->coalesceTimeout > 0) {
+        const bool leader = d->joinFlight(hash);
+        // Look again as it might have been stored meanwhile
+        result = d->lookup(hash, key, entry);
+        if (leader) {
+            if (result == ResponseCachePrivate::Expired || result == ResponseCachePrivate::Miss) {
+                // The identical requests arriving now will wait for this one
+                c->setProperty(RESPONSECACHE_FLIGHT, true);
+            } else {
+                d->leaveFlight(hash);
+            }
+        }
+    }
+
+    if (result != ResponseCachePrivate::Hit) {
+        // Let beforeFinalizeHeaders() know this one can be stored
+        c->setProperty(RESPONSECACHE_KEY, key);
+        return;
+    }
+
+    qCDebug(C_RESPONSECACHE) << "Serving cached response for" << req->path();
+    Response *res = c->response();
+    res->setStatus(entry.status);
+    res->headers() = entry.headers;
+    res->setHeader(QStringLiteral("Age"), QString::number((QDateTime::currentMSecsSinceEpoch() - entry.created) / 1000));
+    if (!entry.body.isEmpty()) {
+        res->body() = entry.body;
+    }
+    *skipMethod = true;
+}
+
+void ResponseCache::beforeFinalizeHeaders(Context *c)
+{
+    Q_D(ResponseCache);
+
+    const QByteArray key = c->property(RESPONSECACHE_KEY).toByteArray();
+    if (key.isEmpty()) {
+        // Not cacheable or a cache hit
+        return;
+    }
+
+    const quint64 hash = XXHash64::hash(key.constData(), key.size());
+    const bool stored = d->store(c, key, hash);
+
+    if (c->property(RESPONSECACHE_FLIGHT).toBool()) {
+        if (!stored && d->actionTtl(c) > 0) {
+            // Identical requests should not keep waiting for
+            // each other when the response can't be cached
+            ResponseCacheEntry pass;
+            pass.key = key;
+            pass.status = 0;
+            pass.created = QDateTime::currentMSecsSinceEpoch();
+            pass.expires = pass.created + d->defaultTtl * 1000LL;
+            d->insert(hash, pass);
+        }
+        d->leaveFlight(hash);
+    }
+}
+
+bool ResponseCachePrivate::store(Context *c, const QByteArray &key, quint64 hash)
+{
+    Response *res = c->response();
+    if (res->status() != Response::OK || res->bodyEncoder() || !res->cookies().isEmpty()) {
+        return false;
+    }
+
+    const int ttl = actionTtl(c);
+    if (ttl <= 0) {
+        return false;
+    }
+
+    const Headers &headers = res->headers();
+    const QString cacheControl = headers.header(QStringLiteral("Cache-Control"));
+    if (cacheControl.contains(QLatin1String("private"), Qt::CaseInsensitive) ||
+            cacheControl.contains(QLatin1String("no-store"), Qt::CaseInsensitive) ||
+            !headers.header(QStringLiteral("Set-Cookie")).isEmpty()) {
+        return false;
+    }
+
+    // An encoded body can only be served to clients that accept it
+    if (!headers.contentEncoding().isEmpty() &&
+            !varyHeaders.contains(QStringLiteral("Accept-Encoding"), Qt::CaseInsensitive)) {
+        return false;
+    }
+
+    // Without a body device it's being written with Response::write()
+    ResponseCacheEntry entry;
+    QIODevice *body = res->bodyDevice();
+    QBuffer *buffer = qobject_cast<QBuffer *>(body);
+    SegmentedBuffer *segmented = qobject_cast<SegmentedBuffer *>(body);
+    if (buffer) {
+        entry.body = buffer->buffer();
+    } else if (segmented && segmented->size() <= maxBodySize) {
+        entry.body = segmented->toByteArray();
+    } else {
+        // Streamed or not in memory
+        return false;
+    }
+
+    if (entry.body.size() > maxBodySize) {
+        return false;
+    }
+
+    entry.key = key;
+    entry.headers = headers;
+    entry.status = res->status();
+    entry.created = QDateTime::currentMSecsSinceEpoch();
+    entry.expires = entry.created + ttl * 1000LL;
+
+    insert(hash, entry);
+    qCDebug(C_RESPONSECACHE) << "Cached response for" << c->request()->path() << ttl << "seconds";
+    return true;
+}
+
+QByteArray ResponseCachePrivate::cacheKey(Context *c) const
+{
+    Request *req = c->request();
+    const Headers headers = req->headers();
+    if (!headers.authorization().isEmpty()) {
+        return QByteArray();
+    }
+
+    // Responses might depend on a session, so they are neither
+    // looked up nor stored unless the cookies are part of the key
+    if (!headers.header(QStringLiteral("Cookie")).isEmpty() &&
+            !varyHeaders.contains(QStringLiteral("Cookie"), Qt::CaseInsensitive)) {
+        return QByteArray();
+    }
+
+    QString key = req->method() % QLatin1Char('\n') %
+            headers.header(QStringLiteral("Host")) % QLatin1Char('\n') %
+            req->path() % QLatin1Char('?') % QString::fromLatin1(req->query());
+    Q_FOREACH (const QString &header, varyHeaders) {
+        key.append(QLatin1Char('\n') % headers.header(header));
+    }
+    return key.toUtf8();
+}
+
+int ResponseCachePrivate::actionTtl(Context *c) const
+{
+    Action *action = c->action();
+    if (!action) {
+        return 0;
+    }
+
+    const QMap<QString, QString> attributes = action->attributes();
+    QMap<QString, QString>::ConstIterator it = attributes.constFind(QStringLiteral("Cache"));
+    if (it == attributes.constEnd()) {
+        return cacheAll ? defaultTtl : 0;
+    } else if (it.value().isEmpty()) {
+        return defaultTtl;
+    }
+    return it.value().toInt();
+}
+
+ResponseCachePrivate::Lookup ResponseCachePrivate::lookup(quint64 hash, const QByteArray &key, ResponseCacheEntry &entry)
+{
+    ResponseCacheShard &shard = shardFor(hash);
+    QReadLocker locker(&shard.lock);
+    const ResponseCacheEntry *cached = shard.entries.value(hash);
+    if (!cached || cached->key != key) {
+        return Miss;
+    } else if (cached->expires <= QDateTime::currentMSecsSinceEpoch()) {
+        // Expired entries stay until the shard is full
+        return Expired;
+    } else if (!cached->status) {
+        return Pass;
+    }
+
+    // Implicitly shared, copying only touches reference counts
+    entry = *cached;
+    return Hit;
+}
+
+void ResponseCachePrivate::insert(quint64 hash, const ResponseCacheEntry &entry)
+{
+    ResponseCacheShard &shard = shardFor(hash);
+    const int maxShardEntries = qMax(1, maxEntries / RESPONSECACHE_SHARDS);
+
+    QWriteLocker locker(&shard.lock);
+    shard.entries.setMaxSize(maxShardEntries);
+    shard.entries.insert(hash, entry, entry.expires, entry.created);
+}
+
+bool ResponseCachePrivate::joinFlight(quint64 hash)
+{
+    ResponseCacheShard &shard = shardFor(hash);
+    QMutexLocker locker(&shard.flightsMutex);
+    ResponseCacheFlight *flight = shard.flights.value(hash);
+    if (!flight) {
+        shard.flights.insert(hash, new ResponseCacheFlight);
+        return true;
+    }
+
+    // Requests run synchronously on their worker thread, so
+    // waiting blocks the thread, but never for too long
+    ++flight->waiters;
+    QElapsedTimer timer;
+    timer.start();
+    qint64 remaining = coalesceTimeout;
+    while (!flight->finished && remaining > 0) {
+        flight->done.wait(&shard.flightsMutex, static_cast<unsigned long>(remaining));
+        remaining = coalesceTimeout - timer.elapsed();
+    }
+
+    if (!flight->finished) {
+        qCWarning(C_RESPONSECACHE) << "Timeout waiting for an identical request to finish";
+    }
+
+    // The leader hands the flight over to the last waiter
+    if (--flight->waiters == 0 && flight->finished) {
+        delete flight;
+    }
+    return false;
+}
+
+void ResponseCachePrivate::leaveFlight(quint64 hash)
+{
+    ResponseCacheShard &shard = shardFor(hash);
+    QMutexLocker locker(&shard.flightsMutex);
+    ResponseCacheFlight *flight = shard.flights.take(hash);
+    if (flight) {
+        if (flight->waiters) {
+            flight->finished = true;
+            flight->done.wakeAll();
+        } else {
+            delete flight;
+        }
+    }
+}
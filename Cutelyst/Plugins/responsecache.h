@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CPRESPONSECACHE_H
+#define CPRESPONSECACHE_H
+
+#include <Cutelyst/plugin.h>
+
+namespace Cutelyst {
+
+class Context;
+class ResponseCachePrivate;
+/**
+ * Keeps whole responses in memory and serves them again from
+ * Application::beforePrepareAction(), before the dispatcher
+ * runs, so cached pages cost no controller code at all.
+ *
+ * Entries are keyed by method, host, path, query and the
+ * request headers set with setVaryHeaders(). Actions opt in
+ * with the :Cache(seconds) attribute, or all of them with
+ * setCacheAll(). Only 200 responses to GET and HEAD with an
+ * in-memory body, no cookies and no "Cache-Control: private"
+ * or "no-store" are stored, requests with an Authorization
+ * header are never cached, neither are requests with a Cookie
+ * header unless "Cookie" is one of the varyHeaders().
+ *
+ * Entries are kept per process, the Application instances of
+ * all engine threads, which are of the same class, share them.
+ *
+ * When an entry expired, the first request computes it again
+ * and identical requests arriving meanwhile, on any engine
+ * thread, wait for it and share the result instead of all
+ * recomputing it, keys whose response turns out not to be
+ * storable stop being waited on for defaultTtl() seconds.
+ *
+ * Register it before Compression and ConditionalResponse so
+ * that stored bodies are not encoded and cache hits are still
+ * compressed and validated.
+ */
+class ResponseCache : public Plugin
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(ResponseCache)
+public:
+    ResponseCache(Application *parent);
+    virtual ~ResponseCache();
+
+    /**
+     * Time in seconds used by actions with :Cache without
+     * a value, or all of them with setCacheAll(), defaults to 60
+     */
+    void setDefaultTtl(int seconds);
+    int defaultTtl() const;
+
+    /**
+     * Caches actions without a :Cache attribute for defaultTtl(),
+     * :Cache(0) opts out, defaults to false
+     */
+    void setCacheAll(bool enable);
+    bool cacheAll() const;
+
+    /**
+     * Request headers that select different representations,
+     * like Accept-Language, compressed responses are only stored
+     * when Accept-Encoding is one of them
+     */
+    void setVaryHeaders(const QStringList &headers);
+    QStringList varyHeaders() const;
+
+    /**
+     * Maximum number of cached responses, defaults to 1024
+     */
+    void setMaxEntries(int entries);
+    int maxEntries() const;
+
+    /**
+     * Responses with larger bodies are not stored, defaults to 1MiB
+     */
+    void setMaxBodySize(qint64 size);
+    qint64 maxBodySize() const;
+
+    /**
+     * Maximum time in milliseconds a request waits for an
+     * identical one to compute the response, 0 disables
+     * coalescing, defaults to 5000
+     */
+    void setCoalesceTimeout(int msecs);
+    int coalesceTimeout() const;
+
+    /**
+     * Removes all cached responses of this application,
+     * on every engine thread
+     */
+    void clear();
+
+    virtual bool setup(Application *app);
+
+protected:
+    ResponseCachePrivate *d_ptr;
+
+private:
+    void beforePrepareAction(Context *c, bool *skipMethod);
+    void beforeFinalizeHeaders(Context *c);
+};
+
+}
+
+#endif // CPRESPONSECACHE_H
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef RESPONSECACHE_P_H
+#define RESPONSECACHE_P_H
+
+#include "responsecache.h"
+#include "headers.h"
+#include "expirycache_p.h"
+
+#include <QtCore/QStringList>
+#include <QtCore/QHash>
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+
+#define RESPONSECACHE_SHARDS 16
+
+namespace Cutelyst {
+
+struct ResponseCacheEntry
+{
+    QByteArray key;
+    Headers headers;
+    QByteArray body;
+    qint64 created;
+    qint64 expires;
+    // Zero for keys that turned out not to be cacheable
+    quint16 status;
+};
+
+// A response being computed that identical requests wait for
+struct ResponseCacheFlight
+{
+    QWaitCondition done;
+    int waiters = 0;
+    bool finished = false;
+};
+
+// Shared by the Application instances of every engine thread,
+// each shard has its own lock so lookups from different
+// threads rarely wait for each other
+struct ResponseCacheShard
+{
+    QReadWriteLock lock;
+    ExpiryCache<quint64, ResponseCacheEntry> entries;
+
+    QMutex flightsMutex;
+    QHash<quint64, ResponseCacheFlight *> flights;
+};
+
+class ResponseCachePrivate
+{
+public:
+    enum Lookup {
+        Miss,
+        // A cacheable response was stored for the key before
+        Expired,
+        Hit,
+        Pass
+    };
+
+    // The high bits pick the shard, QHash uses the low ones
+    inline ResponseCacheShard &shardFor(quint64 hash)
+    { return shards[(hash >> 32) % RESPONSECACHE_SHARDS]; }
+
+    QByteArray cacheKey(Context *c) const;
+    int actionTtl(Context *c) const;
+    Lookup lookup(quint64 hash, const QByteArray &key, ResponseCacheEntry &entry);
+    void insert(quint64 hash, const ResponseCacheEntry &entry);
+    bool store(Context *c, const QByteArray &key, quint64 hash);
+
+    bool joinFlight(quint64 hash);
+    void leaveFlight(quint64 hash);
+
+    // Process wide, one set per application class
+    ResponseCacheShard *shards;
+    QStringList varyHeaders;
+    qint64 maxBodySize = 1024 * 1024;
+    int defaultTtl = 60;
+    int maxEntries = 1024;
+    int coalesceTimeout = 5000;
+    bool cacheAll = false;
+};
+
+}
+
+#endif // RESPONSECACHE_P_H
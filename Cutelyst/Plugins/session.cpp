@@ -160,13 +160,9 @@ QString SessionPrivate::getSessionId(Context *c, const QString &sessionName, boo
         return property.toString();
     }
 
-    QString sessionId;
-    Q_FOREACH (const QNetworkCookie &cookie, c->req()->cookies()) {
-        if (cookie.name() == sessionName) {
-            sessionId = cookie.value();
-            qCDebug(C_SESSION) << "Found sessionid" << sessionId << "in cookie";
-            break;
-        }
+    QString sessionId = c->req()->cookieValue(sessionName);
+    if (!sessionId.isEmpty()) {
+        qCDebug(C_SESSION) << "Found sessionid" << sessionId << "in cookie";
     }
 
     if (sessionId.isEmpty()) {
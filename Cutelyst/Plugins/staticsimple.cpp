@@ -76,7 +76,9 @@ bool StaticSimple::locateStaticFile(Context *c, const QString &relPath)
         if (fileInfo.exists()) {
             Response *res = c->res();
             const QDateTime &currentDateTime = fileInfo.lastModified();
-            if (currentDateTime == c->req()->headers().ifModifiedSinceDateTime()) {
+            const QDateTime &ifModifiedSince = c->req()->headers().ifModifiedSinceDateTime();
+            // HTTP dates have no milliseconds
+            if (ifModifiedSince.isValid() && currentDateTime.toTime_t() <= ifModifiedSince.toTime_t()) {
                 res->setStatus(Response::NotModified);
                 return true;
             }
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "viewcbor_p.h"
+
+#include "cbor_p.h"
+
+#include <Cutelyst/context.h>
+#include <Cutelyst/response.h>
+
+using namespace Cutelyst;
+
+ViewCbor::ViewCbor(Application *app) : Cutelyst::View(app)
+  , d_ptr(new ViewCborPrivate)
+{
+
+}
+
+ViewCbor::~ViewCbor()
+{
+    delete d_ptr;
+}
+
+ViewCbor::ExposeMode ViewCbor::exposeStashMode() const
+{
+    Q_D(const ViewCbor);
+    return d->exposeMode;
+}
+
+void ViewCbor::setExposeStashString(const QString &key)
+{
+    Q_D(ViewCbor);
+    d->exposeMode = ViewCbor::String;
+    d->exposeKey = key;
+}
+
+void ViewCbor::setExposeStashStringList(const QStringList &keys)
+{
+    Q_D(ViewCbor);
+    d->exposeMode = ViewCbor::StringList;
+    d->exposeKeys = keys;
+}
+
+void ViewCbor::setExposeStashRegularExpression(const QRegularExpression &re)
+{
+    Q_D(ViewCbor);
+    d->exposeMode = ViewCbor::RegularExpression;
+    d->exposeRE = re;
+}
+
+bool ViewCbor::render(Context *c) const
+{
+    Q_D(const ViewCbor);
+
+    const QVariantHash &stash = c->stash();
+    // A map keeps the output stable across runs
+    QVariantMap exposed;
+
+    switch (d->exposeMode) {
+    case All:
+    {
+        QVariantHash::ConstIterator it = stash.constBegin();
+        while (it != stash.constEnd()) {
+            exposed.insert(it.key(), it.value());
+            ++it;
+        }
+        break;
+    }
+    case String:
+    {
+        QVariantHash::ConstIterator it = stash.constFind(d->exposeKey);
+        if (it != stash.constEnd()) {
+            exposed.insert(d->exposeKey, it.value());
+        }
+        break;
+    }
+    case StringList:
+    {
+        QVariantHash::ConstIterator it = stash.constBegin();
+        while (it != stash.constEnd()) {
+            const QString &key = it.key();
+            if (d->exposeKeys.contains(key)) {
+                exposed.insert(key, it.value());
+            }
+            ++it;
+        }
+        break;
+    }
+    case RegularExpression:
+    {
+        QVariantHash::ConstIterator it = stash.constBegin();
+        while (it != stash.constEnd()) {
+            const QString &key = it.key();
+            if (d->exposeRE.match(key).hasMatch()) {
+                exposed.insert(key, it.value());
+            }
+            ++it;
+        }
+        break;
+    }
+    }
+
+    QByteArray output;
+    Cbor::write(exposed, output);
+
+    Response *res = c->response();
+    res->setContentType(QStringLiteral("application/cbor"));
+    res->body() = output;
+    return true;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef VIEWCBOR_H
+#define VIEWCBOR_H
+
+#include <Cutelyst/view.h>
+
+namespace Cutelyst {
+
+class ViewCborPrivate;
+/**
+ * Renders the stash as an application/cbor response,
+ * a binary alternative to ViewJson for clients that
+ * decode CBOR.
+ */
+class ViewCbor : public Cutelyst::View
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(ViewCbor)
+public:
+    explicit ViewCbor(Application *app = 0);
+    virtual ~ViewCbor();
+
+    enum ExposeMode {
+        All,
+        String,
+        StringList,
+        RegularExpression
+    };
+
+    /**
+     * Returns the expose mode of the stash keys,
+     * defaults to everything (All)
+     */
+    ExposeMode exposeStashMode() const;
+
+    /**
+     * Specify which stash key is exposed as a CBOR response,
+     * this will change exposeStashMode() to ViewCbor::String
+     */
+    void setExposeStashString(const QString &key);
+
+    /**
+     * Specify which stash keys are exposed as a CBOR response,
+     * this will change exposeStashMode() to ViewCbor::StringList
+     */
+    void setExposeStashStringList(const QStringList &keys);
+
+    /**
+     * Specify which stash keys are exposed as a CBOR response,
+     * this will change exposeStashMode() to ViewCbor::RegularExpression
+     */
+    void setExposeStashRegularExpression(const QRegularExpression &re);
+
+    virtual bool render(Cutelyst::Context *c) const Q_DECL_FINAL;
+
+protected:
+    ViewCborPrivate *d_ptr;
+};
+
+}
+
+#endif // VIEWCBOR_H
@@ -21,9 +21,15 @@
 
 #include <Cutelyst/context.h>
 #include <Cutelyst/response.h>
+#include <Cutelyst/segmentedbuffer.h>
 
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonValue>
+
+#include <algorithm>
+#include <limits>
 
 using namespace Cutelyst;
 
@@ -94,30 +100,25 @@ bool ViewJson::render(Context *c) const
 {
     Q_D(const ViewJson);
 
-    QJsonDocument document;
-
     const QVariantHash &stash = c->stash();
+    // A map keeps the keys sorted like QJsonObject does
+    QVariantMap exposed;
 
-    // TODO once 5.5 is out and we depend on it use QJsonObject::fromVariantHash
-    QVariantMap workaround;
     switch (d->exposeMode) {
     case All:
     {
         QVariantHash::ConstIterator it = stash.constBegin();
         while (it != stash.constEnd()) {
-            workaround.insert(it.key(), it.value());
+            exposed.insert(it.key(), it.value());
             ++it;
         }
-        document.setObject(QJsonObject::fromVariantMap(workaround));
         break;
     }
     case String:
     {
         QVariantHash::ConstIterator it = stash.constFind(d->exposeKey);
         if (it != stash.constEnd()) {
-            QJsonObject obj;
-            obj.insert(d->exposeKey, QJsonValue::fromVariant(it.value()));
-            document.setObject(obj);
+            exposed.insert(d->exposeKey, it.value());
         }
         break;
     }
@@ -127,11 +128,10 @@ bool ViewJson::render(Context *c) const
         while (it != stash.constEnd()) {
             const QString &key = it.key();
             if (d->exposeKeys.contains(key)) {
-                workaround.insert(it.key(), it.value());
+                exposed.insert(key, it.value());
             }
             ++it;
         }
-        document.setObject(QJsonObject::fromVariantMap(workaround));
         break;
     }
     case RegularExpression:
@@ -140,11 +140,10 @@ bool ViewJson::render(Context *c) const
         while (it != stash.constEnd()) {
             const QString &key = it.key();
             if (d->exposeRE.match(key).hasMatch()) {
-                workaround.insert(key, it.value());
+                exposed.insert(key, it.value());
             }
             ++it;
         }
-        document.setObject(QJsonObject::fromVariantMap(workaround));
         break;
     }
     }
@@ -152,7 +151,401 @@ bool ViewJson::render(Context *c) const
     Response *res = c->response();
     res->setContentType(QStringLiteral("application/json; charset=utf-8"));
 
-    res->body() = document.toJson(d->format);
+    bool streaming = false;
+    const int producerType = qMetaTypeId<ViewJsonListProducer>();
+    Q_FOREACH (const QVariant &value, exposed) {
+        if (value.userType() == producerType) {
+            streaming = true;
+            break;
+        }
+    }
+
+    if (streaming) {
+        // Written as it's produced, the body is left empty
+        res->setBody(0);
+        JsonWriter writer(0, res, d->format == QJsonDocument::Indented);
+        writer.writeValue(exposed);
+    } else {
+        SegmentedBuffer *body = res->bodyBuffer();
+        body->clear();
+        JsonWriter writer(body, 0, d->format == QJsonDocument::Indented);
+        writer.writeValue(exposed);
+    }
 
     return true;
 }
+
+#define JSONWRITER_BUFFER_SIZE (16 * 1024)
+
+JsonWriter::JsonWriter(SegmentedBuffer *buffer, Response *response, bool indented)
+    : m_segmented(buffer)
+    , m_response(response)
+    , m_indented(indented)
+{
+    // Reserved so that flushing keeps the allocation
+    m_buffer.reserve(JSONWRITER_BUFFER_SIZE + 1024);
+}
+
+JsonWriter::~JsonWriter()
+{
+    if (m_indented) {
+        // Like QJsonDocument::toJson()
+        append("\n", 1);
+    }
+    flush();
+}
+
+void JsonWriter::writeValue(const QVariant &value, int indent)
+{
+    switch (value.userType()) {
+    case QMetaType::UnknownType:
+    case QMetaType::Void:
+    case QMetaType::Nullptr:
+        append("null", 4);
+        break;
+    case QMetaType::Bool:
+        if (value.toBool()) {
+            append("true", 4);
+        } else {
+            append("false", 5);
+        }
+        break;
+    case QMetaType::Int:
+    case QMetaType::Short:
+    case QMetaType::Long:
+    case QMetaType::LongLong:
+    case QMetaType::Char:
+    case QMetaType::SChar:
+    case QMetaType::UInt:
+    case QMetaType::UShort:
+    case QMetaType::ULong:
+    case QMetaType::UChar:
+        writeInteger(value.toLongLong());
+        break;
+    case QMetaType::ULongLong:
+    {
+        const QByteArray number = QByteArray::number(value.toULongLong());
+        append(number.constData(), number.size());
+        break;
+    }
+    case QMetaType::Double:
+    case QMetaType::Float:
+        writeNumber(value.toDouble());
+        break;
+    case QMetaType::QString:
+        writeString(value.toString());
+        break;
+    case QMetaType::QByteArray:
+        writeString(QString::fromUtf8(value.toByteArray()));
+        break;
+    case QMetaType::QStringList:
+    {
+        const QStringList list = value.toStringList();
+        writeStart('[');
+        for (int i = 0; i < list.size(); ++i) {
+            writeSeparator(i, indent + 1);
+            writeString(list.at(i));
+        }
+        writeEnd(']', list.size(), indent);
+        break;
+    }
+    case QMetaType::QVariantList:
+    {
+        const QVariantList list = value.toList();
+        writeStart('[');
+        for (int i = 0; i < list.size(); ++i) {
+            writeSeparator(i, indent + 1);
+            writeValue(list.at(i), indent + 1);
+            maybeFlush();
+        }
+        writeEnd(']', list.size(), indent);
+        break;
+    }
+    case QMetaType::QVariantMap:
+    {
+        const QVariantMap map = value.toMap();
+        writeStart('{');
+        int i = 0;
+        QVariantMap::ConstIterator it = map.constBegin();
+        while (it != map.constEnd()) {
+            writeSeparator(i++, indent + 1);
+            writeKey(it.key());
+            writeValue(it.value(), indent + 1);
+            maybeFlush();
+            ++it;
+        }
+        writeEnd('}', map.size(), indent);
+        break;
+    }
+    case QMetaType::QVariantHash:
+    {
+        const QVariantHash hash = value.toHash();
+        QStringList keys = hash.keys();
+        std::sort(keys.begin(), keys.end());
+        writeStart('{');
+        for (int i = 0; i < keys.size(); ++i) {
+            const QString &key = keys.at(i);
+            writeSeparator(i, indent + 1);
+            writeKey(key);
+            writeValue(hash.value(key), indent + 1);
+            maybeFlush();
+        }
+        writeEnd('}', keys.size(), indent);
+        break;
+    }
+    case QMetaType::QJsonValue:
+        writeJsonValue(value.toJsonValue(), indent);
+        break;
+    case QMetaType::QJsonObject:
+        writeJsonValue(value.toJsonObject(), indent);
+        break;
+    case QMetaType::QJsonArray:
+        writeJsonValue(value.toJsonArray(), indent);
+        break;
+    case QMetaType::QJsonDocument:
+    {
+        const QJsonDocument doc = value.toJsonDocument();
+        if (doc.isArray()) {
+            writeJsonValue(doc.array(), indent);
+        } else if (doc.isObject()) {
+            writeJsonValue(doc.object(), indent);
+        } else {
+            append("null", 4);
+        }
+        break;
+    }
+    default:
+        if (value.userType() == qMetaTypeId<ViewJsonListProducer>()) {
+            ViewJsonListProducer producer = value.value<ViewJsonListProducer>();
+            writeStart('[');
+            int i = 0;
+            QVariant item;
+            while (producer && producer(item)) {
+                writeSeparator(i++, indent + 1);
+                writeValue(item, indent + 1);
+                item.clear();
+                maybeFlush();
+            }
+            writeEnd(']', i, indent);
+        } else if (value.canConvert<QString>()) {
+            // Same fallback as QJsonValue::fromVariant()
+            writeString(value.toString());
+        } else {
+            append("null", 4);
+        }
+    }
+}
+
+void JsonWriter::writeJsonValue(const QJsonValue &value, int indent)
+{
+    switch (value.type()) {
+    case QJsonValue::Bool:
+        if (value.toBool()) {
+            append("true", 4);
+        } else {
+            append("false", 5);
+        }
+        break;
+    case QJsonValue::Double:
+        writeNumber(value.toDouble());
+        break;
+    case QJsonValue::String:
+        writeString(value.toString());
+        break;
+    case QJsonValue::Array:
+    {
+        const QJsonArray array = value.toArray();
+        writeStart('[');
+        for (int i = 0; i < array.size(); ++i) {
+            writeSeparator(i, indent + 1);
+            writeJsonValue(array.at(i), indent + 1);
+            maybeFlush();
+        }
+        writeEnd(']', array.size(), indent);
+        break;
+    }
+    case QJsonValue::Object:
+    {
+        const QJsonObject object = value.toObject();
+        writeStart('{');
+        int i = 0;
+        QJsonObject::ConstIterator it = object.constBegin();
+        while (it != object.constEnd()) {
+            writeSeparator(i++, indent + 1);
+            writeKey(it.key());
+            writeJsonValue(it.value(), indent + 1);
+            maybeFlush();
+            ++it;
+        }
+        writeEnd('}', object.size(), indent);
+        break;
+    }
+    default:
+        append("null", 4);
+    }
+}
+
+void JsonWriter::writeStart(char open)
+{
+    append(&open, 1);
+    if (m_indented) {
+        append("\n", 1);
+    }
+}
+
+void JsonWriter::writeEnd(char close, int count, int indent)
+{
+    // Same layout as QJsonDocument::Indented
+    if (m_indented) {
+        if (count) {
+            append("\n", 1);
+        }
+        writeIndent(indent);
+    }
+    append(&close, 1);
+}
+
+void JsonWriter::writeSeparator(int index, int indent)
+{
+    if (index) {
+        if (m_indented) {
+            append(",\n", 2);
+        } else {
+            append(",", 1);
+        }
+    }
+    writeIndent(indent);
+}
+
+void JsonWriter::writeKey(const QString &key)
+{
+    writeString(key);
+    if (m_indented) {
+        append(": ", 2);
+    } else {
+        append(":", 1);
+    }
+}
+
+void JsonWriter::writeIndent(int indent)
+{
+    if (m_indented) {
+        for (int i = 0; i < indent; ++i) {
+            append("    ", 4);
+        }
+    }
+}
+
+void JsonWriter::writeInteger(qint64 value)
+{
+    char number[24];
+    const int len = snprintf(number, sizeof(number), "%lld", static_cast<long long>(value));
+    append(number, len);
+}
+
+void JsonWriter::writeNumber(double value)
+{
+    if (qIsFinite(value)) {
+        // Same precision as QJsonDocument
+        const QByteArray number = QByteArray::number(value, 'g', std::numeric_limits<double>::digits10 + 2);
+        append(number.constData(), number.size());
+    } else {
+        append("null", 4);
+    }
+}
+
+void JsonWriter::writeString(const QString &string)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    append("\"", 1);
+
+    const ushort *src = reinterpret_cast<const ushort *>(string.constData());
+    const ushort *end = src + string.size();
+    while (src != end) {
+        // Encodes in slices, at most 6 bytes per UTF-16 unit
+        int slice = qMin<int>(end - src, 4096);
+        if (slice < end - src && QChar::isHighSurrogate(src[slice - 1])) {
+            --slice;
+        }
+        const ushort *sliceEnd = src + slice;
+
+        int pos = m_buffer.size();
+        m_buffer.resize(pos + slice * 6);
+        char *out = m_buffer.data() + pos;
+        while (src != sliceEnd) {
+            uint u = *src++;
+            if (u < 0x80) {
+                if (u >= 0x20 && u != '"' && u != '\\') {
+                    *out++ = char(u);
+                    continue;
+                }
+                *out++ = '\\';
+                switch (u) {
+                case '"':  *out++ = '"'; break;
+                case '\\': *out++ = '\\'; break;
+                case '\b': *out++ = 'b'; break;
+                case '\f': *out++ = 'f'; break;
+                case '\n': *out++ = 'n'; break;
+                case '\r': *out++ = 'r'; break;
+                case '\t': *out++ = 't'; break;
+                default:
+                    *out++ = 'u';
+                    *out++ = '0';
+                    *out++ = '0';
+                    *out++ = hex[u >> 4];
+                    *out++ = hex[u & 0xf];
+                }
+            } else if (u < 0x800) {
+                *out++ = char(0xc0 | (u >> 6));
+                *out++ = char(0x80 | (u & 0x3f));
+            } else {
+                if (QChar::isSurrogate(u)) {
+                    if (QChar::isHighSurrogate(u) && src != sliceEnd && QChar::isLowSurrogate(*src)) {
+                        u = QChar::surrogateToUcs4(ushort(u), *src++);
+                        *out++ = char(0xf0 | (u >> 18));
+                        *out++ = char(0x80 | ((u >> 12) & 0x3f));
+                        *out++ = char(0x80 | ((u >> 6) & 0x3f));
+                        *out++ = char(0x80 | (u & 0x3f));
+                        continue;
+                    }
+                    // Lone surrogate
+                    u = QChar::ReplacementCharacter;
+                }
+                *out++ = char(0xe0 | (u >> 12));
+                *out++ = char(0x80 | ((u >> 6) & 0x3f));
+                *out++ = char(0x80 | (u & 0x3f));
+            }
+        }
+        m_buffer.resize(out - m_buffer.constData());
+        maybeFlush();
+    }
+
+    append("\"", 1);
+}
+
+inline void JsonWriter::append(const char *data, int len)
+{
+    m_buffer.append(data, len);
+}
+
+void JsonWriter::maybeFlush()
+{
+    if (m_buffer.size() >= JSONWRITER_BUFFER_SIZE) {
+        flush();
+    }
+}
+
+void JsonWriter::flush()
+{
+    if (m_buffer.isEmpty()) {
+        return;
+    }
+
+    if (m_segmented) {
+        m_segmented->append(m_buffer.constData(), m_buffer.size());
+    } else {
+        m_response->write(m_buffer.constData(), m_buffer.size());
+    }
+    m_buffer.resize(0);
+}
@@ -22,12 +22,37 @@
 
 #include <Cutelyst/view.h>
 
+#include <functional>
+
 namespace Cutelyst {
 
+/**
+ * Produces the items of a JSON array one at a time, setting
+ * \p item and returning true, or false when there are no more.
+ *
+ * Stash values holding a producer make ViewJson send the
+ * response while the items are generated, with chunked
+ * transfer-encoding, so huge lists are never fully in memory:
+ * \code
+ * c->setStash("rows", QVariant::fromValue(ViewJsonListProducer([query] (QVariant &item) mutable {
+ *     if (!query.next()) {
+ *         return false;
+ *     }
+ *     item = query.value(0);
+ *     return true;
+ * })));
+ * \endcode
+ */
+typedef std::function<bool (QVariant &item)> ViewJsonListProducer;
+
 class ViewJsonPrivate;
 /**
  * ViewJSON class is a Cutelyst View handler that returns stash
  * data in JSON format.
+ *
+ * Values are serialized straight into the response body
+ * without building a QJsonDocument first, QVariantHash keys
+ * are sorted so the output matches QJsonDocument.
  */
 class ViewJson : public Cutelyst::View
 {
@@ -91,4 +116,6 @@ protected:
 
 }
 
+Q_DECLARE_METATYPE(Cutelyst::ViewJsonListProducer)
+
 #endif // VIEWJSON_H
@@ -28,6 +28,42 @@
 
 namespace Cutelyst {
 
+class Response;
+class SegmentedBuffer;
+
+/**
+ * Writes UTF-8 JSON to a SegmentedBuffer, or with
+ * Response::write() when streaming, through a small
+ * buffer that is flushed as it fills
+ */
+class JsonWriter
+{
+public:
+    JsonWriter(SegmentedBuffer *buffer, Response *response, bool indented);
+    ~JsonWriter();
+
+    void writeValue(const QVariant &value, int indent = 0);
+
+private:
+    void writeJsonValue(const QJsonValue &value, int indent);
+    void writeStart(char open);
+    void writeEnd(char close, int count, int indent);
+    void writeSeparator(int index, int indent);
+    void writeKey(const QString &key);
+    void writeIndent(int indent);
+    void writeInteger(qint64 value);
+    void writeNumber(double value);
+    void writeString(const QString &string);
+    inline void append(const char *data, int len);
+    void maybeFlush();
+    void flush();
+
+    SegmentedBuffer *m_segmented;
+    Response *m_response;
+    QByteArray m_buffer;
+    bool m_indented;
+};
+
 class ViewJsonPrivate
 {
 public:
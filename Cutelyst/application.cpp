@@ -32,6 +32,10 @@
 #include "view.h"
 #include "stats.h"
 #include "utils.h"
+#include "routecache_p.h"
+#include "hostnamecache_p.h"
+#include "jsonstreamreader.h"
+#include "bodydecoder_p.h"
 
 #include "Actions/actionrest.h"
 #include "Actions/roleacl.h"
@@ -73,10 +77,16 @@ Application::Application(QObject *parent) :
     qRegisterMetaType<RenderView *>();
 
     d->dispatcher = new Dispatcher(this);
+
+    registerBodyDecoder(QStringLiteral("application/x-www-form-urlencoded"), new BodyDecoderUrlEncoded);
+    registerBodyDecoder(QStringLiteral("multipart/form-data"), new BodyDecoderMultiPart);
+    registerBodyDecoder(QStringLiteral("application/json"), new BodyDecoderJson);
+    registerBodyDecoder(QStringLiteral("application/cbor"), new BodyDecoderCbor);
 }
 
 Application::~Application()
 {
+    qDeleteAll(d_ptr->bodyDecoders);
     delete d_ptr;
 }
 
@@ -150,6 +160,33 @@ void Application::registerDispatcher(DispatchType *dispatcher)
     d->dispatcher->registerDispatchType(dispatcher);
 }
 
+void Application::registerBodyDecoder(const QString &contentType, BodyDecoder *decoder)
+{
+    Q_D(Application);
+    const QString key = contentType.toLower();
+    delete d->bodyDecoders.value(key);
+    d->bodyDecoders.insert(key, decoder);
+}
+
+BodyDecoder *Application::bodyDecoder(const QString &contentType) const
+{
+    Q_D(const Application);
+    QHash<QString, BodyDecoder *>::ConstIterator it = d->bodyDecoders.constFind(contentType);
+    if (it != d->bodyDecoders.constEnd()) {
+        return it.value();
+    }
+
+    // Structured syntax suffixes (RFC 6839), ie application/problem+json
+    int plus = contentType.lastIndexOf(QLatin1Char('+'));
+    if (plus != -1) {
+        int slash = contentType.indexOf(QLatin1Char('/'));
+        if (slash != -1 && slash < plus) {
+            return d->bodyDecoders.value(contentType.leftRef(slash + 1) % contentType.midRef(plus + 1));
+        }
+    }
+    return 0;
+}
+
 QVariant Application::config(const QString &key, const QVariant &defaultValue) const
 {
     Q_D(const Application);
@@ -219,12 +256,17 @@ bool Application::setup(Engine *engine)
     // Call the virtual application init
     // to setup Controllers plugins stuff
     if (init()) {
+        // Building the tables is not cheap with
+        // many components so only do it if they are shown
+        bool showTables = CUTELYST_CORE().isDebugEnabled();
         QString appName = QCoreApplication::applicationName();
 
         QList<QStringList> tablePlugins;
         Q_FOREACH (Plugin *plugin, d->plugins) {
-            QString className = QString::fromLatin1(plugin->metaObject()->className());
-            tablePlugins.append({ className });
+            if (showTables) {
+                QString className = QString::fromLatin1(plugin->metaObject()->className());
+                tablePlugins.append({ className });
+            }
             // Configure plugins
             plugin->setup(this);
         }
@@ -234,12 +276,16 @@ bool Application::setup(Engine *engine)
                                                         QStringLiteral("Loaded plugins:")).data();
         }
 
-        QList<QStringList> tableDataHandlers;
-        tableDataHandlers.append({ QLatin1String("application/x-www-form-urlencoded") });
-        tableDataHandlers.append({ QLatin1String("application/json") });
-        tableDataHandlers.append({ QLatin1String("multipart/form-data") });
-        qCDebug(CUTELYST_CORE) << Utils::buildTable(tableDataHandlers, QStringList(),
-                                                    QStringLiteral("Loaded Request Data Handlers:")).data();
+        if (showTables) {
+            QList<QStringList> tableDataHandlers;
+            QStringList contentTypes = d->bodyDecoders.keys();
+            contentTypes.sort();
+            Q_FOREACH (const QString &contentType, contentTypes) {
+                tableDataHandlers.append({ contentType });
+            }
+            qCDebug(CUTELYST_CORE) << Utils::buildTable(tableDataHandlers, QStringList(),
+                                                        QStringLiteral("Loaded Request Data Handlers:")).data();
+        }
 
         qCDebug(CUTELYST_CORE) << "Loaded dispatcher" << QString::fromLatin1(d->dispatcher->metaObject()->className());
         qCDebug(CUTELYST_CORE) << "Using engine" << QString::fromLatin1(d->engine->metaObject()->className());
@@ -256,33 +302,51 @@ bool Application::setup(Engine *engine)
             }
         }
 
-        QList<QStringList> table;
-        Q_FOREACH (Controller *controller, d->controllers) {
-            QString className = QString::fromLatin1(controller->metaObject()->className());
-            if (!className.startsWith(QLatin1String("Cutelyst"))) {
-                className = appName % QLatin1String("::Controller::") % className;
+        if (showTables) {
+            QList<QStringList> table;
+            Q_FOREACH (Controller *controller, d->controllers) {
+                QString className = QString::fromLatin1(controller->metaObject()->className());
+                if (!className.startsWith(QLatin1String("Cutelyst"))) {
+                    className = appName % QLatin1String("::Controller::") % className;
+                }
+                table.append({ className, QStringLiteral("instance")});
             }
-            table.append({ className, QStringLiteral("instance")});
-        }
 
-        Q_FOREACH (View *view, d->views) {
-            QString className = QString::fromLatin1(view->metaObject()->className());
-            if (!className.startsWith(QLatin1String("Cutelyst"))) {
-                className = appName % QLatin1String("::View::") % className;
+            Q_FOREACH (View *view, d->views) {
+                QString className = QString::fromLatin1(view->metaObject()->className());
+                if (!className.startsWith(QLatin1String("Cutelyst"))) {
+                    className = appName % QLatin1String("::View::") % className;
+                }
+                table.append({ className, QStringLiteral("instance")});
             }
-            table.append({ className, QStringLiteral("instance")});
-        }
 
-        if (!table.isEmpty()) {
-            qCDebug(CUTELYST_CORE) << Utils::buildTable(table, {
-                                                            QStringLiteral("Class"), QStringLiteral("Type")
-                                                        },
-                                                        QStringLiteral("Loaded components:")).data();
+            if (!table.isEmpty()) {
+                qCDebug(CUTELYST_CORE) << Utils::buildTable(table, {
+                                                                QStringLiteral("Class"), QStringLiteral("Type")
+                                                            },
+                                                            QStringLiteral("Loaded components:")).data();
+            }
         }
 
+        // Reverse DNS cache used by Request::hostname()
+        HostnameCache::setMaxSize(d->config.value("hostname_cache_size", 4096).toInt());
+        HostnameCache::setTtl(d->config.value("hostname_cache_ttl", 3600).toInt(),
+                              d->config.value("hostname_cache_negative_ttl", 300).toInt());
+
+        // Limits of JSON request bodies, 0 disables the size and
+        // elements limits, the depth can't be disabled
+        JsonStreamReader::setDefaultLimits(d->config.value("json_max_size", 0).toLongLong(),
+                                           d->config.value("json_max_depth", 512).toInt(),
+                                           d->config.value("json_max_elements", 0).toLongLong());
+
+        // Optional cache of parsed action attributes, set
+        // with route_cache=<file> on the [Cutelyst] section
+        RouteCache routeCache(d->config.value("route_cache").toString(), this);
+
         Q_FOREACH (Controller *controller, d->controllers) {
-            controller->d_ptr->init(this, d->dispatcher);
+            controller->d_ptr->init(this, d->dispatcher, &routeCache);
         }
+        routeCache.save();
 
         d->dispatcher->setupActions(d->controllers);
         d->init = true;
@@ -405,12 +469,12 @@ void Cutelyst::ApplicationPrivate::logRequest(Request *req)
     }
     qCDebug(CUTELYST_REQUEST) << req->method() << "request for" << path << "from" << req->address().toString();
 
-    ParamsMultiMap params = req->queryParameters();
+    ParamsFlatMap params = req->queryParametersFlat();
     if (!params.isEmpty()) {
         logRequestParameters(params, QStringLiteral("Query Parameters are:"));
     }
 
-    params = req->bodyParameters();
+    params = req->bodyParametersFlat();
     if (!params.isEmpty()) {
         logRequestParameters(params, QStringLiteral("Body Parameters are:"));
     }
@@ -421,11 +485,11 @@ void Cutelyst::ApplicationPrivate::logRequest(Request *req)
     }
 }
 
-void Cutelyst::ApplicationPrivate::logRequestParameters(const ParamsMultiMap &params, const QString &title)
+void Cutelyst::ApplicationPrivate::logRequestParameters(const ParamsFlatMap &params, const QString &title)
 {
 
     QList<QStringList> table;
-    ParamsMultiMap::ConstIterator it = params.constBegin();
+    ParamsFlatMap::ConstIterator it = params.constBegin();
     while (it != params.constEnd()) {
         table.append({ it.key(), it.value() });
         ++it;
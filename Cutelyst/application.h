@@ -39,6 +39,7 @@ class Response;
 class Engine;
 class Plugin;
 class Headers;
+class BodyDecoder;
 class ApplicationPrivate;
 class Application : public QObject
 {
@@ -89,6 +90,22 @@ public:
 
     Engine *engine() const;
 
+    /**
+     * Registers \p decoder for request bodies of \p contentType,
+     * replacing the decoder previously registered for it, the
+     * Application takes ownership of the decoder.
+     *
+     * Content types with a structured syntax suffix like
+     * application/vnd.api+json fallback to application/json.
+     */
+    void registerBodyDecoder(const QString &contentType, BodyDecoder *decoder);
+
+    /**
+     * Returns the decoder used for request bodies of \p contentType
+     * or 0 if there is none
+     */
+    BodyDecoder *bodyDecoder(const QString &contentType) const;
+
 protected:
     /**
      * Do your application initialization here, if your
@@ -184,6 +201,14 @@ Q_SIGNALS:
      */
     void afterDispatch(Context *c);
 
+    /**
+     * This signal is emitted before the response headers
+     * are finalized, at the end of the request or before
+     * the first Response::write(), plugins can still change
+     * the headers, the body and set a body encoder.
+     */
+    void beforeFinalizeHeaders(Context *c);
+
 protected:
     /**
      * Change the value of the configuration key
@@ -34,7 +34,7 @@ public:
     void setupHome();
 
     void logRequest(Request *req);
-    void logRequestParameters(const ParamsMultiMap &params, const QString &title);
+    void logRequestParameters(const ParamsFlatMap &params, const QString &title);
     void logRequestUploads(const QMap<QString, Upload *> &uploads);
 
     bool init = false;
@@ -42,6 +42,7 @@ public:
     QList<Plugin *> plugins;
     QList<Controller *> controllers;
     QHash<QString, View *> views;
+    QHash<QString, BodyDecoder *> bodyDecoders;
     Headers headers;
     QVariantHash config;
     bool useStats;
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "bodydecoder_p.h"
+
+#include "common.h"
+#include "cbor_p.h"
+#include "engine.h"
+#include "request.h"
+#include "request_p.h"
+#include "multipartformdataparser.h"
+#include "jsonstreamreader.h"
+
+#include <QtCore/QIODevice>
+
+using namespace Cutelyst;
+
+BodyDecoder::~BodyDecoder()
+{
+}
+
+void BodyDecoder::decodeParameters(const Request *request, QIODevice *body, ParamsFlatMap &params, QMap<QString, Upload *> &uploads) const
+{
+    Q_UNUSED(request)
+    Q_UNUSED(body)
+    Q_UNUSED(params)
+    Q_UNUSED(uploads)
+}
+
+QVariant BodyDecoder::decodeData(const Request *request, QIODevice *body, const ParamsFlatMap &params) const
+{
+    Q_UNUSED(request)
+    Q_UNUSED(body)
+    Q_UNUSED(params)
+    return QVariant();
+}
+
+void BodyDecoderUrlEncoded::decodeParameters(const Request *request, QIODevice *body, ParamsFlatMap &params, QMap<QString, Upload *> &uploads) const
+{
+    Q_UNUSED(request)
+    Q_UNUSED(uploads)
+    // Parse the query (BODY) of type "application/x-www-form-urlencoded"
+    // parameters ie "?foo=bar&bar=baz"
+    params = RequestPrivate::parseUrlEncoded(body->readLine());
+}
+
+QVariant BodyDecoderUrlEncoded::decodeData(const Request *request, QIODevice *body, const ParamsFlatMap &params) const
+{
+    Q_UNUSED(request)
+    Q_UNUSED(body)
+    // Only converted to a ParamsMultiMap when asked
+    return QVariant::fromValue(params.toMap());
+}
+
+void BodyDecoderMultiPart::decodeParameters(const Request *request, QIODevice *body, ParamsFlatMap &params, QMap<QString, Upload *> &uploads) const
+{
+    Q_UNUSED(params)
+    Uploads uploadList = MultiPartFormDataParser::parse(body,
+                                                        request->header(QStringLiteral("content_type")),
+                                                        64 * 1024,
+                                                        request->engine()->maxUploads());
+    for (int i = uploadList.size() - 1; i >= 0; --i) {
+        Upload *upload = uploadList.at(i);
+        uploads.insertMulti(upload->name(), upload);
+    }
+}
+
+QVariant BodyDecoderJson::decodeData(const Request *request, QIODevice *body, const ParamsFlatMap &params) const
+{
+    Q_UNUSED(request)
+    Q_UNUSED(params)
+    // Streams the body instead of reading it all in memory
+    JsonStreamReader reader(body);
+    const QJsonDocument doc = reader.readDocument();
+    if (reader.error() != JsonStreamReader::NoError) {
+        qCWarning(CUTELYST_REQUEST) << "Failed to parse JSON body:" << reader.errorString();
+    }
+    return doc;
+}
+
+QVariant BodyDecoderCbor::decodeData(const Request *request, QIODevice *body, const ParamsFlatMap &params) const
+{
+    Q_UNUSED(request)
+    Q_UNUSED(params)
+    QString error;
+    const QVariant ret = Cbor::read(body->readAll(), &error);
+    if (!error.isEmpty()) {
+        qCWarning(CUTELYST_REQUEST) << "Failed to parse CBOR body:" << error;
+    }
+    return ret;
+}
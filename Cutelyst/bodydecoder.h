@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CUTELYST_BODYDECODER_H
+#define CUTELYST_BODYDECODER_H
+
+#include <Cutelyst/paramsflatmap.h>
+
+#include <QtCore/QVariant>
+
+class QIODevice;
+
+namespace Cutelyst {
+
+class Request;
+class Upload;
+/**
+ * Decodes request bodies of a content type, decoders are
+ * registered with Application::registerBodyDecoder().
+ *
+ * The built-in decoders handle application/x-www-form-urlencoded,
+ * multipart/form-data, application/json and application/cbor.
+ *
+ * The body is always positioned at the beginning when a
+ * method is called, and restored afterwards.
+ */
+class BodyDecoder
+{
+public:
+    virtual ~BodyDecoder();
+
+    /**
+     * Called the first time the body parameters or uploads
+     * of \p request are accessed, the default does nothing.
+     */
+    virtual void decodeParameters(const Request *request, QIODevice *body, ParamsFlatMap &params, QMap<QString, Upload *> &uploads) const;
+
+    /**
+     * Called the first time Request::bodyData() is called,
+     * after decodeParameters(), \p params holds the parameters
+     * it decoded. The default returns an invalid QVariant.
+     */
+    virtual QVariant decodeData(const Request *request, QIODevice *body, const ParamsFlatMap &params) const;
+};
+
+}
+
+#endif // CUTELYST_BODYDECODER_H
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CUTELYST_BODYDECODER_P_H
+#define CUTELYST_BODYDECODER_P_H
+
+#include "bodydecoder.h"
+
+namespace Cutelyst {
+
+class BodyDecoderUrlEncoded : public BodyDecoder
+{
+public:
+    virtual void decodeParameters(const Request *request, QIODevice *body, ParamsFlatMap &params, QMap<QString, Upload *> &uploads) const Q_DECL_OVERRIDE;
+    virtual QVariant decodeData(const Request *request, QIODevice *body, const ParamsFlatMap &params) const Q_DECL_OVERRIDE;
+};
+
+class BodyDecoderMultiPart : public BodyDecoder
+{
+public:
+    virtual void decodeParameters(const Request *request, QIODevice *body, ParamsFlatMap &params, QMap<QString, Upload *> &uploads) const Q_DECL_OVERRIDE;
+};
+
+class BodyDecoderJson : public BodyDecoder
+{
+public:
+    virtual QVariant decodeData(const Request *request, QIODevice *body, const ParamsFlatMap &params) const Q_DECL_OVERRIDE;
+};
+
+class BodyDecoderCbor : public BodyDecoder
+{
+public:
+    virtual QVariant decodeData(const Request *request, QIODevice *body, const ParamsFlatMap &params) const Q_DECL_OVERRIDE;
+};
+
+}
+
+#endif // CUTELYST_BODYDECODER_P_H
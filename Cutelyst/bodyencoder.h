@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CUTELYST_BODYENCODER_H
+#define CUTELYST_BODYENCODER_H
+
+#include <QtCore/QByteArray>
+
+namespace Cutelyst {
+
+/**
+ * Transforms the response body as the engine writes it,
+ * like compressing it, set with Response::setBodyEncoder().
+ *
+ * The response is sent with chunked transfer-encoding since
+ * the encoded size is not known in advance.
+ */
+class BodyEncoder
+{
+public:
+    virtual ~BodyEncoder();
+
+    /**
+     * Encodes \p len bytes of \p data appending the result
+     * to \p output, which may be left empty if the encoder
+     * needs more data. Returns false on failure.
+     */
+    virtual bool encode(const char *data, qint64 len, QByteArray &output) = 0;
+
+    /**
+     * Called once after the last data is encoded,
+     * appends what is still pending to \p output
+     */
+    virtual bool finish(QByteArray &output) = 0;
+};
+
+}
+
+#endif // CUTELYST_BODYENCODER_H
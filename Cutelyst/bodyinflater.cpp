@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "bodyinflater_p.h"
+
+#include "common.h"
+
+#include <cstring>
+#include <limits>
+
+using namespace Cutelyst;
+
+BodyInflater::BodyInflater(QObject *parent) : QIODevice(parent)
+{
+    memset(&m_stream, 0, sizeof(m_stream));
+    m_input.resize(16 * 1024);
+}
+
+BodyInflater::~BodyInflater()
+{
+    if (m_streamInit) {
+        inflateEnd(&m_stream);
+    }
+}
+
+bool BodyInflater::setDevice(QIODevice *device, const QString &contentEncoding, qint64 maxSize)
+{
+    if (contentEncoding.compare(QLatin1String("gzip"), Qt::CaseInsensitive) == 0 ||
+            contentEncoding.compare(QLatin1String("x-gzip"), Qt::CaseInsensitive) == 0) {
+        m_gzip = true;
+    } else if (contentEncoding.compare(QLatin1String("deflate"), Qt::CaseInsensitive) == 0) {
+        m_gzip = false;
+    } else {
+        return false;
+    }
+
+    m_device = device;
+    m_maxSize = maxSize;
+    if (isOpen()) {
+        QIODevice::close();
+    }
+    // Unbuffered so that QIODevice doesn't read ahead of pos()
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    // Failures show up when reading
+    restart();
+    return true;
+}
+
+bool BodyInflater::isSequential() const
+{
+    // Makes readAll() read until the end as the size is unknown
+    return true;
+}
+
+qint64 BodyInflater::pos() const
+{
+    return m_pos;
+}
+
+bool BodyInflater::seek(qint64 off)
+{
+    if (off < m_pos && !restart()) {
+        return false;
+    }
+
+    // Forward seeks inflate and discard the data
+    char buffer[4096];
+    while (m_pos < off) {
+        qint64 len = readData(buffer, qMin(off - m_pos, qint64(sizeof(buffer))));
+        if (len <= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BodyInflater::atEnd() const
+{
+    return m_finished || m_failed;
+}
+
+void BodyInflater::close()
+{
+    if (m_streamInit) {
+        inflateEnd(&m_stream);
+        m_streamInit = false;
+    }
+    m_device = 0;
+    QIODevice::close();
+}
+
+qint64 BodyInflater::readData(char *data, qint64 maxlen)
+{
+    if (m_failed) {
+        return -1;
+    }
+
+    if (m_finished || maxlen <= 0) {
+        return 0;
+    }
+
+    m_stream.next_out = reinterpret_cast<Bytef *>(data);
+    m_stream.avail_out = uInt(qMin(maxlen, qint64(std::numeric_limits<uInt>::max())));
+    const uInt availOut = m_stream.avail_out;
+
+    // Loop until something is produced since zlib
+    // might consume a whole input buffer of headers
+    while (m_stream.avail_out == availOut) {
+        if (m_stream.avail_in == 0 && !fillInput()) {
+            return -1;
+        }
+
+        int ret = inflate(&m_stream, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            m_finished = true;
+            break;
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            return fail(QString::fromLatin1(m_stream.msg ? m_stream.msg : "Invalid compressed data"));
+        }
+    }
+
+    const qint64 produced = availOut - m_stream.avail_out;
+    m_pos += produced;
+    if (m_maxSize && m_pos > m_maxSize) {
+        return fail(QStringLiteral("Decompressed body exceeds the limit of %1 bytes").arg(m_maxSize));
+    }
+    return produced;
+}
+
+qint64 BodyInflater::writeData(const char *data, qint64 len)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(len)
+    return -1;
+}
+
+bool BodyInflater::restart()
+{
+    if (!m_device) {
+        return false;
+    }
+
+    if (m_streamInit) {
+        inflateEnd(&m_stream);
+        m_streamInit = false;
+    }
+    memset(&m_stream, 0, sizeof(m_stream));
+    m_pos = 0;
+    m_finished = false;
+    m_failed = false;
+
+    if (!m_device->seek(0)) {
+        fail(QStringLiteral("Failed to rewind the compressed body"));
+        return false;
+    }
+
+    int windowBits = MAX_WBITS + 16;
+    if (!m_gzip) {
+        // "deflate" is zlib wrapped (RFC 7230) but some
+        // clients send raw deflate data, check the header
+        char header[2];
+        if (m_device->peek(header, 2) == 2 &&
+                (uchar(header[0]) & 0x0f) == Z_DEFLATED &&
+                (uchar(header[0]) * 256 + uchar(header[1])) % 31 == 0) {
+            windowBits = MAX_WBITS;
+        } else {
+            windowBits = -MAX_WBITS;
+        }
+    }
+
+    if (inflateInit2(&m_stream, windowBits) != Z_OK) {
+        fail(QStringLiteral("Failed to initialize zlib"));
+        return false;
+    }
+    m_streamInit = true;
+    return true;
+}
+
+bool BodyInflater::fillInput()
+{
+    qint64 len = m_device->read(m_input.data(), m_input.size());
+    if (len < 0) {
+        fail(m_device->errorString());
+        return false;
+    } else if (len == 0) {
+        fail(QStringLiteral("Unexpected end of compressed body"));
+        return false;
+    }
+    m_stream.next_in = reinterpret_cast<Bytef *>(m_input.data());
+    m_stream.avail_in = uInt(len);
+    return true;
+}
+
+qint64 BodyInflater::fail(const QString &error)
+{
+    qCWarning(CUTELYST_REQUEST) << "Failed to inflate request body:" << error;
+    setErrorString(error);
+    m_failed = true;
+    return -1;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CUTELYST_BODYINFLATER_P_H
+#define CUTELYST_BODYINFLATER_P_H
+
+#include <QtCore/QIODevice>
+
+#include <zlib.h>
+
+namespace Cutelyst {
+
+/**
+ * Read-only device that inflates a gzip or deflate
+ * encoded request body as it is read.
+ *
+ * Only a small input buffer and the zlib state are kept
+ * in memory, seeking backwards restarts decompression and
+ * the decompressed size is unknown until the end is read.
+ */
+class BodyInflater : public QIODevice
+{
+    Q_OBJECT
+public:
+    explicit BodyInflater(QObject *parent = 0);
+    virtual ~BodyInflater();
+
+    /**
+     * Starts inflating \p device encoded with \p contentEncoding,
+     * reading fails once more than \p maxSize bytes are
+     * produced (0 means no limit).
+     *
+     * Returns false if the encoding is not supported.
+     */
+    bool setDevice(QIODevice *device, const QString &contentEncoding, qint64 maxSize);
+
+    virtual bool isSequential() const Q_DECL_OVERRIDE;
+    virtual qint64 pos() const Q_DECL_OVERRIDE;
+    virtual bool seek(qint64 off) Q_DECL_OVERRIDE;
+    virtual bool atEnd() const Q_DECL_OVERRIDE;
+    virtual void close() Q_DECL_OVERRIDE;
+
+protected:
+    virtual qint64 readData(char *data, qint64 maxlen) Q_DECL_OVERRIDE;
+    virtual qint64 writeData(const char *data, qint64 len) Q_DECL_OVERRIDE;
+
+private:
+    bool restart();
+    bool fillInput();
+    qint64 fail(const QString &error);
+
+    QIODevice *m_device = 0;
+    z_stream m_stream;
+    bool m_streamInit = false;
+    bool m_gzip = false;
+    bool m_finished = false;
+    bool m_failed = false;
+    qint64 m_pos = 0;
+    qint64 m_maxSize = 0;
+    QByteArray m_input;
+};
+
+}
+
+#endif // CUTELYST_BODYINFLATER_P_H
@@ -0,0 +1,523 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "cbor_p.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QStringList>
+#include <QtCore/QtEndian>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace Cutelyst;
+
+namespace {
+
+enum MajorType {
+    UnsignedInteger = 0,
+    NegativeInteger = 1,
+    ByteString = 2,
+    TextString = 3,
+    Array = 4,
+    Map = 5,
+    Tag = 6,
+    SimpleOrFloat = 7
+};
+
+// Additional information meaning an indefinite length item
+const int Indefinite = 31;
+const uchar Break = 0xff;
+
+class CborReader
+{
+public:
+    CborReader(const QByteArray &data, int maxDepth) :
+        m_data(reinterpret_cast<const uchar *>(data.constData())),
+        m_size(data.size()),
+        m_maxDepth(maxDepth)
+    {
+    }
+
+    QVariant readItem(int depth);
+    bool atEnd() const { return m_pos == m_size; }
+
+    QString errorString;
+
+private:
+    bool readHead(int &major, int &info, quint64 &value);
+    bool readLength(quint64 value, int &length);
+    bool readString(int major, int info, quint64 value, QByteArray &out);
+    QVariant fail(const QString &error);
+
+    const uchar *m_data;
+    int m_size;
+    int m_pos = 0;
+    int m_maxDepth;
+};
+
+QVariant CborReader::fail(const QString &error)
+{
+    if (errorString.isEmpty()) {
+        errorString = error;
+    }
+    return QVariant();
+}
+
+bool CborReader::readHead(int &major, int &info, quint64 &value)
+{
+    if (m_pos >= m_size) {
+        fail(QStringLiteral("Unexpected end of data"));
+        return false;
+    }
+
+    const uchar initial = m_data[m_pos++];
+    major = initial >> 5;
+    info = initial & 0x1f;
+
+    if (info < 24) {
+        value = info;
+        return true;
+    }
+
+    int bytes;
+    switch (info) {
+    case 24: bytes = 1; break;
+    case 25: bytes = 2; break;
+    case 26: bytes = 4; break;
+    case 27: bytes = 8; break;
+    case Indefinite:
+        if (major == UnsignedInteger || major == NegativeInteger || major == Tag) {
+            fail(QStringLiteral("Invalid indefinite length item"));
+            return false;
+        }
+        value = 0;
+        return true;
+    default:
+        fail(QStringLiteral("Invalid additional information"));
+        return false;
+    }
+
+    if (m_size - m_pos < bytes) {
+        fail(QStringLiteral("Unexpected end of data"));
+        return false;
+    }
+
+    value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        value = (value << 8) | m_data[m_pos++];
+    }
+    return true;
+}
+
+bool CborReader::readLength(quint64 value, int &length)
+{
+    // Every element takes at least one byte, this avoids
+    // allocating for lengths that can't be in the data
+    if (value > quint64(m_size - m_pos)) {
+        fail(QStringLiteral("Length exceeds the data size"));
+        return false;
+    }
+    length = int(value);
+    return true;
+}
+
+bool CborReader::readString(int major, int info, quint64 value, QByteArray &out)
+{
+    if (info != Indefinite) {
+        int length;
+        if (!readLength(value, length)) {
+            return false;
+        }
+        out.append(reinterpret_cast<const char *>(m_data + m_pos), length);
+        m_pos += length;
+        return true;
+    }
+
+    // Indefinite strings are a sequence of definite
+    // chunks of the same type ended by a break
+    while (m_pos < m_size && m_data[m_pos] != Break) {
+        int chunkMajor, chunkInfo;
+        quint64 chunkValue;
+        if (!readHead(chunkMajor, chunkInfo, chunkValue)) {
+            return false;
+        }
+        if (chunkMajor != major || chunkInfo == Indefinite) {
+            fail(QStringLiteral("Invalid indefinite string chunk"));
+            return false;
+        }
+        if (!readString(major, chunkInfo, chunkValue, out)) {
+            return false;
+        }
+    }
+
+    if (m_pos == m_size) {
+        fail(QStringLiteral("Unexpected end of data"));
+        return false;
+    }
+    ++m_pos;
+    return true;
+}
+
+double decodeHalf(quint16 half)
+{
+    const int exponent = (half >> 10) & 0x1f;
+    const int mantissa = half & 0x3ff;
+    double value;
+    if (exponent == 0) {
+        value = std::ldexp(mantissa, -24);
+    } else if (exponent != 31) {
+        value = std::ldexp(mantissa + 1024, exponent - 25);
+    } else {
+        value = mantissa == 0 ? qInf() : qQNaN();
+    }
+    return (half & 0x8000) ? -value : value;
+}
+
+QVariant CborReader::readItem(int depth)
+{
+    if (m_maxDepth && depth > m_maxDepth) {
+        return fail(QStringLiteral("Maximum depth exceeded"));
+    }
+
+    int major, info;
+    quint64 value;
+    if (!readHead(major, info, value)) {
+        return QVariant();
+    }
+
+    switch (major) {
+    case UnsignedInteger:
+        if (value > quint64(std::numeric_limits<qint64>::max())) {
+            return QVariant(value);
+        }
+        return QVariant(qint64(value));
+    case NegativeInteger:
+        if (value > quint64(std::numeric_limits<qint64>::max())) {
+            // Can't be represented as an integer
+            return QVariant(-1.0 - double(value));
+        }
+        return QVariant(-1 - qint64(value));
+    case ByteString:
+    {
+        QByteArray bytes;
+        if (!readString(major, info, value, bytes)) {
+            return QVariant();
+        }
+        return bytes;
+    }
+    case TextString:
+    {
+        QByteArray utf8;
+        if (!readString(major, info, value, utf8)) {
+            return QVariant();
+        }
+        return QString::fromUtf8(utf8);
+    }
+    case Array:
+    {
+        QVariantList list;
+        if (info == Indefinite) {
+            while (m_pos < m_size && m_data[m_pos] != Break) {
+                list.append(readItem(depth + 1));
+                if (!errorString.isEmpty()) {
+                    return QVariant();
+                }
+            }
+            if (m_pos == m_size) {
+                return fail(QStringLiteral("Unexpected end of data"));
+            }
+            ++m_pos;
+        } else {
+            int length;
+            if (!readLength(value, length)) {
+                return QVariant();
+            }
+            list.reserve(length);
+            for (int i = 0; i < length; ++i) {
+                list.append(readItem(depth + 1));
+                if (!errorString.isEmpty()) {
+                    return QVariant();
+                }
+            }
+        }
+        return list;
+    }
+    case Map:
+    {
+        QVariantMap map;
+        int length = -1;
+        if (info != Indefinite && !readLength(value, length)) {
+            return QVariant();
+        }
+        for (int i = 0; length == -1 || i < length; ++i) {
+            if (length == -1) {
+                if (m_pos == m_size) {
+                    return fail(QStringLiteral("Unexpected end of data"));
+                }
+                if (m_data[m_pos] == Break) {
+                    ++m_pos;
+                    break;
+                }
+            }
+
+            const QVariant key = readItem(depth + 1);
+            if (!errorString.isEmpty()) {
+                return QVariant();
+            }
+            const QVariant item = readItem(depth + 1);
+            if (!errorString.isEmpty()) {
+                return QVariant();
+            }
+            map.insert(key.toString(), item);
+        }
+        return map;
+    }
+    case Tag:
+    {
+        const QVariant item = readItem(depth + 1);
+        if (!errorString.isEmpty()) {
+            return QVariant();
+        }
+        if (value == 0 && item.type() == QVariant::String) {
+            // Standard date/time string
+            return QDateTime::fromString(item.toString(), Qt::ISODate);
+        } else if (value == 1 && item.canConvert<double>()) {
+            // Epoch-based date/time
+            return QDateTime::fromMSecsSinceEpoch(qint64(item.toDouble() * 1000), Qt::UTC);
+        }
+        return item;
+    }
+    case SimpleOrFloat:
+        switch (info) {
+        case 20:
+            return false;
+        case 21:
+            return true;
+        case 22: // null
+        case 23: // undefined
+            return QVariant();
+        case 25:
+            return decodeHalf(quint16(value));
+        case 26:
+        {
+            const quint32 bits = quint32(value);
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            return double(f);
+        }
+        case 27:
+        {
+            double d;
+            memcpy(&d, &value, sizeof(d));
+            return d;
+        }
+        case Indefinite:
+            return fail(QStringLiteral("Unexpected break"));
+        default:
+            // Unassigned simple values
+            return QVariant();
+        }
+    }
+
+    return QVariant();
+}
+
+void writeHead(QByteArray &output, int major, quint64 value)
+{
+    const uchar type = uchar(major << 5);
+    if (value < 24) {
+        output.append(char(type | value));
+    } else if (value <= 0xff) {
+        output.append(char(type | 24));
+        output.append(char(value));
+    } else if (value <= 0xffff) {
+        output.append(char(type | 25));
+        uchar buf[2];
+        qToBigEndian(quint16(value), buf);
+        output.append(reinterpret_cast<const char *>(buf), 2);
+    } else if (value <= 0xffffffffULL) {
+        output.append(char(type | 26));
+        uchar buf[4];
+        qToBigEndian(quint32(value), buf);
+        output.append(reinterpret_cast<const char *>(buf), 4);
+    } else {
+        output.append(char(type | 27));
+        uchar buf[8];
+        qToBigEndian(quint64(value), buf);
+        output.append(reinterpret_cast<const char *>(buf), 8);
+    }
+}
+
+void writeInteger(QByteArray &output, qint64 value)
+{
+    if (value >= 0) {
+        writeHead(output, UnsignedInteger, quint64(value));
+    } else {
+        writeHead(output, NegativeInteger, quint64(-1 - value));
+    }
+}
+
+void writeDouble(QByteArray &output, double value)
+{
+    const float f = float(value);
+    if (double(f) == value || qIsNaN(value)) {
+        // Use the shorter encoding when it's lossless
+        quint32 bits;
+        memcpy(&bits, &f, sizeof(bits));
+        output.append(char(0xfa));
+        uchar buf[4];
+        qToBigEndian(bits, buf);
+        output.append(reinterpret_cast<const char *>(buf), 4);
+    } else {
+        quint64 bits;
+        memcpy(&bits, &value, sizeof(bits));
+        output.append(char(0xfb));
+        uchar buf[8];
+        qToBigEndian(bits, buf);
+        output.append(reinterpret_cast<const char *>(buf), 8);
+    }
+}
+
+void writeText(QByteArray &output, const QString &text)
+{
+    const QByteArray utf8 = text.toUtf8();
+    writeHead(output, TextString, utf8.size());
+    output.append(utf8);
+}
+
+}
+
+QVariant Cbor::read(const QByteArray &data, QString *errorString, int maxDepth)
+{
+    CborReader reader(data, maxDepth);
+    QVariant ret = reader.readItem(0);
+    if (reader.errorString.isEmpty() && !reader.atEnd()) {
+        reader.errorString = QStringLiteral("Garbage after the data item");
+    }
+
+    if (!reader.errorString.isEmpty()) {
+        if (errorString) {
+            *errorString = reader.errorString;
+        }
+        return QVariant();
+    }
+    return ret;
+}
+
+void Cbor::write(const QVariant &value, QByteArray &output)
+{
+    switch (value.userType()) {
+    case QMetaType::UnknownType:
+        output.append(char(0xf6)); // null
+        break;
+    case QMetaType::Bool:
+        output.append(value.toBool() ? char(0xf5) : char(0xf4));
+        break;
+    case QMetaType::Int:
+    case QMetaType::LongLong:
+    case QMetaType::Short:
+    case QMetaType::Long:
+    case QMetaType::Char:
+    case QMetaType::SChar:
+        writeInteger(output, value.toLongLong());
+        break;
+    case QMetaType::UInt:
+    case QMetaType::ULongLong:
+    case QMetaType::UShort:
+    case QMetaType::ULong:
+    case QMetaType::UChar:
+        writeHead(output, UnsignedInteger, value.toULongLong());
+        break;
+    case QMetaType::Double:
+    case QMetaType::Float:
+        writeDouble(output, value.toDouble());
+        break;
+    case QMetaType::QString:
+        writeText(output, value.toString());
+        break;
+    case QMetaType::QByteArray:
+    {
+        const QByteArray bytes = value.toByteArray();
+        writeHead(output, ByteString, bytes.size());
+        output.append(bytes);
+        break;
+    }
+    case QMetaType::QDateTime:
+        // Standard date/time string tag
+        writeHead(output, Tag, 0);
+        writeText(output, value.toDateTime().toString(Qt::ISODate));
+        break;
+    case QMetaType::QStringList:
+    {
+        const QStringList list = value.toStringList();
+        writeHead(output, Array, list.size());
+        Q_FOREACH (const QString &item, list) {
+            writeText(output, item);
+        }
+        break;
+    }
+    case QMetaType::QVariantList:
+    {
+        const QVariantList list = value.toList();
+        writeHead(output, Array, list.size());
+        Q_FOREACH (const QVariant &item, list) {
+            write(item, output);
+        }
+        break;
+    }
+    case QMetaType::QVariantMap:
+    {
+        const QVariantMap map = value.toMap();
+        writeHead(output, Map, map.size());
+        QVariantMap::ConstIterator it = map.constBegin();
+        while (it != map.constEnd()) {
+            writeText(output, it.key());
+            write(it.value(), output);
+            ++it;
+        }
+        break;
+    }
+    case QMetaType::QVariantHash:
+    {
+        const QVariantHash hash = value.toHash();
+        writeHead(output, Map, hash.size());
+        QVariantHash::ConstIterator it = hash.constBegin();
+        while (it != hash.constEnd()) {
+            writeText(output, it.key());
+            write(it.value(), output);
+            ++it;
+        }
+        break;
+    }
+    default:
+        if (value.canConvert<QVariantList>() && value.userType() != QMetaType::QString) {
+            // Sequential containers like QList<int>
+            write(value.value<QVariantList>(), output);
+        } else if (value.canConvert<QVariantMap>()) {
+            // Associative containers like ParamsMultiMap
+            write(value.value<QVariantMap>(), output);
+        } else if (value.canConvert<QString>()) {
+            writeText(output, value.toString());
+        } else {
+            output.append(char(0xf6)); // null
+        }
+    }
+}
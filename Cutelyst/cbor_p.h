@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CUTELYST_CBOR_P_H
+#define CUTELYST_CBOR_P_H
+
+#include <QtCore/QVariant>
+
+namespace Cutelyst {
+
+/**
+ * Minimal CBOR (RFC 7049) codec used by the CBOR body
+ * decoder and ViewCbor.
+ *
+ * Maps are read into QVariantMap, converting keys that are
+ * not text to strings, tags other than date/time are skipped
+ * and byte strings become QByteArray.
+ */
+class Cbor
+{
+public:
+    /**
+     * Decodes the single data item in \p data, on error
+     * an invalid QVariant is returned and \p errorString is set
+     */
+    static QVariant read(const QByteArray &data, QString *errorString = 0, int maxDepth = 512);
+
+    /**
+     * Appends the encoding of \p value to \p output
+     */
+    static void write(const QVariant &value, QByteArray &output);
+};
+
+}
+
+#endif // CUTELYST_CBOR_P_H
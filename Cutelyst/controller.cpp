@@ -19,6 +19,7 @@
 
 #include "controller_p.h"
 
+#include "routecache_p.h"
 #include "application.h"
 #include "dispatcher.h"
 #include "action.h"
@@ -31,6 +32,11 @@
 
 using namespace Cutelyst;
 
+// Used for every action, so only compile them once
+static const QRegularExpression s_internalActionRE(QStringLiteral("^_(DISPATCH|BEGIN|AUTO|ACTION|END)$"));
+static const QRegularExpression s_nonDigitRE(QStringLiteral("\\D"));
+static const QRegularExpression s_nonWordRE(QStringLiteral("\\W"));
+
 Controller::Controller(QObject *parent) :
     QObject(parent),
     d_ptr(new ControllerPrivate(this))
@@ -148,7 +154,7 @@ ControllerPrivate::ControllerPrivate(Controller *parent) :
 {
 }
 
-void ControllerPrivate::init(Application *app, Dispatcher *_dispatcher)
+void ControllerPrivate::init(Application *app, Dispatcher *_dispatcher, RouteCache *routeCache)
 {
     Q_Q(Controller);
 
@@ -188,7 +194,7 @@ void ControllerPrivate::init(Application *app, Dispatcher *_dispatcher)
     }
     pathPrefix = controlerNS;
 
-    registerActionMethods(meta, q, app);
+    registerActionMethods(meta, q, app, routeCache);
 }
 
 void ControllerPrivate::setupFinished()
@@ -272,8 +278,7 @@ Action *ControllerPrivate::createAction(const QVariantHash &args, const QMetaMet
     }
 
     QString name = args.value("name").toString();
-    QRegularExpression regex(QStringLiteral("^_(DISPATCH|BEGIN|AUTO|ACTION|END)$"));
-    QRegularExpressionMatch match = regex.match(name);
+    QRegularExpressionMatch match = s_internalActionRE.match(name);
     if (!match.hasMatch()) {
         QStack<Component *> roles = gatherActionRoles(args);
         for (int i = 0; i < roles.size(); ++i) {
@@ -293,8 +298,16 @@ Action *ControllerPrivate::createAction(const QVariantHash &args, const QMetaMet
     return action;
 }
 
-void ControllerPrivate::registerActionMethods(const QMetaObject *meta, Controller *controller, Application *app)
+void ControllerPrivate::registerActionMethods(const QMetaObject *meta, Controller *controller, Application *app, RouteCache *routeCache)
 {
+    // Group the class info values by method name so that
+    // we don't scan all of them for every method
+    QHash<QByteArray, QByteArray> classInfoAttributes;
+    for (int i = 0; i < meta->classInfoCount(); ++i) {
+        const QMetaClassInfo &classInfo = meta->classInfo(i);
+        classInfoAttributes[classInfo.name()].append(classInfo.value());
+    }
+
     // Setup actions
     for (int i = 0; i < meta->methodCount(); ++i) {
         const QMetaMethod &method = meta->method(i);
@@ -307,15 +320,16 @@ void ControllerPrivate::registerActionMethods(const QMetaObject *meta, Controlle
                 (method.methodType() == QMetaMethod::Method || method.methodType() == QMetaMethod::Slot) &&
                 (method.parameterCount() && method.parameterType(0) == qMetaTypeId<Cutelyst::Context *>())) {
 
-            // Build up the list of attributes for the class info
-            QByteArray attributeArray;
-            for (int i = 0; i < meta->classInfoCount(); ++i) {
-                QMetaClassInfo classInfo = meta->classInfo(i);
-                if (name == classInfo.name()) {
-                    attributeArray.append(classInfo.value());
-                }
+            // Parsed attributes only depend on the binary
+            // so they might come from the route cache
+            QMap<QString, QString> attrs;
+            const QString &cacheKey = QLatin1String(meta->className())
+                    % QLatin1String("::")
+                    % QLatin1String(method.methodSignature());
+            if (!routeCache->attributes(cacheKey, &attrs)) {
+                attrs = parseAttributes(method, classInfoAttributes.value(name), name);
+                routeCache->insert(cacheKey, attrs);
             }
-            QMap<QString, QString> attrs = parseAttributes(method, attributeArray, name);
 
             QString reverse;
             if (controller->ns().isEmpty()) {
@@ -429,13 +443,16 @@ QMap<QString, QString> ControllerPrivate::parseAttributes(const QMetaMethod &met
         } else if (key == QLatin1String("Args")) {
             QString args = value;
             if (!args.isEmpty()) {
-                value = args.remove(QRegularExpression("\\D")).toLocal8Bit();
+                value = args.remove(s_nonDigitRE).toLocal8Bit();
             }
         } else if (key == QLatin1String("CaptureArgs")) {
             QString captureArgs = value;
-            value = captureArgs.remove(QRegularExpression("\\D")).toLocal8Bit();
+            value = captureArgs.remove(s_nonDigitRE).toLocal8Bit();
         } else if (key == QLatin1String("Chained")) {
             value = parseChainedAttr(value);
+        } else if (key == QLatin1String("Cache")) {
+            QString ttl = value;
+            value = ttl.remove(s_nonDigitRE);
         }
 
         ret.insertMulti(key, value);
@@ -532,7 +549,7 @@ QObject *ControllerPrivate::instantiateClass(const QByteArray &name, const QByte
 {
     QString instanceName = name;
     if (!instanceName.isEmpty()) {
-        instanceName.remove(QRegularExpression("\\W"));
+        instanceName.remove(s_nonWordRE);
 
         int id = QMetaType::type(instanceName.toLocal8Bit().data());
         if (!id) {
@@ -72,6 +72,10 @@ class ControllerPrivate;
  * \n The number is computed by counting the arguments the method expects.
  * \n However if no Args value is set, assumed to 'slurp' all
  *    remaining path parts under this namespace.
+ *
+ * \b :Cache - Lets the ResponseCache plugin keep the response
+ * for the given number of seconds, i.e. :Cache(60), without a
+ * value the plugin default is used and :Cache(0) disables it.
  */
 class Controller : public QObject
 {
@@ -25,18 +25,19 @@
 
 namespace Cutelyst {
 
+class RouteCache;
 class ControllerPrivate
 {
     Q_DECLARE_PUBLIC(Controller)
 public:
     ControllerPrivate(Controller *parent);
-    void init(Application *app, Dispatcher *_dispatcher);
+    void init(Application *app, Dispatcher *_dispatcher, RouteCache *routeCache);
     // Called when the Dispatcher has finished
     // setting up all controllers
     void setupFinished();
     Action* actionClass(const QVariantHash &args);
     Action* createAction(const QVariantHash &args, const QMetaMethod &method, Controller *controller, Application *app);
-    void registerActionMethods(const QMetaObject *meta, Controller *controller, Application *app);
+    void registerActionMethods(const QMetaObject *meta, Controller *controller, Application *app, RouteCache *routeCache);
     QMap<QString, QString> parseAttributes(const QMetaMethod &method, const QByteArray &str, const QByteArray &name);
     QStack<Component *> gatherActionRoles(const QVariantHash &args);
     QString parsePathAttr(const QString &_value);
@@ -122,7 +122,10 @@ void Dispatcher::setupActions(const QList<Controller*> &controllers)
         ++i;
     }
 
-    d->printActions();
+    // Building the tables is slow with thousands of actions
+    if (CUTELYST_DISPATCHER().isDebugEnabled()) {
+        d->printActions();
+    }
 }
 
 bool Dispatcher::dispatch(Context *c)
@@ -19,8 +19,11 @@
 
 #include "engine_p.h"
 
+#include "config.h"
 #include "common.h"
 #include "request_p.h"
+#include "segmentedbuffer.h"
+#include "bodyencoder.h"
 #include "application.h"
 #include "response_p.h"
 #include "context_p.h"
@@ -28,6 +31,12 @@
 #include <QUrl>
 #include <QSettings>
 #include <QDir>
+#include <QTemporaryFile>
+
+#ifdef HAVE_MEMFD_CREATE
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 #include <QDebug>
 
 using namespace Cutelyst;
@@ -56,6 +65,14 @@ Engine::Engine(const QVariantHash &opts, QObject *parent) :
         qCDebug(CUTELYST_CORE) << "Configuration:" << d->config;
     }
 
+    // Request limits
+    const QVariantHash &cutelyst = d->config.value(QStringLiteral("Cutelyst"));
+    d->maxBodySize = cutelyst.value(QStringLiteral("max_body_size"), d->maxBodySize).toLongLong();
+    d->maxHeaderSize = cutelyst.value(QStringLiteral("max_header_size"), d->maxHeaderSize).toInt();
+    d->maxUploads = cutelyst.value(QStringLiteral("max_uploads"), d->maxUploads).toInt();
+    d->bodyBufferSize = cutelyst.value(QStringLiteral("body_buffer_size"), d->bodyBufferSize).toLongLong();
+    d->maxDecompressedBodySize = cutelyst.value(QStringLiteral("max_decompressed_body_size"), d->maxDecompressedBodySize).toLongLong();
+
     d->opts = opts;
 }
 
@@ -82,10 +99,13 @@ bool Engine::finalizeHeaders(Context *c)
         return true;
     }
 
+    // Last chance for plugins to change the response
+    Q_EMIT c->app()->beforeFinalizeHeaders(c);
+
     QIODevice *body = response->bodyDevice();
 
-    // Fix missing content length
-    if (body && !response->contentLength()) {
+    // Fix missing content length, unknown if the body is encoded
+    if (body && !response->contentLength() && !response->d_ptr->bodyEncoder) {
         response->setContentLength(body->size());
     }
 
@@ -121,7 +141,28 @@ bool Engine::finalizeHeaders(Context *c)
 
 void Engine::finalizeBody(Context *c, QIODevice *body)
 {
-    if (c->d_ptr->chunked) {
+    SegmentedBuffer *segmented = qobject_cast<SegmentedBuffer *>(body);
+    // Encoded bodies go through write()
+    if (segmented && !c->response()->d_ptr->bodyEncoder) {
+        void *engineData = c->engineData();
+        const qint64 size = segmented->size();
+        if (c->d_ptr->chunked) {
+            // Everything is sent as a single chunk
+            if (!size) {
+                return;
+            }
+
+            char chunked[19];
+            int ret = snprintf(chunked, 19, "%llX\r\n", (unsigned long long) size);
+            if (doWrite(c, chunked, ret, engineData) != ret ||
+                    doWriteSegments(c, segmented, engineData) != size ||
+                    doWrite(c, "\r\n", 2, engineData) != 2) {
+                qCWarning(CUTELYST_ENGINE) << "Failed to write body";
+            }
+        } else if (doWriteSegments(c, segmented, engineData) != size) {
+            qCWarning(CUTELYST_ENGINE) << "Failed to write body";
+        }
+    } else if (c->d_ptr->chunked) {
         body->seek(0);
         char block[64 * 1024];
         while (!body->atEnd()) {
@@ -151,6 +192,19 @@ void Engine::finalizeBody(Context *c, QIODevice *body)
     }
 }
 
+qint64 Engine::doWriteSegments(Context *c, const SegmentedBuffer *buffer, void *engineData)
+{
+    qint64 written = 0;
+    for (int i = 0; i < buffer->segmentCount(); ++i) {
+        qint64 len = buffer->segmentSize(i);
+        if (doWrite(c, buffer->segmentData(i), len, engineData) != len) {
+            return -1;
+        }
+        written += len;
+    }
+    return written;
+}
+
 void Engine::finalizeError(Context *c)
 {
     Response *res = c->response();
@@ -223,27 +277,53 @@ quint64 Engine::time()
 qint64 Engine::write(Context *c, const char *data, qint64 len)
 {
     void *engineData = c->engineData();
-    if (c->d_ptr->chunked) {
+    if (!c->d_ptr->chunked) {
+        return doWrite(c, data, len, engineData);
+    }
 
-        QByteArray chunk(data, len);
-        char chunked[19];
-        int ret = snprintf(chunked, 19, "%X\r\n", (unsigned int) len);
-        if (ret <= 0 || ret >= 19) {
+    BodyEncoder *encoder = c->response()->d_ptr->bodyEncoder;
+    if (encoder) {
+        // An empty write ends the body, so the encoder is flushed
+        QByteArray encoded;
+        if (!(len ? encoder->encode(data, len, encoded) : encoder->finish(encoded))) {
+            qCWarning(CUTELYST_ENGINE) << "Failed to encode body";
             return -1;
         }
-        chunk.prepend(chunked, ret);
-        chunk.append("\r\n", 2);
 
-        qint64 retWrite = doWrite(c, chunk.data(), chunk.size(), engineData);
+        // Empty chunks mark the end of the body
+        if (!encoded.isEmpty() && writeChunk(c, encoded.constData(), encoded.size(), engineData) == -1) {
+            return -1;
+        }
 
-        // Flag if we wrote an empty chunk
-        if (!len) {
-            c->d_ptr->chunked_done = true;
+        if (len) {
+            return len;
         }
+    }
+
+    return writeChunk(c, data, len, engineData);
+}
+
+qint64 Engine::writeChunk(Context *c, const char *data, qint64 len, void *engineData)
+{
+    QByteArray chunk(data, len);
+    char chunked[19];
+    int ret = snprintf(chunked, 19, "%X\r\n", (unsigned int) len);
+    if (ret <= 0 || ret >= 19) {
+        return -1;
+    }
+    chunk.prepend(chunked, ret);
+    chunk.append("\r\n", 2);
+
+    if (doWrite(c, chunk.data(), chunk.size(), engineData) != chunk.size()) {
+        return -1;
+    }
 
-        return retWrite;
+    // Flag if we wrote an empty chunk
+    if (!len) {
+        c->d_ptr->chunked_done = true;
     }
-    return doWrite(c, data, len, engineData);
+
+    return len;
 }
 
 QByteArray Engine::statusCode(quint16 status)
@@ -319,6 +399,8 @@ QByteArray Engine::statusCode(quint16 status)
         return QByteArrayLiteral("416 Requested Range Not Satisfiable");
     case Response::ExpectationFailed:
         return QByteArrayLiteral("417 Expectation Failed");
+    case Response::RequestHeaderFieldsTooLarge:
+        return QByteArrayLiteral("431 Request Header Fields Too Large");
     case Response::NotImplemented:
         return QByteArrayLiteral("501 Not Implemented");
     case Response::BadGateway:
@@ -336,6 +418,12 @@ QByteArray Engine::statusCode(quint16 status)
     }
 }
 
+bool Engine::streamBody(QIODevice *body)
+{
+    Q_UNUSED(body)
+    return false;
+}
+
 void Engine::reload()
 {
     qCWarning(CUTELYST_ENGINE) << "Default reload implementation called, doing nothing";
@@ -353,6 +441,61 @@ QVariantHash Engine::config(const QString &entity) const
     return d->config.value(entity);
 }
 
+qint64 Engine::maxBodySize() const
+{
+    Q_D(const Engine);
+    return d->maxBodySize;
+}
+
+int Engine::maxHeaderSize() const
+{
+    Q_D(const Engine);
+    return d->maxHeaderSize;
+}
+
+int Engine::maxUploads() const
+{
+    Q_D(const Engine);
+    return d->maxUploads;
+}
+
+qint64 Engine::bodyBufferSize() const
+{
+    Q_D(const Engine);
+    return d->bodyBufferSize;
+}
+
+qint64 Engine::maxDecompressedBodySize() const
+{
+    Q_D(const Engine);
+    return d->maxDecompressedBodySize;
+}
+
+QFile *Engine::createBodyBuffer(QObject *parent)
+{
+#ifdef HAVE_MEMFD_CREATE
+    // A memfd lives in the page cache and can be swapped,
+    // unlike the heap, and doesn't need a writable directory
+    int fd = memfd_create("cutelyst-body", MFD_CLOEXEC);
+    if (fd != -1) {
+        QFile *file = new QFile(parent);
+        if (file->open(fd, QIODevice::ReadWrite, QFileDevice::AutoCloseHandle)) {
+            return file;
+        }
+        delete file;
+        ::close(fd);
+    }
+#endif
+
+    QTemporaryFile *file = new QTemporaryFile(parent);
+    if (file->open()) {
+        return file;
+    }
+    qCWarning(CUTELYST_ENGINE) << "Failed to create a temporary file for the request body" << file->errorString();
+    delete file;
+    return 0;
+}
+
 void Engine::handleRequest(Request *request, bool autoDelete)
 {
     Q_D(Engine);
@@ -382,8 +525,8 @@ void Engine::finalize(Context *c)
     }
 
     if (c->d_ptr->chunked && !c->d_ptr->chunked_done) {
-        // Write the final '0' chunk
-        doWrite(c, "0\r\n\r\n", 5, c->engineData());
+        // Write the final '0' chunk, after what the encoder has pending
+        write(c, 0, 0);
     }
 }
 
@@ -37,6 +37,7 @@ class Application;
 class Context;
 class Request;
 class Headers;
+class SegmentedBuffer;
 class EnginePrivate;
 class Engine : public QObject
 {
@@ -77,6 +78,46 @@ public:
      */
     QVariantHash config(const QString &entity) const;
 
+    /**
+     * Maximum size of a request body, set with max_body_size
+     * on the [Cutelyst] section of the config, engines reply
+     * with 413 before reading larger bodies. 0 means no limit.
+     */
+    qint64 maxBodySize() const;
+
+    /**
+     * Maximum size of the request headers, set with
+     * max_header_size, engines reply with 431 to requests
+     * with larger headers. 0 means no limit.
+     */
+    int maxHeaderSize() const;
+
+    /**
+     * Maximum number of parts parsed from a multipart
+     * body, set with max_uploads. 0 means no limit.
+     */
+    int maxUploads() const;
+
+    /**
+     * Bodies larger than this are buffered on a temporary
+     * file instead of memory, set with body_buffer_size.
+     */
+    qint64 bodyBufferSize() const;
+
+    /**
+     * Maximum size of a gzip or deflate encoded request body
+     * once decompressed, set with max_decompressed_body_size,
+     * defaults to 64MiB. 0 means no limit.
+     */
+    qint64 maxDecompressedBodySize() const;
+
+    /**
+     * Returns a temporary file to buffer a request body on,
+     * or 0 on failure. On Linux it's an anonymous file that
+     * never shows up on the file system.
+     */
+    static QFile *createBodyBuffer(QObject *parent);
+
     static QByteArray statusCode(quint16 status);
 
     /**
@@ -118,6 +159,13 @@ protected:
 
     virtual qint64 doWrite(Context *c, const char *data, qint64 len, void *engineData) = 0;
 
+    /**
+     * Writes all segments of \p buffer, the default implementation
+     * calls doWrite() for each one, engines that can should
+     * reimplement it to use writev()
+     */
+    virtual qint64 doWriteSegments(Context *c, const SegmentedBuffer *buffer, void *engineData);
+
     /**
      * Reimplement if you need a custom way
      * to Set-Cookie, the default implementation
@@ -138,6 +186,15 @@ protected:
      */
     virtual void finalizeBody(Context *c, QIODevice *body);
 
+    /**
+     * Called by Request::readBody() before \p body is first
+     * read, engines that can read it from the connection as
+     * it's consumed instead of buffering it should switch
+     * \p body to that and return true, it then can only be
+     * read once. Default implementation returns false.
+     */
+    virtual bool streamBody(QIODevice *body);
+
     /**
      * Engines should overwrite this if they
      * want to to make custom error messages.
@@ -191,6 +248,7 @@ protected:
 private:
     Q_DECLARE_PRIVATE(Engine)
     friend class Application;
+    friend class Request;
     friend class Response;
 
     /**
@@ -198,6 +256,8 @@ private:
      * @return true if succeeded
      */
     virtual bool init() = 0;
+
+    qint64 writeChunk(Context *c, const char *data, qint64 len, void *engineData);
 };
 
 }
@@ -30,6 +30,11 @@ public:
     Application *app = 0;
     QVariantHash opts;
     QHash<QString, QVariantHash> config;
+    qint64 maxBodySize = 0;
+    int maxHeaderSize = 64 * 1024;
+    int maxUploads = 0;
+    qint64 bodyBufferSize = 1024 * 1024;
+    qint64 maxDecompressedBodySize = 64 * 1024 * 1024;
 };
 
 }
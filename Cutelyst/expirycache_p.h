@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CUTELYST_EXPIRYCACHE_P_H
+#define CUTELYST_EXPIRYCACHE_P_H
+
+#include <QtCore/QHash>
+#include <QtCore/QMap>
+
+namespace Cutelyst {
+
+/**
+ * Hash of values with an expiry time, bounded to maxSize entries.
+ *
+ * Entries are also indexed by their expiry time, so making
+ * room for a new one drops the entries that expire first
+ * without scanning the whole hash. Expired entries are kept
+ * until room is needed.
+ *
+ * It's not thread safe, callers hold their own lock.
+ */
+template <typename Key, typename T>
+class ExpiryCache
+{
+public:
+    explicit ExpiryCache(int maxSize = 1024) : m_maxSize(qMax(1, maxSize)) {}
+
+    inline void setMaxSize(int maxSize) { m_maxSize = qMax(1, maxSize); }
+    inline int size() const { return m_entries.size(); }
+
+    inline void clear()
+    {
+        m_entries.clear();
+        m_byExpiry.clear();
+    }
+
+    /**
+     * Returns the value for \p key, expired or not,
+     * or 0 if there is none
+     */
+    inline const T *value(const Key &key) const
+    {
+        typename QHash<Key, Entry>::ConstIterator it = m_entries.constFind(key);
+        return it == m_entries.constEnd() ? 0 : &it->value;
+    }
+
+    /**
+     * Stores \p value until \p expires, replacing the value
+     * for \p key, when full the entries that expired by \p now
+     * are dropped first and then the ones closest to expire
+     */
+    void insert(const Key &key, const T &value, qint64 expires, qint64 now)
+    {
+        typename QHash<Key, Entry>::Iterator it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            m_byExpiry.remove(it->expires, key);
+            it->value = value;
+            it->expires = expires;
+        } else {
+            if (m_entries.size() >= m_maxSize) {
+                typename QMap<qint64, Key>::Iterator oldest = m_byExpiry.begin();
+                while (oldest != m_byExpiry.end() &&
+                       (oldest.key() <= now || m_entries.size() >= m_maxSize)) {
+                    m_entries.remove(oldest.value());
+                    oldest = m_byExpiry.erase(oldest);
+                }
+            }
+
+            Entry entry;
+            entry.value = value;
+            entry.expires = expires;
+            m_entries.insert(key, entry);
+        }
+        m_byExpiry.insert(expires, key);
+    }
+
+private:
+    struct Entry {
+        T value;
+        qint64 expires;
+    };
+
+    QHash<Key, Entry> m_entries;
+    QMultiMap<qint64, Key> m_byExpiry;
+    int m_maxSize;
+};
+
+}
+
+#endif // CUTELYST_EXPIRYCACHE_P_H
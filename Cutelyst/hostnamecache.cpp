@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "hostnamecache_p.h"
+#include "common.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QQueue>
+
+using namespace Cutelyst;
+
+namespace {
+
+struct Entry {
+    QString hostname;
+    qint64 expires;
+    quint64 serial;
+};
+
+struct HostnameCacheData
+{
+    HostnameCacheData() { clock.start(); }
+
+    void insert(const QHostAddress &address, const QString &hostname);
+    void evict(qint64 now);
+
+    QMutex mutex;
+    QElapsedTimer clock;
+    QHash<QHostAddress, Entry> entries;
+    // Insertion order, entries refreshed since then have a newer serial
+    QQueue<QPair<QHostAddress, quint64> > order;
+    QHash<QHostAddress, HostnameLookup *> pending;
+    quint64 serial = 0;
+    int maxSize = 4096;
+    qint64 ttl = 3600 * 1000;
+    qint64 negativeTtl = 300 * 1000;
+};
+
+void HostnameCacheData::insert(const QHostAddress &address, const QString &hostname)
+{
+    if (maxSize <= 0) {
+        return;
+    }
+
+    const qint64 now = clock.elapsed();
+    Entry entry;
+    entry.hostname = hostname;
+    entry.expires = now + (hostname.isEmpty() ? negativeTtl : ttl);
+    entry.serial = ++serial;
+    entries.insert(address, entry);
+    order.enqueue(qMakePair(address, entry.serial));
+
+    // Refreshed addresses leave stale items behind in the queue
+    if (entries.size() > maxSize || order.size() > maxSize * 2) {
+        evict(now);
+    }
+}
+
+void HostnameCacheData::evict(qint64 now)
+{
+    // Drop the oldest entries, and the expired ones found along the way
+    while (!order.isEmpty() && (entries.size() > maxSize || order.size() > maxSize * 2)) {
+        const QPair<QHostAddress, quint64> item = order.dequeue();
+        auto it = entries.find(item.first);
+        if (it != entries.end() && it.value().serial == item.second) {
+            entries.erase(it);
+        }
+    }
+
+    while (!order.isEmpty()) {
+        const QPair<QHostAddress, quint64> &item = order.head();
+        auto it = entries.find(item.first);
+        if (it != entries.end() && it.value().serial == item.second) {
+            if (it.value().expires > now) {
+                break;
+            }
+            entries.erase(it);
+        }
+        order.dequeue();
+    }
+}
+
+}
+
+Q_GLOBAL_STATIC(HostnameCacheData, s_cache)
+
+bool HostnameCache::cached(const QHostAddress &address, QString *hostname)
+{
+    HostnameCacheData *cache = s_cache();
+    QMutexLocker locker(&cache->mutex);
+
+    auto it = cache->entries.constFind(address);
+    if (it == cache->entries.constEnd() || it.value().expires <= cache->clock.elapsed()) {
+        return false;
+    }
+
+    *hostname = it.value().hostname;
+    return true;
+}
+
+void HostnameCache::lookup(const QHostAddress &address, QObject *receiver, const char *member)
+{
+    HostnameCacheData *cache = s_cache();
+    QMutexLocker locker(&cache->mutex);
+
+    auto it = cache->entries.constFind(address);
+    if (it != cache->entries.constEnd() && it.value().expires > cache->clock.elapsed()) {
+        const QString hostname = it.value().hostname;
+        locker.unlock();
+
+        HostnameLookup notifier(address);
+        QObject::connect(&notifier, SIGNAL(finished(QString)), receiver, member);
+        Q_EMIT notifier.finished(hostname);
+        return;
+    }
+
+    // The pending lookup is only deleted after it was
+    // removed from the hash, so it's safe to connect to it
+    HostnameLookup *pending = cache->pending.value(address);
+    if (pending) {
+        QObject::connect(pending, SIGNAL(finished(QString)), receiver, member);
+        return;
+    }
+
+    pending = new HostnameLookup(address);
+    QObject::connect(pending, SIGNAL(finished(QString)), receiver, member);
+    cache->pending.insert(address, pending);
+    locker.unlock();
+
+    pending->start();
+}
+
+void HostnameCache::prefetch(const QHostAddress &address)
+{
+    HostnameCacheData *cache = s_cache();
+    QMutexLocker locker(&cache->mutex);
+
+    if (cache->pending.contains(address)) {
+        return;
+    }
+
+    auto it = cache->entries.constFind(address);
+    if (it != cache->entries.constEnd() && it.value().expires > cache->clock.elapsed()) {
+        return;
+    }
+
+    HostnameLookup *pending = new HostnameLookup(address);
+    cache->pending.insert(address, pending);
+    locker.unlock();
+
+    pending->start();
+}
+
+void HostnameCache::setMaxSize(int size)
+{
+    HostnameCacheData *cache = s_cache();
+    QMutexLocker locker(&cache->mutex);
+
+    cache->maxSize = size;
+    if (size <= 0) {
+        cache->entries.clear();
+        cache->order.clear();
+    } else {
+        cache->evict(cache->clock.elapsed());
+    }
+}
+
+void HostnameCache::setTtl(int ttl, int negativeTtl)
+{
+    HostnameCacheData *cache = s_cache();
+    QMutexLocker locker(&cache->mutex);
+
+    cache->ttl = qint64(ttl) * 1000;
+    cache->negativeTtl = qint64(negativeTtl) * 1000;
+}
+
+HostnameLookup::HostnameLookup(const QHostAddress &address) : QObject()
+  , m_address(address)
+{
+}
+
+void HostnameLookup::start()
+{
+    // The result is delivered to this thread's event loop,
+    // the query itself runs on Qt's resolver thread pool
+    QHostInfo::lookupHost(m_address.toString(), this, SLOT(lookedUp(QHostInfo)));
+}
+
+void HostnameLookup::lookedUp(const QHostInfo &info)
+{
+    QString hostname;
+    // A failed reverse lookup returns the address itself
+    if (info.error() == QHostInfo::NoError && info.hostName() != m_address.toString()) {
+        hostname = info.hostName();
+    } else {
+        qCDebug(CUTELYST_REQUEST) << "DNS lookup for the client hostname failed" << m_address;
+    }
+
+    HostnameCacheData *cache = s_cache();
+    {
+        QMutexLocker locker(&cache->mutex);
+        cache->insert(m_address, hostname);
+        cache->pending.remove(m_address);
+    }
+
+    Q_EMIT finished(hostname);
+    deleteLater();
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CUTELYST_HOSTNAMECACHE_P_H
+#define CUTELYST_HOSTNAMECACHE_P_H
+
+#include <QtCore/QObject>
+#include <QtNetwork/QHostAddress>
+#include <QtNetwork/QHostInfo>
+
+namespace Cutelyst {
+
+/**
+ * Process wide cache of reverse DNS lookups, shared by
+ * all engine threads.
+ *
+ * Failed lookups are cached as well (with a shorter TTL),
+ * so that clients without a PTR record don't trigger a
+ * new lookup on every request.
+ */
+class HostnameCache
+{
+public:
+    /**
+     * Returns true if \p address has a valid cache entry,
+     * in which case \p hostname is set to the cached value,
+     * which is empty if the lookup had failed.
+     */
+    static bool cached(const QHostAddress &address, QString *hostname);
+
+    /**
+     * Calls \p member on \p receiver with the hostname
+     * of \p address, right away if it's cached or when the
+     * lookup finishes. Concurrent lookups of the same address
+     * share the same DNS query.
+     */
+    static void lookup(const QHostAddress &address, QObject *receiver, const char *member);
+
+    /**
+     * Starts a lookup for \p address if it isn't cached
+     * or being looked up already
+     */
+    static void prefetch(const QHostAddress &address);
+
+    /**
+     * Sets the maximum number of cached addresses,
+     * 0 disables the cache
+     */
+    static void setMaxSize(int size);
+
+    /**
+     * Sets for how long (in seconds) successful and
+     * failed lookups are cached
+     */
+    static void setTtl(int ttl, int negativeTtl);
+};
+
+class HostnameLookup : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HostnameLookup(const QHostAddress &address);
+
+    void start();
+
+Q_SIGNALS:
+    void finished(const QString &hostname);
+
+private Q_SLOTS:
+    void lookedUp(const QHostInfo &info);
+
+private:
+    QHostAddress m_address;
+};
+
+}
+
+#endif // CUTELYST_HOSTNAMECACHE_P_H
@@ -0,0 +1,677 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "jsonstreamreader_p.h"
+
+#include <QtCore/QIODevice>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QVector>
+
+using namespace Cutelyst;
+
+#define JSON_CHUNK_SIZE 16384
+#define JSON_DEFAULT_MAX_DEPTH 512
+
+static qint64 s_maxSize = 0;
+static int s_maxDepth = JSON_DEFAULT_MAX_DEPTH;
+static qint64 s_maxElements = 0;
+
+JsonStreamReader::JsonStreamReader(QIODevice *device) : d_ptr(new JsonStreamReaderPrivate)
+{
+    Q_D(JsonStreamReader);
+    d->device = device;
+    d->maxSize = s_maxSize;
+    d->maxDepth = s_maxDepth;
+    d->maxElements = s_maxElements;
+}
+
+JsonStreamReader::~JsonStreamReader()
+{
+    delete d_ptr;
+}
+
+void JsonStreamReader::setMaxSize(qint64 size)
+{
+    Q_D(JsonStreamReader);
+    d->maxSize = size;
+}
+
+qint64 JsonStreamReader::maxSize() const
+{
+    Q_D(const JsonStreamReader);
+    return d->maxSize;
+}
+
+void JsonStreamReader::setMaxDepth(int depth)
+{
+    Q_D(JsonStreamReader);
+    d->maxDepth = depth > 0 ? depth : JSON_DEFAULT_MAX_DEPTH;
+}
+
+int JsonStreamReader::maxDepth() const
+{
+    Q_D(const JsonStreamReader);
+    return d->maxDepth;
+}
+
+void JsonStreamReader::setMaxElements(qint64 elements)
+{
+    Q_D(JsonStreamReader);
+    d->maxElements = elements;
+}
+
+qint64 JsonStreamReader::maxElements() const
+{
+    Q_D(const JsonStreamReader);
+    return d->maxElements;
+}
+
+JsonStreamReader::TokenType JsonStreamReader::readNext()
+{
+    Q_D(JsonStreamReader);
+    if (d->error != NoError) {
+        return Invalid;
+    }
+
+    Q_FOREVER {
+        d->skipWhitespace();
+        int c = d->peek();
+        if (d->error != NoError) {
+            return Invalid;
+        }
+
+        switch (d->state) {
+        case JsonStreamReaderPrivate::Done:
+            if (c == -1) {
+                return d->tokenType = EndDocument;
+            }
+            return d->setError(SyntaxError);
+        case JsonStreamReaderPrivate::ExpectValueOrEnd:
+            if (c == ']') {
+                return d->closeContainer();
+            }
+            return d->readValueToken();
+        case JsonStreamReaderPrivate::ExpectValue:
+            return d->readValueToken();
+        case JsonStreamReaderPrivate::ExpectNameOrEnd:
+            if (c == '}') {
+                return d->closeContainer();
+            }
+            // fall through
+        case JsonStreamReaderPrivate::ExpectName:
+        {
+            if (c != '"') {
+                return d->setError(c == -1 ? UnexpectedEndOfDocument : SyntaxError);
+            }
+            ++d->pos;
+            if (d->readString(Name) == Invalid) {
+                return Invalid;
+            }
+
+            d->skipWhitespace();
+            c = d->peek();
+            if (c != ':') {
+                return d->setError(c == -1 ? UnexpectedEndOfDocument : SyntaxError);
+            }
+            ++d->pos;
+            d->state = JsonStreamReaderPrivate::ExpectValue;
+            return Name;
+        }
+        case JsonStreamReaderPrivate::ExpectCommaOrEnd:
+        {
+            const char container = d->stack.last();
+            if (c == ',') {
+                ++d->pos;
+                d->state = container == '{' ? JsonStreamReaderPrivate::ExpectName : JsonStreamReaderPrivate::ExpectValue;
+                continue;
+            } else if ((c == '}' && container == '{') || (c == ']' && container == '[')) {
+                return d->closeContainer();
+            }
+            return d->setError(c == -1 ? UnexpectedEndOfDocument : SyntaxError);
+        }
+        }
+    }
+}
+
+JsonStreamReader::TokenType JsonStreamReader::tokenType() const
+{
+    Q_D(const JsonStreamReader);
+    return d->tokenType;
+}
+
+bool JsonStreamReader::atEnd() const
+{
+    Q_D(const JsonStreamReader);
+    return d->tokenType == EndDocument || d->error != NoError;
+}
+
+int JsonStreamReader::depth() const
+{
+    Q_D(const JsonStreamReader);
+    return d->stack.size();
+}
+
+QString JsonStreamReader::text() const
+{
+    Q_D(const JsonStreamReader);
+    if (d->tokenType != Name && d->tokenType != String) {
+        return QString();
+    }
+    return d->decodeString();
+}
+
+double JsonStreamReader::number() const
+{
+    Q_D(const JsonStreamReader);
+    if (d->tokenType != Number) {
+        return 0;
+    }
+    return d->raw.toDouble();
+}
+
+bool JsonStreamReader::boolean() const
+{
+    Q_D(const JsonStreamReader);
+    return d->tokenType == Bool && d->boolean;
+}
+
+bool JsonStreamReader::skipCurrentValue()
+{
+    Q_D(JsonStreamReader);
+    if (d->tokenType == StartObject || d->tokenType == StartArray) {
+        const int depth = d->stack.size() - 1;
+        while (d->stack.size() > depth) {
+            if (readNext() == Invalid) {
+                return false;
+            }
+        }
+    }
+    return d->error == NoError;
+}
+
+static QJsonValue scalarValue(const JsonStreamReaderPrivate *d)
+{
+    switch (d->tokenType) {
+    case JsonStreamReader::String:
+        return d->decodeString();
+    case JsonStreamReader::Number:
+        return d->raw.toDouble();
+    case JsonStreamReader::Bool:
+        return d->boolean;
+    case JsonStreamReader::Null:
+        return QJsonValue();
+    default:
+        return QJsonValue(QJsonValue::Undefined);
+    }
+}
+
+QJsonValue JsonStreamReader::readValue()
+{
+    Q_D(JsonStreamReader);
+    if (d->tokenType != StartObject && d->tokenType != StartArray) {
+        return scalarValue(d);
+    }
+
+    // Open containers are kept on the heap instead of
+    // recursing, so deep documents can't overflow the stack
+    struct Container {
+        QJsonObject object;
+        QJsonArray array;
+        QString key;
+        bool isObject;
+    };
+    QVector<Container> containers;
+    containers.resize(1);
+    containers.last().isObject = d->tokenType == StartObject;
+
+    Q_FOREVER {
+        TokenType type = readNext();
+        QJsonValue value;
+        if (type == EndObject || type == EndArray) {
+            const Container &closed = containers.last();
+            if (closed.isObject) {
+                value = closed.object;
+            } else {
+                value = closed.array;
+            }
+            containers.removeLast();
+            if (containers.isEmpty()) {
+                return value;
+            }
+        } else {
+            if (containers.last().isObject) {
+                if (type != Name) {
+                    return QJsonValue(QJsonValue::Undefined);
+                }
+                containers.last().key = d->decodeString();
+                type = readNext();
+            }
+
+            if (type == StartObject || type == StartArray) {
+                containers.resize(containers.size() + 1);
+                containers.last().isObject = type == StartObject;
+                continue;
+            }
+
+            value = scalarValue(d);
+            if (value.isUndefined()) {
+                return value;
+            }
+        }
+
+        Container &parent = containers.last();
+        if (parent.isObject) {
+            parent.object.insert(parent.key, value);
+        } else {
+            parent.array.append(value);
+        }
+    }
+}
+
+QJsonDocument JsonStreamReader::readDocument()
+{
+    Q_D(JsonStreamReader);
+    if (d->tokenType == NoToken) {
+        readNext();
+    }
+
+    if (d->tokenType != StartObject && d->tokenType != StartArray) {
+        d->setError(SyntaxError);
+        return QJsonDocument();
+    }
+
+    const QJsonValue value = readValue();
+    if (d->error != NoError || readNext() != EndDocument) {
+        return QJsonDocument();
+    }
+
+    if (value.isObject()) {
+        return QJsonDocument(value.toObject());
+    }
+    return QJsonDocument(value.toArray());
+}
+
+JsonStreamReader::Error JsonStreamReader::error() const
+{
+    Q_D(const JsonStreamReader);
+    return d->error;
+}
+
+QString JsonStreamReader::errorString() const
+{
+    Q_D(const JsonStreamReader);
+    switch (d->error) {
+    case NoError:
+        return QString();
+    case SyntaxError:
+        return QStringLiteral("Syntax error at offset %1").arg(offset());
+    case UnexpectedEndOfDocument:
+        return QStringLiteral("Unexpected end of document");
+    case SizeLimitExceeded:
+        return QStringLiteral("Document is larger than %1 bytes").arg(d->maxSize);
+    case DepthLimitExceeded:
+        return QStringLiteral("Document is nested deeper than %1 levels").arg(d->maxDepth);
+    case ElementLimitExceeded:
+        return QStringLiteral("Document has more than %1 elements").arg(d->maxElements);
+    }
+    return QString();
+}
+
+qint64 JsonStreamReader::offset() const
+{
+    Q_D(const JsonStreamReader);
+    return d->consumed + d->pos;
+}
+
+void JsonStreamReader::setDefaultLimits(qint64 maxSize, int maxDepth, qint64 maxElements)
+{
+    s_maxSize = maxSize;
+    s_maxDepth = maxDepth > 0 ? maxDepth : JSON_DEFAULT_MAX_DEPTH;
+    s_maxElements = maxElements;
+}
+
+bool JsonStreamReaderPrivate::fill()
+{
+    if (error != JsonStreamReader::NoError) {
+        return false;
+    }
+
+    consumed += pos;
+    pos = 0;
+    buffer.resize(JSON_CHUNK_SIZE);
+
+    const qint64 len = device->read(buffer.data(), JSON_CHUNK_SIZE);
+    if (len <= 0) {
+        buffer.resize(0);
+        return false;
+    }
+    buffer.resize(len);
+
+    if (maxSize > 0 && consumed + len > maxSize) {
+        buffer.resize(0);
+        setError(JsonStreamReader::SizeLimitExceeded);
+        return false;
+    }
+    return true;
+}
+
+void JsonStreamReaderPrivate::skipWhitespace()
+{
+    Q_FOREVER {
+        int c = peek();
+        if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+            ++pos;
+        } else {
+            return;
+        }
+    }
+}
+
+JsonStreamReader::TokenType JsonStreamReaderPrivate::setError(JsonStreamReader::Error err)
+{
+    // Keep the first error, later ones are a consequence of it
+    if (error == JsonStreamReader::NoError) {
+        error = err;
+    }
+    tokenType = JsonStreamReader::Invalid;
+    return JsonStreamReader::Invalid;
+}
+
+JsonStreamReader::TokenType JsonStreamReaderPrivate::readValueToken()
+{
+    const int c = peek();
+    if (c == '{' || c == '[') {
+        return openContainer(char(c));
+    } else if (c == -1) {
+        return setError(JsonStreamReader::UnexpectedEndOfDocument);
+    }
+
+    if (!countElement()) {
+        return JsonStreamReader::Invalid;
+    }
+
+    JsonStreamReader::TokenType type;
+    if (c == '"') {
+        ++pos;
+        type = readString(JsonStreamReader::String);
+    } else if (c == '-' || (c >= '0' && c <= '9')) {
+        type = readNumber();
+    } else if (c == 't') {
+        boolean = true;
+        type = readLiteral("true", 4, JsonStreamReader::Bool);
+    } else if (c == 'f') {
+        boolean = false;
+        type = readLiteral("false", 5, JsonStreamReader::Bool);
+    } else if (c == 'n') {
+        type = readLiteral("null", 4, JsonStreamReader::Null);
+    } else {
+        return setError(JsonStreamReader::SyntaxError);
+    }
+
+    if (type != JsonStreamReader::Invalid) {
+        state = stack.isEmpty() ? Done : ExpectCommaOrEnd;
+    }
+    return type;
+}
+
+JsonStreamReader::TokenType JsonStreamReaderPrivate::readString(JsonStreamReader::TokenType type)
+{
+    raw.clear();
+    rawEscaped = false;
+
+    Q_FOREVER {
+        if (pos == buffer.size() && !fill()) {
+            return setError(JsonStreamReader::UnexpectedEndOfDocument);
+        }
+
+        // Copy everything up to the next quote, escape or control character
+        const char *begin = buffer.constData() + pos;
+        const int available = buffer.size() - pos;
+        int i = 0;
+        while (i < available) {
+            const uchar c = begin[i];
+            if (c == '"' || c == '\\' || c < 0x20) {
+                break;
+            }
+            ++i;
+        }
+        raw.append(begin, i);
+        pos += i;
+        if (i == available) {
+            continue;
+        }
+
+        const uchar c = begin[i];
+        if (c == '"') {
+            ++pos;
+            return tokenType = type;
+        } else if (c < 0x20) {
+            return setError(JsonStreamReader::SyntaxError);
+        }
+
+        // Escapes are validated now but only decoded by decodeString()
+        rawEscaped = true;
+        raw.append('\\');
+        ++pos;
+
+        const int escape = peek();
+        switch (escape) {
+        case '"':
+        case '\\':
+        case '/':
+        case 'b':
+        case 'f':
+        case 'n':
+        case 'r':
+        case 't':
+            raw.append(char(escape));
+            ++pos;
+            break;
+        case 'u':
+            raw.append('u');
+            ++pos;
+            for (int j = 0; j < 4; ++j) {
+                const int hex = peek();
+                if (!((hex >= '0' && hex <= '9') || (hex >= 'a' && hex <= 'f') || (hex >= 'A' && hex <= 'F'))) {
+                    return setError(hex == -1 ? JsonStreamReader::UnexpectedEndOfDocument : JsonStreamReader::SyntaxError);
+                }
+                raw.append(char(hex));
+                ++pos;
+            }
+            break;
+        case -1:
+            return setError(JsonStreamReader::UnexpectedEndOfDocument);
+        default:
+            return setError(JsonStreamReader::SyntaxError);
+        }
+    }
+}
+
+JsonStreamReader::TokenType JsonStreamReaderPrivate::readNumber()
+{
+    raw.clear();
+
+    int c = peek();
+    if (c == '-') {
+        raw.append(char(c));
+        ++pos;
+        c = peek();
+    }
+
+    if (c == '0') {
+        raw.append(char(c));
+        ++pos;
+        c = peek();
+    } else if (c >= '1' && c <= '9') {
+        while (c >= '0' && c <= '9') {
+            raw.append(char(c));
+            ++pos;
+            c = peek();
+        }
+    } else {
+        return setError(c == -1 ? JsonStreamReader::UnexpectedEndOfDocument : JsonStreamReader::SyntaxError);
+    }
+
+    if (c == '.') {
+        raw.append(char(c));
+        ++pos;
+        c = peek();
+        if (c < '0' || c > '9') {
+            return setError(c == -1 ? JsonStreamReader::UnexpectedEndOfDocument : JsonStreamReader::SyntaxError);
+        }
+        while (c >= '0' && c <= '9') {
+            raw.append(char(c));
+            ++pos;
+            c = peek();
+        }
+    }
+
+    if (c == 'e' || c == 'E') {
+        raw.append(char(c));
+        ++pos;
+        c = peek();
+        if (c == '+' || c == '-') {
+            raw.append(char(c));
+            ++pos;
+            c = peek();
+        }
+        if (c < '0' || c > '9') {
+            return setError(c == -1 ? JsonStreamReader::UnexpectedEndOfDocument : JsonStreamReader::SyntaxError);
+        }
+        while (c >= '0' && c <= '9') {
+            raw.append(char(c));
+            ++pos;
+            c = peek();
+        }
+    }
+
+    return tokenType = JsonStreamReader::Number;
+}
+
+JsonStreamReader::TokenType JsonStreamReaderPrivate::readLiteral(const char *literal, int size, JsonStreamReader::TokenType type)
+{
+    for (int i = 0; i < size; ++i) {
+        const int c = peek();
+        if (c != uchar(literal[i])) {
+            return setError(c == -1 ? JsonStreamReader::UnexpectedEndOfDocument : JsonStreamReader::SyntaxError);
+        }
+        ++pos;
+    }
+    return tokenType = type;
+}
+
+JsonStreamReader::TokenType JsonStreamReaderPrivate::openContainer(char type)
+{
+    if (!countElement()) {
+        return JsonStreamReader::Invalid;
+    }
+
+    if (stack.size() >= maxDepth) {
+        return setError(JsonStreamReader::DepthLimitExceeded);
+    }
+
+    ++pos;
+    stack.append(type);
+    if (type == '{') {
+        state = ExpectNameOrEnd;
+        return tokenType = JsonStreamReader::StartObject;
+    }
+    state = ExpectValueOrEnd;
+    return tokenType = JsonStreamReader::StartArray;
+}
+
+JsonStreamReader::TokenType JsonStreamReaderPrivate::closeContainer()
+{
+    ++pos;
+    const char type = stack.last();
+    stack.removeLast();
+    state = stack.isEmpty() ? Done : ExpectCommaOrEnd;
+    return tokenType = type == '{' ? JsonStreamReader::EndObject : JsonStreamReader::EndArray;
+}
+
+bool JsonStreamReaderPrivate::countElement()
+{
+    if (maxElements > 0 && ++elements > maxElements) {
+        setError(JsonStreamReader::ElementLimitExceeded);
+        return false;
+    }
+    return true;
+}
+
+QString JsonStreamReaderPrivate::decodeString() const
+{
+    if (!rawEscaped) {
+        return QString::fromUtf8(raw);
+    }
+
+    QString ret;
+    ret.reserve(raw.size());
+
+    const char *data = raw.constData();
+    const int size = raw.size();
+    int start = 0;
+    int i = 0;
+    while (i < size) {
+        if (data[i] != '\\') {
+            ++i;
+            continue;
+        }
+
+        if (i > start) {
+            ret.append(QString::fromUtf8(data + start, i - start));
+        }
+
+        // Escapes were validated by readString()
+        const char escape = data[i + 1];
+        i += 2;
+        switch (escape) {
+        case 'b':
+            ret.append(QLatin1Char('\b'));
+            break;
+        case 'f':
+            ret.append(QLatin1Char('\f'));
+            break;
+        case 'n':
+            ret.append(QLatin1Char('\n'));
+            break;
+        case 'r':
+            ret.append(QLatin1Char('\r'));
+            break;
+        case 't':
+            ret.append(QLatin1Char('\t'));
+            break;
+        case 'u':
+            // Surrogate pairs are two escapes that end up
+            // next to each other as UTF-16 code units
+            ret.append(QChar(ushort(QByteArray::fromRawData(data + i, 4).toUShort(0, 16))));
+            i += 4;
+            break;
+        default:
+            ret.append(QLatin1Char(escape));
+            break;
+        }
+        start = i;
+    }
+
+    if (i > start) {
+        ret.append(QString::fromUtf8(data + start, i - start));
+    }
+    return ret;
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CUTELYST_JSONSTREAMREADER_H
+#define CUTELYST_JSONSTREAMREADER_H
+
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonValue>
+
+class QIODevice;
+
+namespace Cutelyst {
+
+class JsonStreamReaderPrivate;
+/**
+ * Pull parser for JSON documents that reads directly from a
+ * QIODevice, like the request body, in small chunks.
+ *
+ * Only the current token is kept in memory, strings and numbers
+ * are only decoded when asked for, and values that aren't needed
+ * can be skipped with skipCurrentValue().
+ *
+ * \code
+ * JsonStreamReader reader(c->req()->body());
+ * reader.readNext(); // StartArray
+ * while (reader.readNext() == JsonStreamReader::StartObject) {
+ *     QJsonObject item = reader.readValue().toObject();
+ *     ...
+ * }
+ * \endcode
+ *
+ * readValue() and readDocument() are convenience methods that
+ * build QJsonValues, they don't recurse but Qt copies every
+ * nested object or array into its parent when it's inserted,
+ * so only the token API above avoids holding and copying the
+ * whole document.
+ *
+ * The size, depth and number of elements of the document
+ * are limited, the defaults can be changed on the [Cutelyst]
+ * section of the config with json_max_size, json_max_depth
+ * and json_max_elements, 0 means no limit for the size and the
+ * number of elements, the depth is always limited since code
+ * converting the values, like QJsonValue::toVariant(), recurses.
+ */
+class JsonStreamReader
+{
+    Q_DECLARE_PRIVATE(JsonStreamReader)
+    Q_DISABLE_COPY(JsonStreamReader)
+public:
+    enum TokenType {
+        NoToken,
+        Invalid,
+        StartObject,
+        EndObject,
+        StartArray,
+        EndArray,
+        Name,
+        String,
+        Number,
+        Bool,
+        Null,
+        EndDocument
+    };
+
+    enum Error {
+        NoError,
+        SyntaxError,
+        UnexpectedEndOfDocument,
+        SizeLimitExceeded,
+        DepthLimitExceeded,
+        ElementLimitExceeded
+    };
+
+    /**
+     * Creates a reader for \p device starting
+     * at it's current position
+     */
+    explicit JsonStreamReader(QIODevice *device);
+    virtual ~JsonStreamReader();
+
+    /**
+     * Maximum number of bytes read from the device
+     */
+    void setMaxSize(qint64 size);
+    qint64 maxSize() const;
+
+    /**
+     * Maximum nesting of objects and arrays, values
+     * lower than 1 reset it to the default of 512
+     */
+    void setMaxDepth(int depth);
+    int maxDepth() const;
+
+    /**
+     * Maximum number of values in the document,
+     * counting objects, arrays and scalars
+     */
+    void setMaxElements(qint64 elements);
+    qint64 maxElements() const;
+
+    /**
+     * Reads the next token and returns it's type, returns
+     * Invalid if an error happened, see error()
+     */
+    TokenType readNext();
+
+    TokenType tokenType() const;
+
+    /**
+     * Returns true after EndDocument or on error
+     */
+    bool atEnd() const;
+
+    /**
+     * Returns the current nesting level
+     */
+    int depth() const;
+
+    /**
+     * Returns the decoded text of a Name or String token
+     */
+    QString text() const;
+
+    /**
+     * Returns the value of a Number token
+     */
+    double number() const;
+
+    /**
+     * Returns the value of a Bool token
+     */
+    bool boolean() const;
+
+    /**
+     * Skips the value that starts at the current token,
+     * for objects and arrays the reader stops at the
+     * matching end token.
+     */
+    bool skipCurrentValue();
+
+    /**
+     * Builds the value that starts at the current token,
+     * returns an undefined value on error.
+     */
+    QJsonValue readValue();
+
+    /**
+     * Reads a whole document, which must be an object
+     * or an array, returns a null document on error.
+     */
+    QJsonDocument readDocument();
+
+    Error error() const;
+    QString errorString() const;
+
+    /**
+     * Number of bytes consumed from the device
+     */
+    qint64 offset() const;
+
+    /**
+     * Sets the limits used by new readers
+     */
+    static void setDefaultLimits(qint64 maxSize, int maxDepth, qint64 maxElements);
+
+protected:
+    JsonStreamReaderPrivate *d_ptr;
+};
+
+}
+
+#endif // CUTELYST_JSONSTREAMREADER_H
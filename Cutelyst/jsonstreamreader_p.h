@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CUTELYST_JSONSTREAMREADER_P_H
+#define CUTELYST_JSONSTREAMREADER_P_H
+
+#include "jsonstreamreader.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QVarLengthArray>
+
+class QIODevice;
+
+namespace Cutelyst {
+
+class JsonStreamReaderPrivate
+{
+public:
+    enum State {
+        ExpectValue,
+        ExpectValueOrEnd,
+        ExpectName,
+        ExpectNameOrEnd,
+        ExpectCommaOrEnd,
+        Done
+    };
+
+    // Returns the next byte without consuming it, or -1 at the end
+    inline int peek() {
+        if (pos == buffer.size() && !fill()) {
+            return -1;
+        }
+        return uchar(buffer.at(pos));
+    }
+    bool fill();
+    void skipWhitespace();
+
+    JsonStreamReader::TokenType setError(JsonStreamReader::Error error);
+    JsonStreamReader::TokenType readValueToken();
+    JsonStreamReader::TokenType readString(JsonStreamReader::TokenType type);
+    JsonStreamReader::TokenType readNumber();
+    JsonStreamReader::TokenType readLiteral(const char *literal, int size, JsonStreamReader::TokenType type);
+    JsonStreamReader::TokenType openContainer(char type);
+    JsonStreamReader::TokenType closeContainer();
+    bool countElement();
+
+    QString decodeString() const;
+
+    QIODevice *device;
+    QByteArray buffer;
+    int pos = 0;
+    qint64 consumed = 0;
+
+    qint64 maxSize;
+    int maxDepth;
+    qint64 maxElements;
+    qint64 elements = 0;
+
+    State state = ExpectValue;
+    // '{' or '[' for each open container
+    QVarLengthArray<char, 64> stack;
+
+    JsonStreamReader::TokenType tokenType = JsonStreamReader::NoToken;
+    JsonStreamReader::Error error = JsonStreamReader::NoError;
+    // Raw bytes of the current Name, String or Number token
+    QByteArray raw;
+    bool rawEscaped = false;
+    bool boolean = false;
+};
+
+}
+
+#endif // CUTELYST_JSONSTREAMREADER_P_H
@@ -0,0 +1,36 @@
+# - Compiles templates to C++ for the Cutelyst Precompiled view
+#
+#  cutelyst_precompile_templates(<target> <templates_dir>)
+#
+# Every file under <templates_dir> is compiled with
+# "cutelyst --precompile-templates" and the generated
+# source, which registers the templates by their path
+# relative to <templates_dir>, is added to <target>.
+#
+# Templates are rebuilt when they change, CMake must be
+# run again when templates are added or removed.
+
+function(cutelyst_precompile_templates target dir)
+    get_filename_component(templates_dir ${dir} ABSOLUTE)
+    file(GLOB_RECURSE templates ${templates_dir}/*)
+
+    if (TARGET cutelyst-skell)
+        set(compiler cutelyst-skell)
+    else ()
+        find_program(CUTELYST_EXECUTABLE cutelyst)
+        if (NOT CUTELYST_EXECUTABLE)
+            message(FATAL_ERROR "cutelyst executable not found, needed to precompile templates")
+        endif ()
+        set(compiler ${CUTELYST_EXECUTABLE})
+    endif ()
+
+    set(output ${CMAKE_CURRENT_BINARY_DIR}/${target}_templates.cpp)
+    add_custom_command(OUTPUT ${output}
+        COMMAND ${compiler} --precompile-templates ${templates_dir} --output ${output}
+        DEPENDS ${templates} ${compiler}
+        COMMENT "Precompiling templates of ${target}"
+        VERBATIM
+    )
+
+    set_property(TARGET ${target} APPEND PROPERTY SOURCES ${output})
+endfunction()
@@ -21,161 +21,428 @@
 #include "upload_p.h"
 #include "common.h"
 
+#include <QIODevice>
 #include <QRegularExpression>
+#include <QVarLengthArray>
 #include <QStringBuilder>
 
 using namespace Cutelyst;
 
-Uploads MultiPartFormDataParser::parse(QIODevice *body, const QString &contentType, int bufferSize)
+Uploads MultiPartFormDataParser::parse(QIODevice *body, const QString &contentType, int bufferSize, int maxParts)
 {
-    MultiPartFormDataParserPrivate *d;
+    MultiPartFormDataStreamPrivate d;
+    if (!d.setContentType(contentType)) {
+        return Uploads();
+    }
+    d.body = body;
+    d.maxParts = maxParts;
 
-    QRegularExpression re(QStringLiteral("boundary=([^\";]+)"));
-    QRegularExpressionMatch match = re.match(contentType);
-    if (match.hasMatch()) {
-        QString boundary = QLatin1String("--") % match.captured(1);
-        if (boundary.isEmpty()) {
-            return Uploads();
+    // The buffer must be able to hold a whole boundary
+    int buffer_size = qMax(bufferSize, d.boundaryLength * 2);
+    char *buffer = new char[buffer_size];
+
+    qint64 origPos = body->pos();
+    body->seek(0);
+    while (!body->atEnd()) {
+        qint64 len = body->read(buffer, buffer_size);
+        if (len <= 0 || !d.feed(buffer, len)) {
+            break;
         }
+    }
+    body->seek(origPos);
 
-        d = new MultiPartFormDataParserPrivate;
-        d->boundary = qstrdup(boundary.toLatin1().data());
-        d->boundaryLength = boundary.size();
-    } else {
-        return Uploads();
+    delete [] buffer;
+
+    // Uploads found before an error are still returned
+    return d.uploads;
+}
+
+MultiPartFormDataStream::MultiPartFormDataStream(const QString &contentType) :
+    d_ptr(new MultiPartFormDataStreamPrivate)
+{
+    Q_D(MultiPartFormDataStream);
+    if (!d->setContentType(contentType)) {
+        d->fail(QStringLiteral("Missing multipart boundary"));
     }
+}
 
-    d->body = body;
-    int buffer_size = qMin(bufferSize, 1024);
-//    qCDebug(CUTELYST_MULTIPART) << "Boudary:" << d->boundary << d->boundaryLength;
+MultiPartFormDataStream::~MultiPartFormDataStream()
+{
+    delete d_ptr;
+}
 
-    Uploads ret;
-    char *buffer = new char[buffer_size];
+bool MultiPartFormDataStream::isValid() const
+{
+    Q_D(const MultiPartFormDataStream);
+    return d->boundaryLength > 0;
+}
 
-    qint64 origPos = d->body->pos();
-    d->body->seek(0);
-    ret = d->execute(buffer, buffer_size);
-    d->body->seek(origPos);
+void MultiPartFormDataStream::setHandler(const QString &name, MultiPartFormDataHandler *handler)
+{
+    Q_D(MultiPartFormDataStream);
+    d->handlers.insert(name, handler);
+}
 
-    delete [] buffer;
-    delete [] d->boundary;
-    delete d;
+void MultiPartFormDataStream::setDefaultHandler(MultiPartFormDataHandler *handler)
+{
+    Q_D(MultiPartFormDataStream);
+    d->defaultHandler = handler;
+}
 
-    return ret;
+void MultiPartFormDataStream::setMaxParts(int maxParts)
+{
+    Q_D(MultiPartFormDataStream);
+    d->maxParts = maxParts;
 }
 
-Uploads MultiPartFormDataParserPrivate::execute(char *buffer, int bufferSize)
+bool MultiPartFormDataStream::feed(const char *data, qint64 len)
 {
-    Uploads ret;
-    QByteArray header;
-    Headers headers;
-    qint64 startOffset;
-    int boundaryPos = 0;
-    ParserState state = FindBoundary;
+    Q_D(MultiPartFormDataStream);
+    // The parser works on int sized buffers
+    while (len > 0) {
+        const int chunk = int(qMin(len, qint64(1 << 30)));
+        if (!d->feed(data, chunk)) {
+            return false;
+        }
+        data += chunk;
+        len -= chunk;
+    }
+    return true;
+}
 
-    while (!body->atEnd()) {
-        qint64 len = body->read(buffer, bufferSize);
-        int i = 0;
-        while (i < len) {
-            switch (state) {
-            case FindBoundary:
-                i += findBoundary(buffer + i, len - i, state, boundaryPos);
-                break;
-            case EndBoundaryCR:
-                // TODO the "--" case
-                if (buffer[i] != '\r') {
-//                    qCDebug(CUTELYST_MULTIPART) << "EndBoundaryCR return!";
-                    return ret;
-                }
-                state = EndBoundaryLF;
+bool MultiPartFormDataStream::read(QIODevice *device, int bufferSize)
+{
+    Q_D(MultiPartFormDataStream);
+    if (d->state == MultiPartFormDataStreamPrivate::Failed) {
+        return false;
+    }
+
+    QByteArray buffer(qMax(bufferSize, d->boundaryLength * 2), Qt::Uninitialized);
+    while (d->state != MultiPartFormDataStreamPrivate::Done) {
+        qint64 len = device->read(buffer.data(), buffer.size());
+        if (len < 0) {
+            return d->fail(device->errorString());
+        } else if (len == 0) {
+            if (device->atEnd()) {
+                return d->fail(QStringLiteral("Unexpected end of multipart body"));
+            }
+            // Sequential devices might get more data later
+            if (!device->waitForReadyRead(-1)) {
+                return d->fail(QStringLiteral("Unexpected end of multipart body"));
+            }
+            continue;
+        }
+
+        if (!d->feed(buffer.constData(), len)) {
+            return d->state == MultiPartFormDataStreamPrivate::Done;
+        }
+    }
+    return true;
+}
+
+bool MultiPartFormDataStream::atEnd() const
+{
+    Q_D(const MultiPartFormDataStream);
+    return d->state == MultiPartFormDataStreamPrivate::Done;
+}
+
+QString MultiPartFormDataStream::errorString() const
+{
+    Q_D(const MultiPartFormDataStream);
+    return d->errorString;
+}
+
+MultiPartFormDataStreamPrivate::MultiPartFormDataStreamPrivate()
+{
+}
+
+MultiPartFormDataStreamPrivate::~MultiPartFormDataStreamPrivate()
+{
+    delete [] boundary;
+}
+
+bool MultiPartFormDataStreamPrivate::setContentType(const QString &contentType)
+{
+    QRegularExpression re(QStringLiteral("boundary=([^\";]+)"));
+    QRegularExpressionMatch match = re.match(contentType);
+    if (!match.hasMatch()) {
+        return false;
+    }
+
+    // The CRLF before the boundary belongs to the delimiter (RFC 2046),
+    // so a "--boundary" line inside a part doesn't end it
+    QString value = QLatin1String("\r\n--") % match.captured(1);
+    boundary = qstrdup(value.toLatin1().data());
+    boundaryLength = value.size();
+//    qCDebug(CUTELYST_MULTIPART) << "Boudary:" << boundary << boundaryLength;
+
+    for (int i = 0; i < 256; ++i) {
+        skip[i] = boundaryLength;
+    }
+    for (int i = 0; i < boundaryLength - 1; ++i) {
+        skip[uchar(boundary[i])] = boundaryLength - 1 - i;
+    }
+
+    // The body may start with the first boundary, act
+    // as if the CRLF of the delimiter was already found
+    boundaryPos = 2;
+    return true;
+}
+
+bool MultiPartFormDataStreamPrivate::feed(const char *buffer, int len)
+{
+    if (state == Done || state == Failed) {
+        return false;
+    }
+
+    int i = 0;
+    while (i < len) {
+        switch (state) {
+        case FindBoundary:
+            i += findBoundary(buffer + i, len - i, state, boundaryPos);
+            break;
+        case EndBoundaryCR:
+            if (buffer[i] == '-') {
+                // The closing delimiter has a "--" suffix
+                state = EndBoundaryDash;
                 break;
-            case EndBoundaryLF:
-                if (buffer[i] != '\n') {
-//                    qCDebug(CUTELYST_MULTIPART) << "EndBoundaryLF return!";
-                    return ret;
+            } else if (buffer[i] != '\r') {
+                return fail(QStringLiteral("Missing CR after boundary"));
+            }
+            state = EndBoundaryLF;
+            break;
+        case EndBoundaryDash:
+            if (buffer[i] != '-') {
+                return fail(QStringLiteral("Missing - after closing boundary"));
+            }
+            state = Done;
+            offset += len;
+            return true;
+        case EndBoundaryLF:
+            if (buffer[i] != '\n') {
+                return fail(QStringLiteral("Missing LF after boundary"));
+            }
+            header.clear();
+            state = StartHeaders;
+            break;
+        case StartHeaders:
+            // A header line can be split across buffers
+            if (header.isEmpty() && buffer[i] == '\r') {
+                state = EndHeaders;
+            } else {
+                const char *pch = static_cast<const char *>(memchr(buffer + i, '\r', len - i));
+                if (pch == NULL) {
+                    header.append(buffer + i, len - i);
+                    i = len;
+                } else {
+                    header.append(buffer + i, pch - buffer - i);
+                    i = pch - buffer;
+                    state = FinishHeader;
                 }
+            }
+            break;
+        case FinishHeader:
+            if (buffer[i] == '\n') {
+                int dotdot = header.indexOf(':');
+                headers.setHeader(QString::fromLatin1(header.left(dotdot)),
+                                  QString::fromLatin1(header.mid(dotdot + 1).trimmed()));
                 header.clear();
                 state = StartHeaders;
-                break;
-            case StartHeaders:
-//                qCDebug(CUTELYST_MULTIPART) << "StartHeaders" << body->pos() - len + i;
-                if (buffer[i] == '\r') {
-                    state = EndHeaders;
-                } else if (buffer[i] == '-') {
-//                    qCDebug(CUTELYST_MULTIPART) << "StartHeaders return!";
-                    return ret;
-                } else {
-                    char *pch = strchr(buffer + i, '\r');
-                    if (pch == NULL) {
-                        header.append(buffer + i, len - i);
-                        i = len;
-                    } else {
-                        header.append(buffer + i, pch - buffer - i);
-                        i = pch - buffer;
-                        state = FinishHeader;
-                    }
-                }
-                break;
-            case FinishHeader:
-//                qCDebug(CUTELYST_MULTIPART) << "FinishHeader" << header;
-                if (buffer[i] == '\n') {
-                    int dotdot = header.indexOf(':');
-                    headers.setHeader(header.left(dotdot),
-                                      QString::fromLatin1(header.mid(dotdot + 1).trimmed()));
-                    header.clear();
-                    state = StartHeaders;
-                } else {
-//                    qCDebug(CUTELYST_MULTIPART) << "FinishHeader return!";
-                    return ret;
+            } else {
+                return fail(QStringLiteral("Missing LF after part header"));
+            }
+            break;
+        case EndHeaders:
+            if (buffer[i] != '\n') {
+                return fail(QStringLiteral("Missing LF after part headers"));
+            }
+            state = StartData;
+            break;
+        case StartData:
+            if (!startPart(offset + i)) {
+                return false;
+            }
+            state = EndData;
+            // fall through
+        case EndData:
+            i += findBoundary(buffer + i, len - i, state, boundaryPos);
+            if (state == EndBoundaryCR) {
+                const qint64 endOffset = offset + i - boundaryLength + 1;
+                if (!emitData(buffer, endOffset) || !endPart(endOffset)) {
+                    return false;
                 }
-                break;
-            case EndHeaders:
-//                qCDebug(CUTELYST_MULTIPART) << "EndHeaders";
-                if (buffer[i] == '\n') {
-                    state = StartData;
-                } else {
-//                    qCDebug(CUTELYST_MULTIPART) << "EndHeaders return!";
-                    return ret;
+            } else if (current) {
+                // Keep back what can still be the start of the delimiter
+                if (!emitData(buffer, offset + len - boundaryPos)) {
+                    return false;
                 }
-                break;
-            case StartData:
-//                qCDebug(CUTELYST_MULTIPART) << "StartData" << body->pos() - len + i;
-                startOffset = body->pos() - len + i;
-                state = EndData;
-            case EndData:
-                i += findBoundary(buffer + i, len - i, state, boundaryPos);
-                if (state == EndBoundaryCR) {
-//                    qCDebug(CUTELYST_MULTIPART) << "EndData" << body->pos() - len + i - boundaryLength - 1;
-                    UploadPrivate *priv = new UploadPrivate(body);
-                    priv->headers = headers;
-                    headers.clear();
-                    priv->startOffset = startOffset;
-                    priv->endOffset = body->pos() - len + i - boundaryLength - 1;
-                    ret << new Upload(priv);
+                if (emitted < offset + len) {
+                    const qint64 from = qMax(emitted, offset) - offset;
+                    pending.append(buffer + from, len - from);
                 }
             }
-            ++i;
+            break;
+        case Done:
+        case Failed:
+            return false;
         }
+        ++i;
     }
 
-    return ret;
+    offset += len;
+    return true;
 }
 
-int MultiPartFormDataParserPrivate::findBoundary(char *buffer, int len, MultiPartFormDataParserPrivate::ParserState &state, int &boundaryPos)
+bool MultiPartFormDataStreamPrivate::fail(const QString &error)
 {
-    int i = 0;
-    while (i < len) {
-        if (buffer[i] == boundary[boundaryPos]) {
-            if (++boundaryPos == boundaryLength) {
-//                qCDebug(CUTELYST_MULTIPART) << "FindBoundary:" << body->pos() - len + i;
+//    qCDebug(CUTELYST_MULTIPART) << "Failed to parse multipart body" << error;
+    state = Failed;
+    errorString = error;
+    return false;
+}
+
+bool MultiPartFormDataStreamPrivate::startPart(qint64 dataOffset)
+{
+    if (maxParts && ++parts > maxParts) {
+        qCWarning(CUTELYST_MULTIPART) << "Too many parts, the limit is" << maxParts;
+        return fail(QStringLiteral("Too many parts"));
+    }
+
+    startOffset = dataOffset;
+    emitted = dataOffset;
+    pending.clear();
+
+    current = 0;
+    if (!body) {
+        const QString &disposition = headers.header(QStringLiteral("Content-Disposition"));
+        QString name;
+        int start = disposition.indexOf(QLatin1String("name=\""));
+        if (start != -1) {
+            start += 6;
+            int end = disposition.indexOf(QLatin1Char('"'), start);
+            if (end != -1) {
+                name = disposition.mid(start, end - start);
+            }
+        }
+
+        current = handlers.value(name, defaultHandler);
+        if (current && !current->startPart(name, headers)) {
+            return fail(QStringLiteral("Handler of %1 stopped parsing").arg(name));
+        }
+    }
+    return true;
+}
+
+bool MultiPartFormDataStreamPrivate::emitData(const char *buffer, qint64 upTo)
+{
+    if (!current || upTo <= emitted) {
+        return true;
+    }
+
+    // Bytes kept from the previous buffers come first
+    if (emitted < offset) {
+        const int fromPending = int(qMin(upTo, offset) - emitted);
+        if (!current->partData(pending.constData(), fromPending)) {
+            return fail(QStringLiteral("Handler stopped parsing"));
+        }
+        pending.remove(0, fromPending);
+        emitted += fromPending;
+    }
+
+    if (upTo > emitted) {
+        if (!current->partData(buffer + (emitted - offset), upTo - emitted)) {
+            return fail(QStringLiteral("Handler stopped parsing"));
+        }
+        emitted = upTo;
+    }
+    return true;
+}
+
+bool MultiPartFormDataStreamPrivate::endPart(qint64 endOffset)
+{
+    if (body) {
+        UploadPrivate *priv = new UploadPrivate(body);
+        priv->headers = headers;
+        priv->startOffset = startOffset;
+        priv->endOffset = endOffset;
+        uploads << new Upload(priv);
+    } else if (current) {
+        MultiPartFormDataHandler *handler = current;
+        current = 0;
+        pending.clear();
+        if (!handler->endPart()) {
+            return fail(QStringLiteral("Handler stopped parsing"));
+        }
+    }
+    headers.clear();
+    return true;
+}
+
+int MultiPartFormDataStreamPrivate::findBoundary(const char *buffer, int len, MultiPartFormDataStreamPrivate::ParserState &state, int &boundaryPos)
+{
+    // boundaryPos is the number of boundary bytes the previous
+    // buffer ended with, check if the boundary continues here
+    if (boundaryPos) {
+        const int carry = boundaryPos;
+        const int head = qMin(len, boundaryLength - 1);
+        QVarLengthArray<char, 256> joined(carry + head);
+        memcpy(joined.data(), boundary, carry);
+        memcpy(joined.data() + carry, buffer, head);
+
+        for (int start = 0; start < carry && start + boundaryLength <= joined.size(); ++start) {
+            if (memcmp(joined.constData() + start, boundary, boundaryLength) == 0) {
                 boundaryPos = 0;
                 state = EndBoundaryCR;
-                return i;
+                return start + boundaryLength - 1 - carry;
             }
-        } else {
-            boundaryPos = 0;
         }
-        ++i;
+
+        if (len < boundaryLength - 1) {
+            // Too short to hold a boundary, so the carry can only grow
+            boundaryPos = partialMatch(joined.constData(), joined.size());
+            return len;
+        }
+    }
+
+    const int found = search(buffer, len);
+    if (found != -1) {
+        boundaryPos = 0;
+        state = EndBoundaryCR;
+        return found + boundaryLength - 1;
+    }
+
+    boundaryPos = partialMatch(buffer, len);
+    return len;
+}
+
+int MultiPartFormDataStreamPrivate::search(const char *buffer, int len) const
+{
+    const int last = boundaryLength - 1;
+    const char lastChar = boundary[last];
+
+    int pos = 0;
+    while (pos <= len - boundaryLength) {
+        const char c = buffer[pos + last];
+        if (c == lastChar && memcmp(buffer + pos, boundary, last) == 0) {
+            return pos;
+        }
+        pos += skip[uchar(c)];
+    }
+    return -1;
+}
+
+int MultiPartFormDataStreamPrivate::partialMatch(const char *buffer, int len) const
+{
+    // Longest suffix of the buffer that is a prefix of the boundary,
+    // the first byte is located with memchr to skip the impossible ones
+    const int start = qMax(0, len - boundaryLength + 1);
+    const char *pch = static_cast<const char *>(memchr(buffer + start, boundary[0], len - start));
+    while (pch) {
+        const int size = buffer + len - pch;
+        if (memcmp(pch, boundary, size) == 0) {
+            return size;
+        }
+        pch = static_cast<const char *>(memchr(pch + 1, boundary[0], buffer + len - pch - 1));
     }
-    return i;
+    return 0;
 }
@@ -32,8 +32,9 @@ public:
      * @param contentType can be the whole HTTP Content-Type
      * header or just it's value
      * @param body
+     * @param maxParts stops parsing after this many parts, zero means no limit
      */
-    static Uploads parse(QIODevice *body, const QString &contentType, int bufferSize = 4096);
+    static Uploads parse(QIODevice *body, const QString &contentType, int bufferSize = 64 * 1024, int maxParts = 0);
 };
 
 }
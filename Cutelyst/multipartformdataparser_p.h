@@ -21,30 +21,78 @@
 #define MULTIPARTFORMDATA_P_H
 
 #include "multipartformdataparser.h"
+#include "multipartformdatastream.h"
+
+#include <QtCore/QHash>
 
 namespace Cutelyst {
 
-class MultiPartFormDataParserPrivate
+/**
+ * Incremental parser shared by MultiPartFormDataParser, which
+ * creates Upload objects pointing into the body, and by
+ * MultiPartFormDataStream, which pushes parts to handlers.
+ */
+class MultiPartFormDataStreamPrivate
 {
 public:
     enum ParserState {
         FindBoundary,
         EndBoundaryCR,
         EndBoundaryLF,
+        EndBoundaryDash,
         StartHeaders,
         FinishHeader,
         EndHeaders,
         StartData,
-        EndData
+        EndData,
+        Done,
+        Failed
     };
 
-    Uploads execute(char *buffer, int bufferSize);
-    inline int findBoundary(char *buffer, int len, ParserState &state, int &boundaryPos);
+    MultiPartFormDataStreamPrivate();
+    ~MultiPartFormDataStreamPrivate();
+
+    bool setContentType(const QString &contentType);
+    bool feed(const char *buffer, int len);
+    bool fail(const QString &error);
+
+    bool startPart(qint64 offset);
+    bool emitData(const char *buffer, qint64 upTo);
+    bool endPart(qint64 endOffset);
+
+    int findBoundary(const char *buffer, int len, ParserState &state, int &boundaryPos);
+    int search(const char *buffer, int len) const;
+    int partialMatch(const char *buffer, int len) const;
+
+    char *boundary = 0;
+    int boundaryLength = 0;
+    // Boyer-Moore-Horspool bad character shifts
+    int skip[256];
+
+    ParserState state = FindBoundary;
+    int boundaryPos = 0;
+    // Offset of the current buffer in the body
+    qint64 offset = 0;
+    QByteArray header;
+    Headers headers;
+    qint64 startOffset = 0;
+    QString errorString;
+    // Zero means no limit
+    int maxParts = 0;
+    int parts = 0;
 
-    char *boundary;
-    int boundaryLength;
-    QIODevice *body;
+    // Set when creating Upload objects
+    QIODevice *body = 0;
+    Uploads uploads;
 
+    // Set when pushing data to handlers
+    QHash<QString, MultiPartFormDataHandler *> handlers;
+    MultiPartFormDataHandler *defaultHandler = 0;
+    MultiPartFormDataHandler *current = 0;
+    // Part data that can still be the start of a delimiter,
+    // it starts at the emitted offset
+    QByteArray pending;
+    qint64 emitted = 0;
 };
 
 }
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CUTELYST_MULTIPARTFORMDATASTREAM_H
+#define CUTELYST_MULTIPARTFORMDATASTREAM_H
+
+#include <Cutelyst/headers.h>
+
+class QIODevice;
+
+namespace Cutelyst {
+
+/**
+ * Receives the parts of a multipart/form-data body
+ * pushed by MultiPartFormDataStream.
+ *
+ * Any of the methods can return false to stop parsing.
+ */
+class MultiPartFormDataHandler
+{
+public:
+    virtual ~MultiPartFormDataHandler() {}
+
+    /**
+     * A part of the form field \p name started,
+     * \p headers are the part headers
+     */
+    virtual bool startPart(const QString &name, const Headers &headers) = 0;
+
+    /**
+     * Called zero or more times with the content of the current part,
+     * \p data is only valid during the call
+     */
+    virtual bool partData(const char *data, qint64 len) = 0;
+
+    /**
+     * The current part has ended
+     */
+    virtual bool endPart() = 0;
+};
+
+class MultiPartFormDataStreamPrivate;
+/**
+ * Push parser for multipart/form-data bodies.
+ *
+ * Instead of creating Upload objects that read from the request
+ * body, each part is passed to the handler registered for it's
+ * field name as it's parsed, so that it can be written to it's
+ * final destination, hashed or decompressed without another copy.
+ *
+ * \code
+ * MultiPartFormDataStream stream(c->req()->header(QStringLiteral("Content-Type")));
+ * stream.setHandler(QStringLiteral("file"), &fileHandler);
+ * if (!c->req()->readBody(&stream)) {
+ *     ...
+ * }
+ * \endcode
+ *
+ * Request::readBody() lets the uWSGI engine pass the body as it
+ * is read from the connection when uWSGI isn't buffering it, so
+ * the request body is never held in memory nor in a temporary file.
+ *
+ * Parts of fields without a handler are skipped.
+ */
+class MultiPartFormDataStream
+{
+    Q_DECLARE_PRIVATE(MultiPartFormDataStream)
+    Q_DISABLE_COPY(MultiPartFormDataStream)
+public:
+    /**
+     * \p contentType is the Content-Type header
+     * which must contain the boundary parameter
+     */
+    explicit MultiPartFormDataStream(const QString &contentType);
+    virtual ~MultiPartFormDataStream();
+
+    /**
+     * Returns true if a boundary was found on the content type
+     */
+    bool isValid() const;
+
+    /**
+     * Sets the handler of the parts named \p name,
+     * the handler is not owned by the stream
+     */
+    void setHandler(const QString &name, MultiPartFormDataHandler *handler);
+
+    /**
+     * Sets the handler of the parts that don't have
+     * a handler set for their name
+     */
+    void setDefaultHandler(MultiPartFormDataHandler *handler);
+
+    /**
+     * Stops parsing with an error once more than \p maxParts
+     * parts are found, zero (the default) means no limit
+     */
+    void setMaxParts(int maxParts);
+
+    /**
+     * Parses the next \p len bytes of the body, data can be
+     * pushed as it arrives in chunks of any size.
+     *
+     * Returns false if the body is malformed, a handler
+     * stopped parsing or the body has already ended.
+     */
+    bool feed(const char *data, qint64 len);
+
+    /**
+     * Feeds the content of \p device from it's current
+     * position until the end of the multipart body.
+     */
+    bool read(QIODevice *device, int bufferSize = 64 * 1024);
+
+    /**
+     * Returns true once the closing boundary was parsed
+     */
+    bool atEnd() const;
+
+    QString errorString() const;
+
+protected:
+    MultiPartFormDataStreamPrivate *d_ptr;
+};
+
+}
+
+#endif // CUTELYST_MULTIPARTFORMDATASTREAM_H
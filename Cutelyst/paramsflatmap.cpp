@@ -0,0 +1,383 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "paramsflatmap_p.h"
+
+#include <QtCore/QVarLengthArray>
+
+#include <algorithm>
+
+using namespace Cutelyst;
+
+namespace {
+
+// Keys are compared as UTF-8, ASCII keys which
+// are the common case don't need to allocate
+class Utf8Key
+{
+public:
+    explicit Utf8Key(const QString &key) {
+        const int size = key.size();
+        const QChar *chars = key.constData();
+        m_buffer.resize(size);
+        for (int i = 0; i < size; ++i) {
+            const ushort c = chars[i].unicode();
+            if (c >= 0x80) {
+                const QByteArray &utf8 = key.toUtf8();
+                m_buffer.resize(utf8.size());
+                memcpy(m_buffer.data(), utf8.constData(), utf8.size());
+                return;
+            }
+            m_buffer[i] = char(c);
+        }
+    }
+
+    inline const char *data() const { return m_buffer.constData(); }
+    inline int size() const { return m_buffer.size(); }
+
+private:
+    QVarLengthArray<char, 256> m_buffer;
+};
+
+}
+
+ParamsFlatMap::ParamsFlatMap()
+{
+}
+
+ParamsFlatMap::ParamsFlatMap(ParamsFlatMapData *data) : d(data)
+{
+}
+
+ParamsFlatMap::ParamsFlatMap(const ParamsFlatMap &other) :
+    d(other.d),
+    second(other.second)
+{
+}
+
+ParamsFlatMap::~ParamsFlatMap()
+{
+}
+
+ParamsFlatMap &ParamsFlatMap::operator=(const ParamsFlatMap &other)
+{
+    d = other.d;
+    second = other.second;
+    return *this;
+}
+
+ParamsFlatMap ParamsFlatMap::merged(const ParamsFlatMap &first, const ParamsFlatMap &second)
+{
+    // Views of views are flattened to keep lookups at two searches
+    if (first.second || second.second) {
+        return merged(first.flattened(), second.flattened());
+    }
+
+    if (second.isEmpty()) {
+        return first;
+    } else if (first.isEmpty()) {
+        return second;
+    }
+
+    ParamsFlatMap ret = first;
+    ret.second = second.d;
+    return ret;
+}
+
+bool ParamsFlatMap::isEmpty() const
+{
+    return size() == 0;
+}
+
+int ParamsFlatMap::size() const
+{
+    int ret = 0;
+    if (d) {
+        ret += d->entries.size();
+    }
+    if (second) {
+        ret += second->entries.size();
+    }
+    return ret;
+}
+
+void ParamsFlatMap::clear()
+{
+    d.reset();
+    second.reset();
+}
+
+bool ParamsFlatMap::contains(const QString &key) const
+{
+    const Utf8Key utf8(key);
+    int end;
+    if (d && d->equalRange(utf8.data(), utf8.size(), &end) != -1) {
+        return true;
+    }
+    return second && second->equalRange(utf8.data(), utf8.size(), &end) != -1;
+}
+
+int ParamsFlatMap::count(const QString &key) const
+{
+    const Utf8Key utf8(key);
+    int ret = 0;
+    int begin;
+    int end;
+    if (d && (begin = d->equalRange(utf8.data(), utf8.size(), &end)) != -1) {
+        ret += end - begin;
+    }
+    if (second && (begin = second->equalRange(utf8.data(), utf8.size(), &end)) != -1) {
+        ret += end - begin;
+    }
+    return ret;
+}
+
+QString ParamsFlatMap::value(const QString &key, const QString &defaultValue) const
+{
+    const Utf8Key utf8(key);
+    int begin;
+    int end;
+    if (d && (begin = d->equalRange(utf8.data(), utf8.size(), &end)) != -1) {
+        return d->value(begin);
+    }
+    if (second && (begin = second->equalRange(utf8.data(), utf8.size(), &end)) != -1) {
+        return second->value(begin);
+    }
+    return defaultValue;
+}
+
+QStringList ParamsFlatMap::values(const QString &key) const
+{
+    QStringList ret;
+    const Utf8Key utf8(key);
+    int begin;
+    int end;
+    if (d && (begin = d->equalRange(utf8.data(), utf8.size(), &end)) != -1) {
+        for (int i = begin; i < end; ++i) {
+            ret.append(d->value(i));
+        }
+    }
+    if (second && (begin = second->equalRange(utf8.data(), utf8.size(), &end)) != -1) {
+        for (int i = begin; i < end; ++i) {
+            ret.append(second->value(i));
+        }
+    }
+    return ret;
+}
+
+QStringList ParamsFlatMap::values() const
+{
+    QStringList ret;
+    ret.reserve(size());
+    const_iterator it = constBegin();
+    while (it != constEnd()) {
+        ret.append(it.value());
+        ++it;
+    }
+    return ret;
+}
+
+QStringList ParamsFlatMap::keys() const
+{
+    QStringList ret;
+    ret.reserve(size());
+    const_iterator it = constBegin();
+    while (it != constEnd()) {
+        ret.append(it.key());
+        ++it;
+    }
+    return ret;
+}
+
+QStringList ParamsFlatMap::uniqueKeys() const
+{
+    QStringList ret;
+    const_iterator it = constBegin();
+    while (it != constEnd()) {
+        const QString &key = it.key();
+        if (ret.isEmpty() || ret.last() != key) {
+            ret.append(key);
+        }
+        ++it;
+    }
+    return ret;
+}
+
+ParamsFlatMap::const_iterator ParamsFlatMap::constBegin() const
+{
+    return const_iterator(this, 0, 0);
+}
+
+ParamsFlatMap::const_iterator ParamsFlatMap::constEnd() const
+{
+    return const_iterator(this,
+                          d ? d->entries.size() : 0,
+                          second ? second->entries.size() : 0);
+}
+
+ParamsMultiMap ParamsFlatMap::toMap() const
+{
+    ParamsMultiMap ret;
+
+    QVector<QPair<QString, QString> > items;
+    items.reserve(size());
+    const_iterator it = constBegin();
+    while (it != constEnd()) {
+        items.append(qMakePair(it.key(), it.value()));
+        ++it;
+    }
+
+    // insertMulti() in the reverse order so that
+    // values() returns them in the sent order
+    for (int i = items.size() - 1; i >= 0; --i) {
+        const QPair<QString, QString> &item = items.at(i);
+        ret.insertMulti(item.first, item.second);
+    }
+
+    return ret;
+}
+
+ParamsFlatMap ParamsFlatMap::flattened() const
+{
+    if (!second) {
+        return *this;
+    }
+
+    ParamsFlatMapData *data = new ParamsFlatMapData;
+    const int offset = d->arena.size();
+    data->arena.reserve(offset + second->arena.size());
+    data->arena.append(d->arena);
+    data->arena.append(second->arena);
+
+    // The iterator already walks in the merged order
+    data->entries.reserve(size());
+    const_iterator it = constBegin();
+    while (it != constEnd()) {
+        if (it.onFirst()) {
+            data->entries.append(d->entries.at(it.m_first));
+        } else {
+            ParamsFlatMapData::Entry entry = second->entries.at(it.m_second);
+            entry.keyPos += offset;
+            entry.valuePos += offset;
+            data->entries.append(entry);
+        }
+        ++it;
+    }
+
+    return ParamsFlatMap(data);
+}
+
+ParamsFlatMap::const_iterator::const_iterator(const ParamsFlatMap *map, int first, int second) :
+    m_d(map->d),
+    m_secondData(map->second),
+    m_first(first),
+    m_second(second)
+{
+}
+
+bool ParamsFlatMap::const_iterator::onFirst() const
+{
+    const ParamsFlatMapData *first = m_d.data();
+    const ParamsFlatMapData *second = m_secondData.data();
+    if (!second || m_second >= second->entries.size()) {
+        return true;
+    } else if (!first || m_first >= first->entries.size()) {
+        return false;
+    }
+
+    // Equal keys come from the first map before the second
+    const ParamsFlatMapData::Entry &a = first->entries.at(m_first);
+    const ParamsFlatMapData::Entry &b = second->entries.at(m_second);
+    return ParamsFlatMapData::compare(first->arena.constData() + a.keyPos, a.keyLength,
+                                      second->arena.constData() + b.keyPos, b.keyLength) <= 0;
+}
+
+QString ParamsFlatMap::const_iterator::key() const
+{
+    if (onFirst()) {
+        return m_d->key(m_first);
+    }
+    return m_secondData->key(m_second);
+}
+
+QString ParamsFlatMap::const_iterator::value() const
+{
+    if (onFirst()) {
+        return m_d->value(m_first);
+    }
+    return m_secondData->value(m_second);
+}
+
+ParamsFlatMap::const_iterator &ParamsFlatMap::const_iterator::operator++()
+{
+    if (onFirst()) {
+        ++m_first;
+    } else {
+        ++m_second;
+    }
+    return *this;
+}
+
+ParamsFlatMap::const_iterator ParamsFlatMap::const_iterator::operator++(int)
+{
+    const_iterator ret = *this;
+    ++*this;
+    return ret;
+}
+
+void ParamsFlatMapData::sort()
+{
+    const char *data = arena.constData();
+    std::stable_sort(entries.begin(), entries.end(), [data] (const Entry &a, const Entry &b) {
+        return compare(data + a.keyPos, a.keyLength, data + b.keyPos, b.keyLength) < 0;
+    });
+}
+
+int ParamsFlatMapData::lowerBound(const char *key, int len) const
+{
+    const char *data = arena.constData();
+    int low = 0;
+    int high = entries.size();
+    while (low < high) {
+        const int mid = (low + high) >> 1;
+        const Entry &entry = entries.at(mid);
+        if (compare(data + entry.keyPos, entry.keyLength, key, len) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+int ParamsFlatMapData::equalRange(const char *key, int len, int *end) const
+{
+    const char *data = arena.constData();
+    const int begin = lowerBound(key, len);
+    int i = begin;
+    while (i < entries.size()) {
+        const Entry &entry = entries.at(i);
+        if (compare(data + entry.keyPos, entry.keyLength, key, len) != 0) {
+            break;
+        }
+        ++i;
+    }
+    *end = i;
+    return i == begin ? -1 : begin;
+}
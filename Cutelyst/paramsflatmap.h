@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PARAMSFLATMAP_H
+#define PARAMSFLATMAP_H
+
+#include <QtCore/QStringList>
+#include <QtCore/QSharedData>
+
+#include <Cutelyst/paramsmultimap.h>
+
+namespace Cutelyst {
+
+class ParamsFlatMapData;
+/**
+ * ParamsFlatMap is a read-only multi map used to
+ * store request parameters.
+ *
+ * Keys and values are kept as UTF-8 views into a single
+ * decoded buffer, sorted by key, so a lookup is a binary
+ * search on contiguous memory and QStrings are only created
+ * for what is accessed. Like ParamsMultiMap, values() return
+ * the values in the order they were sent.
+ *
+ * A map can also be a merged view of two maps, like the one
+ * returned by Request::parametersFlat(), where keys are looked
+ * up on the first map and then on the second one, without
+ * copying any of them.
+ *
+ * It converts to a ParamsMultiMap so code using the
+ * QMap based API keeps working.
+ */
+class ParamsFlatMap
+{
+public:
+    class const_iterator
+    {
+    public:
+        QString key() const;
+        QString value() const;
+        inline QString operator*() const { return value(); }
+
+        const_iterator &operator++();
+        const_iterator operator++(int);
+
+        inline bool operator==(const const_iterator &other) const
+        { return m_first == other.m_first && m_second == other.m_second; }
+        inline bool operator!=(const const_iterator &other) const
+        { return !(*this == other); }
+
+    private:
+        friend class ParamsFlatMap;
+        const_iterator(const ParamsFlatMap *map, int first, int second);
+        bool onFirst() const;
+
+        // Keeps the data alive when iterating a temporary map
+        QExplicitlySharedDataPointer<ParamsFlatMapData> m_d;
+        QExplicitlySharedDataPointer<ParamsFlatMapData> m_secondData;
+        int m_first;
+        int m_second;
+    };
+    typedef const_iterator ConstIterator;
+
+    ParamsFlatMap();
+    ParamsFlatMap(const ParamsFlatMap &other);
+    ~ParamsFlatMap();
+
+    ParamsFlatMap &operator=(const ParamsFlatMap &other);
+
+    /**
+     * Returns a view where keys are looked up
+     * on \p first and then on \p second
+     */
+    static ParamsFlatMap merged(const ParamsFlatMap &first, const ParamsFlatMap &second);
+
+    bool isEmpty() const;
+    int size() const;
+    inline int count() const { return size(); }
+    void clear();
+
+    bool contains(const QString &key) const;
+    int count(const QString &key) const;
+
+    /**
+     * Returns the first value sent for \p key
+     */
+    QString value(const QString &key, const QString &defaultValue = QString()) const;
+
+    /**
+     * Returns all values for \p key in the order they were sent
+     */
+    QStringList values(const QString &key) const;
+    QStringList values() const;
+
+    /**
+     * Returns all keys in ascending order, keys with
+     * multiple values appear multiple times
+     */
+    QStringList keys() const;
+    QStringList uniqueKeys() const;
+
+    const_iterator constBegin() const;
+    const_iterator constEnd() const;
+    inline const_iterator begin() const { return constBegin(); }
+    inline const_iterator end() const { return constEnd(); }
+
+    ParamsMultiMap toMap() const;
+    inline operator ParamsMultiMap() const { return toMap(); }
+
+private:
+    friend class UrlEncodedParser;
+    explicit ParamsFlatMap(ParamsFlatMapData *data);
+    ParamsFlatMap flattened() const;
+
+    QExplicitlySharedDataPointer<ParamsFlatMapData> d;
+    QExplicitlySharedDataPointer<ParamsFlatMapData> second;
+};
+
+}
+
+#endif // PARAMSFLATMAP_H
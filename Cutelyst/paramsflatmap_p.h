@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PARAMSFLATMAP_P_H
+#define PARAMSFLATMAP_P_H
+
+#include "paramsflatmap.h"
+
+#include <QtCore/QVector>
+
+#include <string.h>
+
+namespace Cutelyst {
+
+class ParamsFlatMapData : public QSharedData
+{
+public:
+    struct Entry {
+        int keyPos;
+        int keyLength;
+        int valuePos;
+        int valueLength;
+    };
+
+    // Sorts by key keeping equal keys in the sent order
+    void sort();
+
+    // Returns the first entry whose key is not less than key
+    int lowerBound(const char *key, int len) const;
+
+    // Returns the first entry of key, or -1, end is set past the last one
+    int equalRange(const char *key, int len, int *end) const;
+
+    inline const char *keyData(int i) const {
+        return arena.constData() + entries.at(i).keyPos;
+    }
+
+    inline QString key(int i) const {
+        const Entry &entry = entries.at(i);
+        return QString::fromUtf8(arena.constData() + entry.keyPos, entry.keyLength);
+    }
+
+    inline QString value(int i) const {
+        const Entry &entry = entries.at(i);
+        if (entry.valueLength) {
+            return QString::fromUtf8(arena.constData() + entry.valuePos, entry.valueLength);
+        }
+        return QString();
+    }
+
+    static inline int compare(const char *a, int aLength, const char *b, int bLength) {
+        int ret = memcmp(a, b, qMin(aLength, bLength));
+        if (ret) {
+            return ret;
+        }
+        return aLength - bLength;
+    }
+
+    // Decoded UTF-8 keys and values
+    QByteArray arena;
+    QVector<Entry> entries;
+};
+
+}
+
+Q_DECLARE_TYPEINFO(Cutelyst::ParamsFlatMapData::Entry, Q_PRIMITIVE_TYPE);
+
+#endif // PARAMSFLATMAP_P_H
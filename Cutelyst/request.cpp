@@ -20,11 +20,17 @@
 #include "request_p.h"
 #include "engine.h"
 #include "common.h"
-#include "multipartformdataparser.h"
-
+#include "application.h"
+#include "bodydecoder.h"
+#include "bodyinflater_p.h"
+#include "urlencodedparser_p.h"
+#include "hostnamecache_p.h"
+#include "multipartformdatastream.h"
+
+#include <QtCore/QBuffer>
+#include <QtCore/QFile>
 #include <QtCore/QStringBuilder>
 #include <QtCore/QRegularExpression>
-#include <QtCore/QJsonDocument>
 #include <QtNetwork/QHostInfo>
 #include <QtNetwork/QNetworkCookie>
 
@@ -61,15 +67,22 @@ QString Request::hostname() const
         }
     }
 
-    QHostInfo ptr = QHostInfo::fromName(d->remoteAddress.toString());
-    if (ptr.error() != QHostInfo::NoError) {
-        qCDebug(CUTELYST_REQUEST) << "DNS lookup for the client hostname failed" << d->remoteAddress;
-        d->remoteHostname = "";
-        return QString();
+    QString hostname;
+    if (HostnameCache::cached(d->remoteAddress, &hostname)) {
+        // Empty but not null, so a failed lookup isn't retried
+        d->remoteHostname = hostname.isNull() ? QStringLiteral("") : hostname;
+        return hostname;
     }
 
-    d->remoteHostname = ptr.hostName();
-    return d->remoteHostname;
+    // Don't block the engine, resolve it for the next requests
+    HostnameCache::prefetch(d->remoteAddress);
+    return QString();
+}
+
+void Request::lookupHostname(QObject *receiver, const char *member) const
+{
+    Q_D(const Request);
+    HostnameCache::lookup(d->remoteAddress, receiver, member);
 }
 
 quint16 Request::port() const
@@ -185,23 +198,70 @@ bool Request::secure() const
 QIODevice *Request::body() const
 {
     Q_D(const Request);
-    return d->body;
+    return d->decodedBody();
+}
+
+bool Request::readBody(MultiPartFormDataStream *stream, int bufferSize)
+{
+    Q_D(Request);
+    QIODevice *body = d->decodedBody();
+    if (!body) {
+        return false;
+    }
+
+    if (!d->bodyParsed) {
+        // The body is consumed if the engine reads it from
+        // the connection, so it can't be parsed afterwards
+        d->engine->streamBody(d->body);
+        d->bodyParam = ParamsFlatMap();
+        d->bodyParamMapped = false;
+        d->paramParsed = false;
+        d->bodyData = QVariant();
+        d->bodyDataDecoder = 0;
+        d->bodyParsed = true;
+    } else {
+        body->seek(0);
+    }
+
+    return stream->read(body, bufferSize);
 }
 
 QVariant Request::bodyData() const
 {
     Q_D(const Request);
     if (!d->bodyParsed) {
-        d->parseBody();
+        d->parseBody(this);
+    }
+
+    if (d->bodyDataDecoder) {
+        // Only decoded when asked
+        QIODevice *body = d->seekableBody();
+        qint64 posOrig = body->pos();
+        body->seek(0);
+
+        d->bodyData = d->bodyDataDecoder->decodeData(this, body, d->bodyParam);
+        d->bodyDataDecoder = 0;
+
+        body->seek(posOrig);
     }
     return d->bodyData;
 }
 
 ParamsMultiMap Request::bodyParameters() const
+{
+    Q_D(const Request);
+    if (!d->bodyParamMapped) {
+        d->bodyParamMap = bodyParametersFlat().toMap();
+        d->bodyParamMapped = true;
+    }
+    return d->bodyParamMap;
+}
+
+ParamsFlatMap Request::bodyParametersFlat() const
 {
     Q_D(const Request);
     if (!d->bodyParsed) {
-        d->parseBody();
+        d->parseBody(this);
     }
     return d->bodyParam;
 }
@@ -215,7 +275,23 @@ QString Request::queryKeywords() const
     return d->queryKeywords;
 }
 
+QByteArray Request::query() const
+{
+    Q_D(const Request);
+    return d->query;
+}
+
 ParamsMultiMap Request::queryParameters() const
+{
+    Q_D(const Request);
+    if (!d->queryParamMapped) {
+        d->queryParamMap = queryParametersFlat().toMap();
+        d->queryParamMapped = true;
+    }
+    return d->queryParamMap;
+}
+
+ParamsFlatMap Request::queryParametersFlat() const
 {
     Q_D(const Request);
     if (!d->queryParamParsed) {
@@ -228,12 +304,17 @@ ParamsMultiMap Request::parameters() const
 {
     Q_D(const Request);
     if (!d->paramParsed) {
-        d->param = queryParameters().unite(bodyParameters());
+        d->param = parametersFlat().toMap();
         d->paramParsed = true;
     }
     return d->param;
 }
 
+ParamsFlatMap Request::parametersFlat() const
+{
+    return ParamsFlatMap::merged(bodyParametersFlat(), queryParametersFlat());
+}
+
 QNetworkCookie Request::cookie(const QString &name) const
 {
     Q_D(const Request);
@@ -241,12 +322,26 @@ QNetworkCookie Request::cookie(const QString &name) const
         d->parseCookies();
     }
 
-    Q_FOREACH (const QNetworkCookie &cookie, d->cookies) {
-        if (cookie.name() == name) {
-            return cookie;
-        }
+    int index = d->cookieIndex(name);
+    if (index == -1) {
+        return QNetworkCookie();
     }
-    return QNetworkCookie();
+    return d->cookieAt(index);
+}
+
+QString Request::cookieValue(const QString &name) const
+{
+    Q_D(const Request);
+    if (!d->cookiesParsed) {
+        d->parseCookies();
+    }
+
+    int index = d->cookieIndex(name);
+    if (index == -1) {
+        return QString();
+    }
+    const RequestPrivate::CookieSpan &span = d->cookieSpans.at(index);
+    return d->cookieHeader.mid(span.valueBegin, span.valueLength);
 }
 
 QList<QNetworkCookie> Request::cookies() const
@@ -255,7 +350,13 @@ QList<QNetworkCookie> Request::cookies() const
     if (!d->cookiesParsed) {
         d->parseCookies();
     }
-    return d->cookies;
+
+    QList<QNetworkCookie> ret;
+    ret.reserve(d->cookieSpans.size());
+    for (int i = 0; i < d->cookieSpans.size(); ++i) {
+        ret.append(d->cookieAt(i));
+    }
+    return ret;
 }
 
 Headers Request::headers() const
@@ -270,6 +371,16 @@ QString Request::method() const
     return d->method;
 }
 
+Request::HttpMethod Request::httpMethod() const
+{
+    Q_D(const Request);
+    if (!d->httpMethodParsed) {
+        d->httpMethod = RequestPrivate::parseHttpMethod(d->method);
+        d->httpMethodParsed = true;
+    }
+    return d->httpMethod;
+}
+
 QString Request::protocol() const
 {
     Q_D(const Request);
@@ -286,7 +397,7 @@ QMap<QString, Cutelyst::Upload *> Request::uploads() const
 {
     Q_D(const Request);
     if (!d->bodyParsed) {
-        d->parseBody();
+        d->parseBody(this);
     }
     return d->uploads;
 }
@@ -347,89 +458,245 @@ void RequestPrivate::parseUrlQuery() const
     queryParamParsed = true;
 }
 
-void RequestPrivate::parseBody() const
+void RequestPrivate::parseBody(const Request *q) const
 {
-    ParamsMultiMap params;
-    QVariant data;
-
-    const QString &contentType = headers.contentType();
-    if (contentType == QLatin1String("application/x-www-form-urlencoded")) {
-        // Parse the query (BODY) of type "application/x-www-form-urlencoded"
-        // parameters ie "?foo=bar&bar=baz"
-        qint64 posOrig = body->pos();
-        body->seek(0);
-
-        params = parseUrlEncoded(body->readLine());
-        data = QVariant::fromValue(params);
-
-        body->seek(posOrig);
-    } else if (contentType == QLatin1String("multipart/form-data")) {
-        Uploads uploadList = MultiPartFormDataParser::parse(body, headers.header(QStringLiteral("content_type")));
-        for (int i = uploadList.size() - 1; i >= 0; --i) {
-            Upload *upload = uploadList.at(i);
-            uploads.insertMulti(upload->name(), upload);
-        }
-    } else if (contentType == QLatin1String("application/json")) {
+    ParamsFlatMap params;
+    const BodyDecoder *decoder = engine->app()->bodyDecoder(headers.contentType());
+    if (decoder) {
+        QIODevice *body = seekableBody();
         qint64 posOrig = body->pos();
         body->seek(0);
 
-        data = QJsonDocument::fromJson(body->readAll());
+        decoder->decodeParameters(q, body, params, uploads);
 
         body->seek(posOrig);
     }
 
-    // Asign it here so that we clean it in case no if matched
+    // Asign it here so that we clean it in case no decoder matched
     bodyParam = params;
-    bodyData = data;
+    bodyParamMapped = false;
+    paramParsed = false;
+    bodyData = QVariant();
+    bodyDataDecoder = decoder;
 
     bodyParsed = true;
 }
 
 void RequestPrivate::parseCookies() const
 {
-    QString cookiesHeader = headers.header(QStringLiteral("Cookie"));
-    cookies = QNetworkCookie::parseCookies(cookiesHeader.replace(';', '\n').toLatin1());
+    // Copying the header is cheap since QString is implicitly shared
+    cookieHeader = headers.value(QStringLiteral("cookie"));
+    cookieSpans.clear();
+
+    // Cookie: name1=value1; name2=value2 (RFC 6265 section 4.2.1)
+    const QChar *data = cookieHeader.constData();
+    const int size = cookieHeader.size();
+    int pos = 0;
+    while (pos < size) {
+        int end = pos;
+        int equal = -1;
+        while (end < size && data[end] != QLatin1Char(';')) {
+            if (equal == -1 && data[end] == QLatin1Char('=')) {
+                equal = end;
+            }
+            ++end;
+        }
+
+        // A pair without a '=' is not a valid cookie, skip it
+        if (equal != -1) {
+            int nameBegin = pos;
+            int nameEnd = equal;
+            while (nameBegin < nameEnd && data[nameBegin].isSpace()) {
+                ++nameBegin;
+            }
+            while (nameEnd > nameBegin && data[nameEnd - 1].isSpace()) {
+                --nameEnd;
+            }
+
+            int valueBegin = equal + 1;
+            int valueEnd = end;
+            while (valueBegin < valueEnd && data[valueBegin].isSpace()) {
+                ++valueBegin;
+            }
+            while (valueEnd > valueBegin && data[valueEnd - 1].isSpace()) {
+                --valueEnd;
+            }
+
+            if (nameBegin != nameEnd) {
+                CookieSpan span;
+                span.nameBegin = nameBegin;
+                span.nameLength = nameEnd - nameBegin;
+                span.valueBegin = valueBegin;
+                span.valueLength = valueEnd - valueBegin;
+                cookieSpans.append(span);
+            }
+        }
+        pos = end + 1;
+    }
+
     cookiesParsed = true;
 }
 
-ParamsMultiMap RequestPrivate::parseUrlEncoded(const QByteArray &line)
+int RequestPrivate::cookieIndex(const QString &name) const
 {
-    ParamsMultiMap ret;
-    const QList<QByteArray> &items = line.split('&');
-    for (int i = items.size() - 1; i >= 0; --i) {
-        const QByteArray &parameter = items.at(i);
-        if (parameter.isEmpty()) {
-            continue;
+    for (int i = 0; i < cookieSpans.size(); ++i) {
+        const CookieSpan &span = cookieSpans.at(i);
+        if (span.nameLength == name.size() &&
+                cookieHeader.midRef(span.nameBegin, span.nameLength) == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+QNetworkCookie RequestPrivate::cookieAt(int index) const
+{
+    const CookieSpan &span = cookieSpans.at(index);
+    return QNetworkCookie(cookieHeader.midRef(span.nameBegin, span.nameLength).toLatin1(),
+                          cookieHeader.midRef(span.valueBegin, span.valueLength).toLatin1());
+}
+
+ParamsFlatMap RequestPrivate::parseUrlEncoded(const QByteArray &line)
+{
+    return UrlEncodedParser::parse(line);
+}
+
+Request::HttpMethod RequestPrivate::parseHttpMethod(const QString &method)
+{
+    // Methods are case-sensitive (RFC 7230), so
+    // the size is enough to pick the candidates
+    switch (method.size()) {
+    case 3:
+        if (method == QLatin1String("GET")) {
+            return Request::Get;
+        } else if (method == QLatin1String("PUT")) {
+            return Request::Put;
+        }
+        break;
+    case 4:
+        if (method == QLatin1String("POST")) {
+            return Request::Post;
+        } else if (method == QLatin1String("HEAD")) {
+            return Request::Head;
+        }
+        break;
+    case 5:
+        if (method == QLatin1String("PATCH")) {
+            return Request::Patch;
+        } else if (method == QLatin1String("TRACE")) {
+            return Request::Trace;
+        }
+        break;
+    case 6:
+        if (method == QLatin1String("DELETE")) {
+            return Request::Delete;
         }
+        break;
+    case 7:
+        if (method == QLatin1String("OPTIONS")) {
+            return Request::Options;
+        } else if (method == QLatin1String("CONNECT")) {
+            return Request::Connect;
+        }
+        break;
+    }
+    return Request::Other;
+}
 
-        const QList<QByteArray> &parts = parameter.split('=');
-        if (parts.size() == 2) {
-            QByteArray value = parts.at(1);
-            if (value.length()) {
-                ret.insertMulti(QUrl::fromPercentEncoding(parts.at(0)),
-                                QUrl::fromPercentEncoding(value.replace('+', ' ')));
-                continue;
+RequestPrivate::~RequestPrivate()
+{
+    delete bodySpool;
+    delete bodyInflater;
+}
+
+QIODevice *RequestPrivate::decodedBody() const
+{
+    if (bodyEncodingChecked) {
+        return bodyDecoded;
+    }
+    bodyEncodingChecked = true;
+    bodyDecoded = body;
+
+    const QString &encoding = headers.contentEncoding();
+    if (body && !encoding.isEmpty() && encoding.compare(QLatin1String("identity"), Qt::CaseInsensitive) != 0) {
+        // Kept around as the RequestPrivate might be reused
+        if (!bodyInflater) {
+            bodyInflater = new BodyInflater;
+        }
+
+        if (bodyInflater->setDevice(body, encoding, engine->maxDecompressedBodySize())) {
+            bodyDecoded = bodyInflater;
+        } else {
+            qCWarning(CUTELYST_REQUEST) << "Unsupported request Content-Encoding:" << encoding;
+        }
+    }
+    return bodyDecoded;
+}
+
+QIODevice *RequestPrivate::seekableBody() const
+{
+    QIODevice *decoded = decodedBody();
+    if (!bodyInflater || decoded != bodyInflater) {
+        return decoded;
+    } else if (bodySpool) {
+        return bodySpool;
+    }
+
+    QBuffer *buffer = new QBuffer;
+    buffer->open(QIODevice::ReadWrite);
+    bodySpool = buffer;
+
+    bodyInflater->seek(0);
+    QByteArray block(64 * 1024, Qt::Uninitialized);
+    qint64 len;
+    while ((len = bodyInflater->read(block.data(), block.size())) > 0) {
+        if (buffer && buffer->size() + len > engine->bodyBufferSize()) {
+            // Large bodies don't stay in memory
+            QFile *file = Engine::createBodyBuffer(0);
+            if (file) {
+                file->write(buffer->data());
+                delete buffer;
+                buffer = 0;
+                bodySpool = file;
             }
         }
-        ret.insertMulti(QUrl::fromPercentEncoding(parts.first()),
-                        QString());
+        bodySpool->write(block.constData(), len);
+    }
 
+    if (len < 0) {
+        qCWarning(CUTELYST_REQUEST) << "Failed to inflate request body:" << bodyInflater->errorString();
     }
-    return ret;
+    bodySpool->seek(0);
+    return bodySpool;
 }
 
 void RequestPrivate::reset()
 {
+    httpMethodParsed = false;
     args = QStringList();
     captures = QStringList();
     urlParsed = false;
     baseParsed = false;
     cookiesParsed = false;
+    cookieHeader.clear();
     queryParamParsed = false;
     queryKeywords.clear();
     queryParam.clear();
+    queryParamMapped = false;
+    queryParamMap.clear();
     bodyParsed = false;
+    bodyParamMapped = false;
+    bodyParamMap.clear();
     paramParsed = false;
+    param.clear();
+    bodyDataDecoder = 0;
+    bodyEncodingChecked = false;
+    bodyDecoded = 0;
+    if (bodyInflater) {
+        bodyInflater->close();
+    }
     qDeleteAll(uploads);
     uploads.clear();
+    delete bodySpool;
+    bodySpool = 0;
 }
@@ -24,6 +24,7 @@
 #include <QtCore/qstringlist.h>
 
 #include <Cutelyst/paramsmultimap.h>
+#include <Cutelyst/paramsflatmap.h>
 #include <Cutelyst/headers.h>
 
 class QIODevice;
@@ -34,6 +35,7 @@ namespace Cutelyst {
 
 class Engine;
 class Upload;
+class MultiPartFormDataStream;
 
 typedef QList<Upload *> Uploads;
 
@@ -62,7 +64,20 @@ class Request : public QObject
     Q_PROPERTY(QString userAgent READ userAgent)
     Q_PROPERTY(QString referer READ referer)
     Q_PROPERTY(QString remoteUser READ remoteUser)
+    Q_ENUMS(HttpMethod)
 public:
+    enum HttpMethod {
+        Other = 0, // Not a well known method, see method()
+        Get,
+        Head,
+        Post,
+        Put,
+        Delete,
+        Options,
+        Patch,
+        Trace,
+        Connect
+    };
     virtual ~Request();
 
     /**
@@ -74,11 +89,27 @@ public:
      * Returns the hostname of the client,
      * or null if not found or an error has happened.
      *
-     * This functions makes blocking call to do a reverse
-     * DNS lookup if the engine didn't set the hostname.
+     * This function never blocks, it only returns the hostname
+     * if the engine has set it or if it's in the process wide
+     * reverse DNS cache. On a cache miss it returns null and
+     * starts a lookup in the background, so that following
+     * requests from the same address get it.
+     *
+     * \sa lookupHostname()
      */
     QString hostname() const;
 
+    /**
+     * Calls \p member on \p receiver with the hostname of the
+     * client, which is empty if the reverse DNS lookup fails.
+     * The slot must have a (const QString &) signature.
+     *
+     * If the hostname is cached the slot is called right away,
+     * otherwise it's called from the event loop once the lookup
+     * finishes.
+     */
+    void lookupHostname(QObject *receiver, const char *member) const;
+
     /**
      * Returns the originating port of the client
      */
@@ -177,6 +208,16 @@ public:
      */
     QIODevice *body() const;
 
+    /**
+     * Feeds the multipart/form-data body to \p stream, engines
+     * that can read it from the connection as it arrives do so
+     * instead of buffering the whole body first.
+     *
+     * Unless the body was already parsed it can't be read again,
+     * bodyParameters(), bodyData() and uploads() will be empty.
+     */
+    bool readBody(MultiPartFormDataStream *stream, int bufferSize = 64 * 1024);
+
     /**
      * Returns a QVariant representation of POST/PUT body data that is not classic HTML
      * form data, such as JSON, XML, etc. By default, Cutelyst will parse incoming
@@ -193,21 +234,27 @@ public:
     QVariant bodyData() const;
 
     /**
-     * Returns a QMultiHash of body (POST) parameters
+     * Returns a ParamsMultiMap of body (POST) parameters
      */
     ParamsMultiMap bodyParameters() const;
 
+    /**
+     * Returns the body (POST) parameters as a ParamsFlatMap,
+     * which is cheaper to get and to look up than bodyParameters()
+     */
+    ParamsFlatMap bodyParametersFlat() const;
+
     /**
      * Convenience method for geting a single body value passing a key and an optional default value
      */
     inline QString bodyParameter(const QString &key, const QString &defaultValue = QString()) const
-    { return bodyParameters().value(key, defaultValue); }
+    { return bodyParametersFlat().value(key, defaultValue); }
 
     /**
      * Convenience method for geting all body values passing a key
      */
     inline QStringList bodyParameters(const QString &key) const
-    { return bodyParameters().values(key); }
+    { return bodyParametersFlat().values(key); }
 
     /**
      * Short for bodyParameters()
@@ -219,13 +266,13 @@ public:
      * Convenience method for geting a single body value passing a key and an optional default value
      */
     inline QString bodyParam(const QString &key, const QString &defaultValue = QString()) const
-    { return bodyParameters().value(key, defaultValue); }
+    { return bodyParametersFlat().value(key, defaultValue); }
 
     /**
      * Convenience method for geting all body values passing a key
      */
     inline QStringList bodyParams(const QString &key) const
-    { return bodyParameters().values(key); }
+    { return bodyParametersFlat().values(key); }
 
     /**
      * Contains the keywords portion of a query string, when no '=' signs are present.
@@ -237,21 +284,32 @@ public:
     QString queryKeywords() const;
 
     /**
-     * Returns a QMultiHash containing the query string (GET) parameters
+     * Returns the raw query string, without the '?' and not decoded
+     */
+    QByteArray query() const;
+
+    /**
+     * Returns a ParamsMultiMap containing the query string (GET) parameters
      */
     ParamsMultiMap queryParameters() const;
 
+    /**
+     * Returns the query string (GET) parameters as a ParamsFlatMap,
+     * which is cheaper to get and to look up than queryParameters()
+     */
+    ParamsFlatMap queryParametersFlat() const;
+
     /**
      * Convenience method for geting a single query value passing a key and an optional default value
      */
     inline QString queryParameter(const QString &key, const QString &defaultValue = QString()) const
-    { return queryParameters().value(key, defaultValue); }
+    { return queryParametersFlat().value(key, defaultValue); }
 
     /**
      * Convenience method for geting all query values passing a key
      */
     inline QStringList queryParameters(const QString &key) const
-    { return queryParameters().values(key); }
+    { return queryParametersFlat().values(key); }
 
     /**
      * Short for queryParameters()
@@ -263,33 +321,40 @@ public:
      * Convenience method for geting a single query value passing a key and an optional default value
      */
     inline QString queryParam(const QString &key, const QString &defaultValue = QString()) const
-    { return queryParameters().value(key, defaultValue); }
+    { return queryParametersFlat().value(key, defaultValue); }
 
     /**
      * Convenience method for geting all query values passing a key
      */
     inline QStringList queryParams(const QString &key) const
-    { return queryParameters().values(key); }
+    { return queryParametersFlat().values(key); }
 
     /**
-     * Returns a QMultiHash containing both the query parameters (GET)
+     * Returns a ParamsMultiMap containing both the query parameters (GET)
      * and the body parameters (POST)
      */
     ParamsMultiMap parameters() const;
 
+    /**
+     * Returns a ParamsFlatMap containing both the query parameters (GET)
+     * and the body parameters (POST), this is a view on top of both so
+     * nothing is copied, body parameters are looked up first.
+     */
+    ParamsFlatMap parametersFlat() const;
+
     /**
      * Returns the value specified by key, it's equivalent to calling
      * parameters().value().
      */
     inline QString param(const QString &key, const QString &defaultValue = QString()) const
-    { return parameters().value(key, defaultValue); }
+    { return parametersFlat().value(key, defaultValue); }
 
     /**
      * Returns the values specified by key, it's equivalent to calling
      * parameters().values().
      */
     inline QStringList params(const QString &key) const
-    { return parameters().values(key); }
+    { return parametersFlat().values(key); }
 
     /**
      * Short for parameters()
@@ -311,6 +376,14 @@ public:
      */
     QNetworkCookie cookie(const QString &name) const;
 
+    /**
+     * Returns the value of the cookie with the given name,
+     * or an empty string if it was not sent. Unlike cookie()
+     * this doesn't create a QNetworkCookie, so it's the
+     * cheapest way to look up a single cookie.
+     */
+    QString cookieValue(const QString &name) const;
+
     /**
      * Returns all the cookie from the request
      */
@@ -331,6 +404,13 @@ public:
      */
     QString method() const;
 
+    /**
+     * Returns the request method as an enum, this is cheaper
+     * to compare than method(). Methods that are not well known
+     * are returned as Request::Other.
+     */
+    HttpMethod httpMethod() const;
+
     /**
      * Returns the protocol (HTTP/1.0 or HTTP/1.1) used for the current request.
      */
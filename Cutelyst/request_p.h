@@ -27,21 +27,36 @@
 #include <QtCore/QStringList>
 #include <QtCore/QUrlQuery>
 #include <QtCore/QUrl>
+#include <QtCore/QVarLengthArray>
 #include <QtNetwork/QHostAddress>
 #include <QtNetwork/QNetworkCookie>
 
 namespace Cutelyst {
 
 class Engine;
+class BodyDecoder;
+class BodyInflater;
 class RequestPrivate
 {
 public:
+    ~RequestPrivate();
+
     // call reset before reusing it
     void reset();
 
+    // Returns the body with the Content-Encoding removed
+    QIODevice *decodedBody() const;
+
+    // Same as decodedBody() but an inflated body is spooled
+    // once, so decoders and uploads can seek on it without
+    // restarting the decompression
+    QIODevice *seekableBody() const;
+
     void parseUrlQuery() const;
-    void parseBody() const;
+    void parseBody(const Request *q) const;
     void parseCookies() const;
+    int cookieIndex(const QString &name) const;
+    QNetworkCookie cookieAt(int index) const;
 
     // Manually filled by the Engine
     QString method;
@@ -68,33 +83,58 @@ protected:
     friend class Request;
     friend class Dispatcher;
     friend class DispatchType;
+    friend class ActionRESTPrivate;
+    friend class BodyDecoderUrlEncoded;
 
-    static ParamsMultiMap parseUrlEncoded(const QByteArray &line);
+    static ParamsFlatMap parseUrlEncoded(const QByteArray &line);
+    static Request::HttpMethod parseHttpMethod(const QString &method);
 
     // Engines don't need to touch this
     QStringList args;
     QStringList captures;
     QString match;
 
+    mutable bool httpMethodParsed = false;
+    mutable Request::HttpMethod httpMethod = Request::Other;
+
     mutable bool urlParsed = false;
     mutable QUrl url;
 
     mutable bool baseParsed = false;
     mutable QString base;
 
+    // Cookies are indexed as spans of the raw header,
+    // QStrings are only created when a value is requested
+    struct CookieSpan {
+        int nameBegin;
+        int nameLength;
+        int valueBegin;
+        int valueLength;
+    };
     mutable bool cookiesParsed = false;
-    mutable QList<QNetworkCookie> cookies;
+    mutable QString cookieHeader;
+    mutable QVarLengthArray<CookieSpan, 32> cookieSpans;
 
     mutable bool queryParamParsed = false;
-    mutable ParamsMultiMap queryParam;
+    mutable ParamsFlatMap queryParam;
+    mutable bool queryParamMapped = false;
+    mutable ParamsMultiMap queryParamMap;
     mutable QString queryKeywords;
 
     mutable bool bodyParsed = false;
-    mutable ParamsMultiMap bodyParam;
-    mutable QVariant bodyData;
-
+    mutable ParamsFlatMap bodyParam;
+    mutable bool bodyParamMapped = false;
+    mutable ParamsMultiMap bodyParamMap;
     mutable bool paramParsed = false;
     mutable ParamsMultiMap param;
+    mutable QVariant bodyData;
+    mutable bool bodyEncodingChecked = false;
+    mutable QIODevice *bodyDecoded = 0;
+    mutable BodyInflater *bodyInflater = 0;
+    mutable QIODevice *bodySpool = 0;
+
+    // Decodes bodyData() the first time it is called
+    mutable const BodyDecoder *bodyDataDecoder = 0;
 
     mutable QMap<QString, Upload *> uploads;
 };
@@ -22,6 +22,8 @@
 #include "context_p.h"
 #include "engine.h"
 #include "common.h"
+#include "segmentedbuffer.h"
+#include "bodyencoder.h"
 
 #include <QBuffer>
 
@@ -33,8 +35,13 @@ Response::Response(Context *c) : QObject(c)
     d_ptr->context = c;
 }
 
+BodyEncoder::~BodyEncoder()
+{
+}
+
 Response::~Response()
 {
+    delete d_ptr->bodyEncoder;
     delete d_ptr->body;
     delete d_ptr;
 }
@@ -64,14 +71,38 @@ QByteArray &Response::body()
     QBuffer *buf = qobject_cast<QBuffer*>(d->body);
     if (!buf) {
         buf = new QBuffer;
+        SegmentedBuffer *segmented = qobject_cast<SegmentedBuffer*>(d->body);
+        if (segmented) {
+            // Keeps what views rendered into bodyBuffer()
+            buf->setData(segmented->toByteArray());
+        }
         if (!buf->open(QIODevice::ReadWrite)) {
             qCCritical(CUTELYST_RESPONSE) << "Could not open QBuffer!";
         }
+        delete d->body;
         d->body = buf;
     }
     return buf->buffer();
 }
 
+SegmentedBuffer *Response::bodyBuffer()
+{
+    Q_D(Response);
+
+    SegmentedBuffer *buf = qobject_cast<SegmentedBuffer*>(d->body);
+    if (!buf) {
+        buf = new SegmentedBuffer;
+        QBuffer *old = qobject_cast<QBuffer*>(d->body);
+        if (old) {
+            // Referenced, not copied
+            buf->append(old->buffer());
+        }
+        delete d->body;
+        d->body = buf;
+    }
+    return buf;
+}
+
 QIODevice *Response::bodyDevice()
 {
     Q_D(Response);
@@ -81,14 +112,38 @@ QIODevice *Response::bodyDevice()
 void Response::setBody(QIODevice *body)
 {
     Q_D(Response);
-    Q_ASSERT(body && body->isOpen() && body->isReadable());
+    Q_ASSERT(!body || (body->isOpen() && body->isReadable()));
 
-    if (d->body && d->body != d->body) {
+    if (d->body && d->body != body) {
         delete d->body;
     }
     d->body = body;
 }
 
+void Response::setBodyEncoder(BodyEncoder *encoder)
+{
+    Q_D(Response);
+    if (d->finalizedHeaders) {
+        qCWarning(CUTELYST_RESPONSE) << "Can not set a body encoder after the headers were sent";
+        delete encoder;
+        return;
+    }
+
+    if (d->bodyEncoder != encoder) {
+        delete d->bodyEncoder;
+    }
+    d->bodyEncoder = encoder;
+    if (encoder) {
+        d->headers.removeHeader(QStringLiteral("Content-Length"));
+    }
+}
+
+BodyEncoder *Response::bodyEncoder() const
+{
+    Q_D(const Response);
+    return d->bodyEncoder;
+}
+
 QString Response::contentEncoding() const
 {
     Q_D(const Response);
@@ -30,6 +30,8 @@ class QNetworkCookie;
 namespace Cutelyst {
 
 class Context;
+class SegmentedBuffer;
+class BodyEncoder;
 class ResponsePrivate;
 class Response : public QObject
 {
@@ -73,6 +75,7 @@ public:
         UnsupportedMediaType         = 415,
         RequestedRangeNotSatisfiable = 416,
         ExpectationFailed            = 417,
+        RequestHeaderFieldsTooLarge  = 431,
         InternalServerError          = 500,
         NotImplemented               = 501,
         BadGateway                   = 502,
@@ -104,9 +107,21 @@ public:
      * QByteArray which implicity sets the body
      * device to a QBuffer, even if one was already
      * set.
+     *
+     * A body in a SegmentedBuffer, where views render
+     * to, is copied into the QBuffer, other devices
+     * are discarded.
      */
     QByteArray &body();
 
+    /**
+     * Returns the body as a SegmentedBuffer, which becomes the
+     * body device, keeping the data of a body() set before.
+     * Appending to it doesn't reallocate the whole body as it
+     * grows, and engines write its segments without copying.
+     */
+    SegmentedBuffer *bodyBuffer();
+
     /**
      * Returns the body IO device (if any) of this response.
      */
@@ -116,10 +131,24 @@ public:
      * Sets an IO device as the response body,
      * the open mode must be at least QIODevice::ReadOnly.
      * This function takes ownership of your device
-     * deleting after the request has completed
+     * deleting after the request has completed,
+     * passing 0 removes the body.
      */
     void setBody(QIODevice *body);
 
+    /**
+     * Sets an encoder for the body, like a compressor, it
+     * must be set before the headers are finalized, and takes
+     * ownership of the encoder. Setting it removes the
+     * Content-Length header, the body is sent chunked.
+     */
+    void setBodyEncoder(BodyEncoder *encoder);
+
+    /**
+     * Returns the body encoder, or 0 if there is none
+     */
+    BodyEncoder *bodyEncoder() const;
+
     /**
      * Short for headers().contentEncoding();
      */
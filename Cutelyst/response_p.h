@@ -36,6 +36,7 @@ public:
     Headers headers;
     QList<QNetworkCookie> cookies;
     QIODevice *body = 0;
+    BodyEncoder *bodyEncoder = 0;
     QUrl location;
     bool finalizedHeaders = false;
     Context *context;
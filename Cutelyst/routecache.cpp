@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "routecache_p.h"
+
+#include "application.h"
+#include "common.h"
+#include "config.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QDateTime>
+#include <QtCore/QSaveFile>
+#include <QtCore/QDataStream>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QCoreApplication>
+
+#ifdef Q_OS_UNIX
+#include <dlfcn.h>
+#endif
+
+#define ROUTE_CACHE_MAGIC 0x43524f55
+#define ROUTE_CACHE_VERSION 1
+
+using namespace Cutelyst;
+
+RouteCache::RouteCache(const QString &fileName, Application *app) :
+    m_fileName(fileName)
+{
+    if (m_fileName.isEmpty()) {
+        return;
+    }
+
+    m_hash = applicationHash(app);
+    if (m_hash.isEmpty()) {
+        qCWarning(CUTELYST_CORE) << "Could not find the application binary, not using route cache" << m_fileName;
+        m_fileName.clear();
+        return;
+    }
+
+    load();
+}
+
+bool RouteCache::attributes(const QString &key, QMap<QString, QString> *attributes) const
+{
+    QHash<QString, QMap<QString, QString> >::ConstIterator it = m_attributes.constFind(key);
+    if (it != m_attributes.constEnd()) {
+        *attributes = it.value();
+        return true;
+    }
+    return false;
+}
+
+void RouteCache::insert(const QString &key, const QMap<QString, QString> &attributes)
+{
+    if (!isEnabled()) {
+        return;
+    }
+
+    m_attributes.insert(key, attributes);
+    m_dirty = true;
+}
+
+bool RouteCache::save()
+{
+    if (!isEnabled() || !m_dirty) {
+        return true;
+    }
+
+    // QSaveFile makes sure other workers never read a partial file
+    QSaveFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(CUTELYST_CORE) << "Failed to write route cache" << m_fileName << file.errorString();
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_4);
+    out << quint32(ROUTE_CACHE_MAGIC) << quint32(ROUTE_CACHE_VERSION) << m_hash << m_attributes;
+
+    if (!file.commit()) {
+        qCWarning(CUTELYST_CORE) << "Failed to write route cache" << m_fileName << file.errorString();
+        return false;
+    }
+
+    qCDebug(CUTELYST_CORE) << "Saved route cache" << m_fileName << "with" << m_attributes.size() << "actions";
+    m_dirty = false;
+    return true;
+}
+
+static QString libraryFileName(const void *address)
+{
+#ifdef Q_OS_UNIX
+    Dl_info info;
+    if (dladdr(address, &info) && info.dli_fname) {
+        return QFile::decodeName(info.dli_fname);
+    }
+#else
+    Q_UNUSED(address)
+#endif
+    return QString();
+}
+
+static bool addFileStamp(QCryptographicHash &hash, const QString &fileName)
+{
+    // Size and modification time are enough to notice a
+    // rebuild or upgrade without reading the whole binary
+    QFileInfo info(fileName);
+    if (!info.exists()) {
+        return false;
+    }
+
+    QByteArray stamp = QFile::encodeName(info.canonicalFilePath());
+    stamp.append('\n');
+    stamp.append(QByteArray::number(info.size()));
+    stamp.append('\n');
+    stamp.append(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    stamp.append('\n');
+    hash.addData(stamp);
+    return true;
+}
+
+QByteArray RouteCache::applicationHash(Application *app)
+{
+    // Applications are usually plugins loaded by the engine,
+    // so look for the library containing its meta object
+    QString appFile = libraryFileName(app->metaObject());
+    if (appFile.isEmpty()) {
+        appFile = QCoreApplication::applicationFilePath();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(VERSION "\n");
+    if (!addFileStamp(hash, appFile)) {
+        return QByteArray();
+    }
+
+    // The attributes are parsed by libcutelyst as well
+    const QString libFile = libraryFileName(&Application::staticMetaObject);
+    if (!libFile.isEmpty() && libFile != appFile && !addFileStamp(hash, libFile)) {
+        return QByteArray();
+    }
+
+    return hash.result();
+}
+
+bool RouteCache::load()
+{
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCDebug(CUTELYST_CORE) << "Route cache not found, it will be created" << m_fileName;
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_4);
+
+    quint32 magic;
+    quint32 version;
+    QByteArray hash;
+    in >> magic >> version >> hash;
+    if (in.status() != QDataStream::Ok ||
+            magic != ROUTE_CACHE_MAGIC ||
+            version != ROUTE_CACHE_VERSION ||
+            hash != m_hash) {
+        qCDebug(CUTELYST_CORE) << "Route cache is out of date, it will be rebuilt" << m_fileName;
+        return false;
+    }
+
+    QHash<QString, QMap<QString, QString> > attributes;
+    in >> attributes;
+    if (in.status() != QDataStream::Ok) {
+        qCWarning(CUTELYST_CORE) << "Route cache is corrupted, it will be rebuilt" << m_fileName;
+        return false;
+    }
+
+    m_attributes = attributes;
+    qCDebug(CUTELYST_CORE) << "Loaded route cache" << m_fileName << "with" << m_attributes.size() << "actions";
+    return true;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CUTELYST_ROUTECACHE_P_H
+#define CUTELYST_ROUTECACHE_P_H
+
+#include <QtCore/QHash>
+#include <QtCore/QMap>
+#include <QtCore/QStringList>
+
+namespace Cutelyst {
+
+class Application;
+/**
+ * Stores the parsed attributes of every action so that
+ * (re)spawned workers don't need to parse them again.
+ *
+ * The cache file is only used if it was created by the
+ * same build of the application and of Cutelyst, otherwise
+ * it's rebuilt.
+ */
+class RouteCache
+{
+public:
+    /**
+     * An empty \p fileName disables the cache
+     */
+    RouteCache(const QString &fileName, Application *app);
+
+    inline bool isEnabled() const { return !m_fileName.isEmpty(); }
+
+    bool attributes(const QString &key, QMap<QString, QString> *attributes) const;
+    void insert(const QString &key, const QMap<QString, QString> &attributes);
+
+    /**
+     * Writes the cache file if anything changed
+     */
+    bool save();
+
+    /**
+     * Returns a hash of the Cutelyst version and of the size and
+     * modification time of the binaries where the \p app and
+     * Cutelyst code live
+     */
+    static QByteArray applicationHash(Application *app);
+
+private:
+    bool load();
+
+    QString m_fileName;
+    QByteArray m_hash;
+    QHash<QString, QMap<QString, QString> > m_attributes;
+    bool m_dirty = false;
+};
+
+}
+
+#endif // CUTELYST_ROUTECACHE_P_H
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "segmentedbuffer_p.h"
+
+#include <cstring>
+
+using namespace Cutelyst;
+
+namespace {
+
+const int ChunkSize = 16 * 1024;
+// Smaller arrays are cheaper to copy than to track
+const int MinReferenceSize = 4 * 1024;
+const int MaxPooledChunks = 64;
+
+// Chunks are reused across requests handled by the same thread
+class ChunkPool
+{
+public:
+    ~ChunkPool() {
+        Q_FOREACH (char *chunk, free) {
+            delete [] chunk;
+        }
+    }
+
+    char *take() {
+        if (free.isEmpty()) {
+            return new char[ChunkSize];
+        }
+        char *chunk = free.last();
+        free.removeLast();
+        return chunk;
+    }
+
+    void release(char *chunk) {
+        if (free.size() < MaxPooledChunks) {
+            free.append(chunk);
+        } else {
+            delete [] chunk;
+        }
+    }
+
+    QVector<char *> free;
+};
+
+thread_local ChunkPool s_chunkPool;
+
+}
+
+SegmentedBuffer::SegmentedBuffer(QObject *parent) : QIODevice(parent)
+  , d_ptr(new SegmentedBufferPrivate)
+{
+    // Like QBuffer there is no point in QIODevice buffering
+    open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+}
+
+SegmentedBuffer::~SegmentedBuffer()
+{
+    clear();
+    delete d_ptr;
+}
+
+void SegmentedBuffer::append(const char *data, qint64 len)
+{
+    Q_D(SegmentedBuffer);
+    d->appendCopy(data, len);
+}
+
+void SegmentedBuffer::append(const QByteArray &data)
+{
+    Q_D(SegmentedBuffer);
+    if (data.size() >= MinReferenceSize) {
+        d->appendReference(data);
+    } else {
+        d->appendCopy(data.constData(), data.size());
+    }
+}
+
+void SegmentedBuffer::append(const QString &data)
+{
+    Q_D(SegmentedBuffer);
+    // The temporary is owned by the segment, no copy needed
+    const QByteArray utf8 = data.toUtf8();
+    if (utf8.size() >= MinReferenceSize) {
+        d->appendReference(utf8);
+    } else {
+        d->appendCopy(utf8.constData(), utf8.size());
+    }
+}
+
+void SegmentedBuffer::clear()
+{
+    Q_D(SegmentedBuffer);
+    Q_FOREACH (const SegmentedBufferPrivate::Segment &segment, d->segments) {
+        if (segment.chunk) {
+            s_chunkPool.release(segment.chunk);
+        }
+    }
+    d->segments.clear();
+    d->size = 0;
+    d->readSegment = 0;
+    d->readSegmentStart = 0;
+    QIODevice::seek(0);
+}
+
+int SegmentedBuffer::segmentCount() const
+{
+    Q_D(const SegmentedBuffer);
+    return d->segments.size();
+}
+
+const char *SegmentedBuffer::segmentData(int index) const
+{
+    Q_D(const SegmentedBuffer);
+    return d->segments.at(index).data;
+}
+
+qint64 SegmentedBuffer::segmentSize(int index) const
+{
+    Q_D(const SegmentedBuffer);
+    return d->segments.at(index).size;
+}
+
+QByteArray SegmentedBuffer::toByteArray() const
+{
+    Q_D(const SegmentedBuffer);
+    if (d->segments.size() == 1 && !d->segments.first().chunk) {
+        return d->segments.first().ref;
+    }
+
+    QByteArray ret;
+    ret.reserve(int(d->size));
+    Q_FOREACH (const SegmentedBufferPrivate::Segment &segment, d->segments) {
+        ret.append(segment.data, segment.size);
+    }
+    return ret;
+}
+
+qint64 SegmentedBuffer::size() const
+{
+    Q_D(const SegmentedBuffer);
+    return d->size;
+}
+
+bool SegmentedBuffer::seek(qint64 pos)
+{
+    Q_D(SegmentedBuffer);
+    if (pos < 0 || pos > d->size) {
+        return false;
+    }
+    return QIODevice::seek(pos);
+}
+
+bool SegmentedBuffer::atEnd() const
+{
+    Q_D(const SegmentedBuffer);
+    return pos() >= d->size;
+}
+
+qint64 SegmentedBuffer::readData(char *data, qint64 maxlen)
+{
+    Q_D(SegmentedBuffer);
+    // Unbuffered, so pos() is where the read starts
+    qint64 pos = QIODevice::pos();
+    qint64 read = 0;
+    int index = d->segmentAt(pos);
+    while (index != -1 && index < d->segments.size() && read < maxlen) {
+        const SegmentedBufferPrivate::Segment &segment = d->segments.at(index);
+        const qint64 offset = pos - d->readSegmentStart;
+        const qint64 len = qMin(maxlen - read, segment.size - offset);
+        memcpy(data + read, segment.data + offset, len);
+        read += len;
+        pos += len;
+        if (offset + len == segment.size) {
+            d->readSegmentStart += segment.size;
+            d->readSegment = ++index;
+        }
+    }
+    return read;
+}
+
+qint64 SegmentedBuffer::writeData(const char *data, qint64 len)
+{
+    Q_D(SegmentedBuffer);
+    d->appendCopy(data, len);
+    return len;
+}
+
+void SegmentedBufferPrivate::appendCopy(const char *data, qint64 len)
+{
+    while (len > 0) {
+        if (segments.isEmpty() || !segments.last().chunk || segments.last().size == ChunkSize) {
+            Segment segment;
+            segment.chunk = s_chunkPool.take();
+            segment.data = segment.chunk;
+            segment.size = 0;
+            segments.append(segment);
+        }
+
+        Segment &segment = segments.last();
+        const int len2 = int(qMin(len, qint64(ChunkSize - segment.size)));
+        memcpy(segment.chunk + segment.size, data, len2);
+        segment.size += len2;
+        size += len2;
+        data += len2;
+        len -= len2;
+    }
+}
+
+void SegmentedBufferPrivate::appendReference(const QByteArray &data)
+{
+    Segment segment;
+    segment.ref = data;
+    segment.data = segment.ref.constData();
+    segment.size = segment.ref.size();
+    segment.chunk = 0;
+    segments.append(segment);
+    size += segment.size;
+}
+
+int SegmentedBufferPrivate::segmentAt(qint64 pos)
+{
+    if (pos >= size) {
+        return -1;
+    }
+
+    if (pos < readSegmentStart) {
+        readSegment = 0;
+        readSegmentStart = 0;
+    }
+
+    while (readSegment < segments.size() &&
+           pos >= readSegmentStart + segments.at(readSegment).size) {
+        readSegmentStart += segments.at(readSegment).size;
+        ++readSegment;
+    }
+    return readSegment;
+}
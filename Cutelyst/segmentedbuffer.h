@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CUTELYST_SEGMENTEDBUFFER_H
+#define CUTELYST_SEGMENTEDBUFFER_H
+
+#include <QtCore/QIODevice>
+
+namespace Cutelyst {
+
+class SegmentedBufferPrivate;
+/**
+ * Append-only output buffer made of segments, used
+ * as a Response body that grows without reallocating.
+ *
+ * Small writes are copied into fixed size chunks taken
+ * from a per thread pool, while large QByteArrays are
+ * referenced, so cached fragments or file contents are
+ * never copied. Engines write the segments directly to
+ * the client (with writev where possible).
+ *
+ * Writes always append to the end, the device can be
+ * read and seeked like a QBuffer.
+ */
+class SegmentedBuffer : public QIODevice
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(SegmentedBuffer)
+public:
+    /**
+     * Constructs an open SegmentedBuffer
+     */
+    explicit SegmentedBuffer(QObject *parent = 0);
+    virtual ~SegmentedBuffer();
+
+    /**
+     * Copies \p len bytes of \p data to the end of the buffer
+     */
+    void append(const char *data, qint64 len);
+
+    /**
+     * Appends \p data, arrays of 4KiB or more are referenced
+     * instead of copied, use QByteArray::fromRawData() to
+     * append memory that outlives the buffer without copying.
+     */
+    void append(const QByteArray &data);
+
+    /**
+     * Appends \p data encoded as UTF-8
+     */
+    void append(const QString &data);
+
+    /**
+     * Removes all data, returning the chunks to the pool
+     */
+    void clear();
+
+    int segmentCount() const;
+    const char *segmentData(int index) const;
+    qint64 segmentSize(int index) const;
+
+    /**
+     * Returns a contiguous copy of the data
+     */
+    QByteArray toByteArray() const;
+
+    virtual qint64 size() const Q_DECL_OVERRIDE;
+    virtual bool seek(qint64 pos) Q_DECL_OVERRIDE;
+    virtual bool atEnd() const Q_DECL_OVERRIDE;
+
+protected:
+    virtual qint64 readData(char *data, qint64 maxlen) Q_DECL_OVERRIDE;
+    virtual qint64 writeData(const char *data, qint64 len) Q_DECL_OVERRIDE;
+
+    SegmentedBufferPrivate *d_ptr;
+};
+
+}
+
+#endif // CUTELYST_SEGMENTEDBUFFER_H
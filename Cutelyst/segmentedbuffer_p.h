@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CUTELYST_SEGMENTEDBUFFER_P_H
+#define CUTELYST_SEGMENTEDBUFFER_P_H
+
+#include "segmentedbuffer.h"
+
+#include <QtCore/QVector>
+
+namespace Cutelyst {
+
+class SegmentedBufferPrivate
+{
+public:
+    struct Segment {
+        const char *data;
+        int size;
+        // Pooled chunk owned by the buffer, or 0
+        char *chunk;
+        // Keeps referenced data alive
+        QByteArray ref;
+    };
+
+    void appendCopy(const char *data, qint64 len);
+    void appendReference(const QByteArray &data);
+    int segmentAt(qint64 pos);
+
+    QVector<Segment> segments;
+    qint64 size = 0;
+
+    // Segment of the last read, avoids scanning
+    // from the beginning on every read
+    int readSegment = 0;
+    qint64 readSegmentStart = 0;
+};
+
+}
+
+#endif // CUTELYST_SEGMENTEDBUFFER_P_H
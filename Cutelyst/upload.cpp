@@ -20,12 +20,21 @@
 #include "upload_p.h"
 #include "common.h"
 
+#include "config.h"
+
+#include <QBuffer>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
 #include <QTemporaryFile>
 #include <QStringBuilder>
 
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+#endif
+
 using namespace Cutelyst;
 
 QString Upload::filename() const
@@ -71,22 +80,10 @@ bool Upload::save(const QString &newName)
         setErrorString(QLatin1String("Failed to open file for saving: ") % out.errorString());
         qCWarning(CUTELYST_UPLOAD) << errorString();
     } else {
-        qint64 posOrig = d->pos;
-        seek(0);
-
-        char block[4096];
-        qint64 totalRead = 0;
-        while (!atEnd()) {
-            qint64 in = read(block, sizeof(block));
-            if (in <= 0)
-                break;
-            totalRead += in;
-            if (in != out.write(block, in)) {
-                setErrorString(QStringLiteral("Failure to write block"));
-                qCWarning(CUTELYST_UPLOAD) << errorString();
-                error = true;
-                break;
-            }
+        if (!d->copyTo(&out)) {
+            setErrorString(QStringLiteral("Failure to write block"));
+            qCWarning(CUTELYST_UPLOAD) << errorString();
+            error = true;
         }
 
         if (error) {
@@ -107,7 +104,6 @@ bool Upload::save(const QString &newName)
             out.setAutoRemove(false);
         }
 #endif
-        seek(posOrig);
     }
 
     return !error;
@@ -125,30 +121,12 @@ QTemporaryFile *Upload::createTemporaryFile(const QString &templateName)
     }
 
     if (ret->open()) {
-        bool error = false;
-        qint64 posOrig = d->pos;
-        seek(0);
-
-        char block[4096];
-        qint64 totalRead = 0;
-        while (!atEnd()) {
-            qint64 in = read(block, sizeof(block));
-            if (in <= 0)
-                break;
-            totalRead += in;
-            if (in != ret->write(block, in)) {
-                setErrorString(QStringLiteral("Failure to write block"));
-                qCWarning(CUTELYST_UPLOAD) << errorString();
-                error = true;
-                break;
-            }
-        }
-
-        if (error) {
+        if (!d->copyTo(ret)) {
+            setErrorString(QStringLiteral("Failure to write block"));
+            qCWarning(CUTELYST_UPLOAD) << errorString();
             ret->remove();
         }
         ret->seek(0);
-        seek(posOrig);
 
         return ret;
     } else {
@@ -162,6 +140,22 @@ QTemporaryFile *Upload::createTemporaryFile(const QString &templateName)
     return 0;
 }
 
+const uchar *Upload::map()
+{
+    Q_D(Upload);
+    if (!d->mapped && size() > 0) {
+        QFileDevice *file = qobject_cast<QFileDevice *>(d->device);
+        QBuffer *buffer = qobject_cast<QBuffer *>(d->device);
+        if (file) {
+            // Unmapped by QFileDevice when the body is closed
+            d->mapped = file->map(d->startOffset, size());
+        } else if (buffer) {
+            d->mapped = reinterpret_cast<const uchar *>(buffer->data().constData()) + d->startOffset;
+        }
+    }
+    return d->mapped;
+}
+
 qint64 Upload::pos() const
 {
     Q_D(const Upload);
@@ -258,3 +252,67 @@ UploadPrivate::UploadPrivate(QIODevice *dev) :
 {
 
 }
+
+bool UploadPrivate::copyTo(QFileDevice *out)
+{
+    const qint64 total = endOffset - startOffset;
+    qint64 copied = 0;
+
+#ifdef Q_OS_LINUX
+    // When the body is spooled to a file (i.e. uWSGI's post_file)
+    // the data is copied by the kernel, without reaching userspace
+    QFileDevice *in = qobject_cast<QFileDevice *>(device);
+    if (in && in->handle() != -1 && out->flush() && out->handle() != -1) {
+        const qint64 outStart = out->pos();
+        loff_t inOffset = startOffset;
+        bool useSendfile = false;
+        while (copied < total) {
+            ssize_t len = -1;
+#ifdef HAVE_COPY_FILE_RANGE
+            if (!useSendfile) {
+                len = copy_file_range(in->handle(), &inOffset, out->handle(), NULL, total - copied, 0);
+                if (len < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL)) {
+                    // Not supported between these files
+                    useSendfile = true;
+                    continue;
+                }
+            } else
+#endif
+            {
+                off_t offset = inOffset;
+                len = sendfile(out->handle(), in->handle(), &offset, total - copied);
+                inOffset = offset;
+            }
+
+            if (len <= 0) {
+                break;
+            }
+            copied += len;
+        }
+        Q_UNUSED(useSendfile)
+
+        // The file descriptor position moved behind QFileDevice
+        if (!out->seek(outStart + copied)) {
+            return false;
+        }
+    }
+#endif
+
+    // Copy whatever is left through a userspace buffer
+    qint64 posOrig = device->pos();
+    device->seek(startOffset + copied);
+
+    QByteArray block(64 * 1024, Qt::Uninitialized);
+    bool ret = true;
+    while (copied < total) {
+        qint64 in = device->read(block.data(), qMin(qint64(block.size()), total - copied));
+        if (in <= 0 || in != out->write(block.constData(), in)) {
+            ret = false;
+            break;
+        }
+        copied += in;
+    }
+
+    device->seek(posOrig);
+    return ret;
+}
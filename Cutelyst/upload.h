@@ -69,6 +69,17 @@ public:
      */
     QTemporaryFile *createTemporaryFile(const QString &templateName = QString());
 
+    /**
+     * Returns a read only view of the content of this upload
+     * without copying it, or 0 if the request body can't be
+     * accessed in place.
+     *
+     * Bodies spooled to a file (like uWSGI's post_file) are
+     * memory mapped, bodies kept in a QBuffer are used as is.
+     * The view is valid until the request finishes.
+     */
+    const uchar *map();
+
     virtual qint64 pos() const;
     virtual qint64 size() const;
     virtual bool seek(qint64 pos);
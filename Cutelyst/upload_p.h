@@ -24,6 +24,8 @@
 
 #include <QMultiHash>
 
+class QFileDevice;
+
 namespace Cutelyst {
 
 class UploadPrivate
@@ -31,6 +33,11 @@ class UploadPrivate
 public:
     UploadPrivate(QIODevice *dev);
 
+    /**
+     * Appends the content of the upload to \p out
+     */
+    bool copyTo(QFileDevice *out);
+
     Headers headers;
     QString name;
     QString filename;
@@ -38,6 +45,7 @@ public:
     qint64 startOffset = 0;
     qint64 endOffset = 0;
     qint64 pos = 0;
+    const uchar *mapped = 0;
 };
 
 }
@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "urlencodedparser_p.h"
+#include "paramsflatmap_p.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CUTELYST_URLENCODED_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace Cutelyst;
+
+typedef int (*FindSpecialFunc)(const char *data, int len);
+
+static inline bool isSpecial(char c)
+{
+    return c == '&' || c == '=' || c == '%' || c == '+';
+}
+
+static int findSpecialScalar(const char *data, int len)
+{
+    for (int i = 0; i < len; ++i) {
+        if (isSpecial(data[i])) {
+            return i;
+        }
+    }
+    return len;
+}
+
+#ifdef __SSE2__
+static int findSpecialSse2(const char *data, int len)
+{
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i equal = _mm_set1_epi8('=');
+    const __m128i percent = _mm_set1_epi8('%');
+    const __m128i plus = _mm_set1_epi8('+');
+
+    int i = 0;
+    for (; i + 16 <= len; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const __m128i match = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, amp),
+                                                        _mm_cmpeq_epi8(chunk, equal)),
+                                           _mm_or_si128(_mm_cmpeq_epi8(chunk, percent),
+                                                        _mm_cmpeq_epi8(chunk, plus)));
+        const int mask = _mm_movemask_epi8(match);
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + findSpecialScalar(data + i, len - i);
+}
+#endif
+
+#ifdef CUTELYST_URLENCODED_AVX2
+__attribute__((target("avx2")))
+static int findSpecialAvx2(const char *data, int len)
+{
+    const __m256i amp = _mm256_set1_epi8('&');
+    const __m256i equal = _mm256_set1_epi8('=');
+    const __m256i percent = _mm256_set1_epi8('%');
+    const __m256i plus = _mm256_set1_epi8('+');
+
+    int i = 0;
+    for (; i + 32 <= len; i += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        const __m256i match = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, amp),
+                                                              _mm256_cmpeq_epi8(chunk, equal)),
+                                              _mm256_or_si256(_mm256_cmpeq_epi8(chunk, percent),
+                                                              _mm256_cmpeq_epi8(chunk, plus)));
+        const unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(match));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + findSpecialScalar(data + i, len - i);
+}
+#endif
+
+static FindSpecialFunc resolveFindSpecial()
+{
+#ifdef CUTELYST_URLENCODED_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return findSpecialAvx2;
+    }
+#endif
+#ifdef __SSE2__
+    return findSpecialSse2;
+#else
+    return findSpecialScalar;
+#endif
+}
+
+// Picked once based on what the running CPU supports
+static const FindSpecialFunc findSpecial = resolveFindSpecial();
+
+static inline int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+QVector<UrlEncodedParser::Pair> UrlEncodedParser::parse(const char *data, int len, QByteArray &arena)
+{
+    QVector<Pair> ret;
+
+    // Decoding never grows the data
+    arena.resize(len);
+    char *out = arena.data();
+    int outPos = 0;
+
+    int segmentStart = 0;
+    Pair pair = { 0, 0, 0, -1 };
+
+    int pos = 0;
+    Q_FOREVER {
+        // Copy everything up to the next special char
+        const int run = findSpecial(data + pos, len - pos);
+        if (run) {
+            memcpy(out + outPos, data + pos, run);
+            outPos += run;
+            pos += run;
+        }
+
+        if (pos >= len || data[pos] == '&') {
+            // Empty segments like in "a=1&&b=2" are ignored
+            if (pos != segmentStart) {
+                if (pair.valueLength == -1) {
+                    pair.keyLength = outPos - pair.keyPos;
+                    pair.valuePos = outPos;
+                    pair.valueLength = 0;
+                } else {
+                    pair.valueLength = outPos - pair.valuePos;
+                }
+                ret.append(pair);
+            }
+
+            if (pos >= len) {
+                break;
+            }
+
+            segmentStart = ++pos;
+            pair.keyPos = outPos;
+            pair.valueLength = -1;
+            continue;
+        }
+
+        const char c = data[pos];
+        if (c == '=') {
+            if (pair.valueLength == -1) {
+                // First '=' splits key and value
+                pair.keyLength = outPos - pair.keyPos;
+                pair.valuePos = outPos;
+                pair.valueLength = 0;
+            } else {
+                out[outPos++] = '=';
+            }
+            ++pos;
+        } else if (c == '+') {
+            out[outPos++] = ' ';
+            ++pos;
+        } else {
+            // '%', invalid sequences are kept as is
+            int high;
+            int low;
+            if (pos + 2 < len && (high = hexValue(data[pos + 1])) != -1 && (low = hexValue(data[pos + 2])) != -1) {
+                out[outPos++] = char((high << 4) | low);
+                pos += 3;
+            } else {
+                out[outPos++] = '%';
+                ++pos;
+            }
+        }
+    }
+
+    arena.resize(outPos);
+    return ret;
+}
+
+ParamsFlatMap UrlEncodedParser::parse(const QByteArray &data)
+{
+    ParamsFlatMapData *map = new ParamsFlatMapData;
+
+    const QVector<Pair> &pairs = parse(data.constData(), data.size(), map->arena);
+    map->entries.reserve(pairs.size());
+    for (int i = 0; i < pairs.size(); ++i) {
+        const Pair &pair = pairs.at(i);
+        const ParamsFlatMapData::Entry entry = {
+            pair.keyPos,
+            pair.keyLength,
+            pair.valuePos,
+            pair.valueLength
+        };
+        map->entries.append(entry);
+    }
+    map->sort();
+
+    return ParamsFlatMap(map);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef URLENCODEDPARSER_P_H
+#define URLENCODEDPARSER_P_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QVector>
+
+#include "paramsflatmap.h"
+
+namespace Cutelyst {
+
+/**
+ * Parses application/x-www-form-urlencoded data
+ * (and URL queries) in a single pass.
+ *
+ * The input is scanned with SIMD for '&', '=', '%' and '+'
+ * where available, every key and value is decoded into
+ * a single arena buffer and returned as offsets into it.
+ */
+class UrlEncodedParser
+{
+public:
+    struct Pair {
+        int keyPos;
+        int keyLength;
+        int valuePos;
+        int valueLength;
+    };
+
+    /**
+     * Decodes \p data into \p arena, which is resized to
+     * hold the decoded bytes, and returns the pairs found
+     * in the order they appear in \p data
+     */
+    static QVector<Pair> parse(const char *data, int len, QByteArray &arena);
+
+    /**
+     * Convenience method that builds a ParamsFlatMap
+     * on top of the decoded arena
+     */
+    static ParamsFlatMap parse(const QByteArray &data);
+};
+
+}
+
+Q_DECLARE_TYPEINFO(Cutelyst::UrlEncodedParser::Pair, Q_PRIMITIVE_TYPE);
+
+#endif // URLENCODEDPARSER_P_H
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "xxhash_p.h"
+
+#include <cstring>
+
+using namespace Cutelyst;
+
+namespace {
+
+const quint64 Prime1 = 11400714785074694791ULL;
+const quint64 Prime2 = 14029467366897019727ULL;
+const quint64 Prime3 = 1609587929392839161ULL;
+const quint64 Prime4 = 9650029242287828579ULL;
+const quint64 Prime5 = 2870177450012600261ULL;
+
+inline quint64 rotl(quint64 x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline quint64 read64(const uchar *p)
+{
+    // Unaligned little endian read
+    quint64 v;
+    memcpy(&v, p, sizeof(v));
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+inline quint32 read32(const uchar *p)
+{
+    quint32 v;
+    memcpy(&v, p, sizeof(v));
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+inline quint64 xxRound(quint64 acc, quint64 input)
+{
+    acc += input * Prime2;
+    acc = rotl(acc, 31);
+    return acc * Prime1;
+}
+
+inline quint64 mergeRound(quint64 acc, quint64 val)
+{
+    acc ^= xxRound(0, val);
+    return acc * Prime1 + Prime4;
+}
+
+}
+
+XXHash64::XXHash64(quint64 seed) :
+    m_v1(seed + Prime1 + Prime2),
+    m_v2(seed + Prime2),
+    m_v3(seed),
+    m_v4(seed - Prime1),
+    m_seed(seed)
+{
+}
+
+void XXHash64::update(const char *data, qint64 len)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(data);
+    const uchar *end = p + len;
+    m_totalLength += len;
+
+    if (m_bufferSize + len < 32) {
+        memcpy(m_buffer + m_bufferSize, p, len);
+        m_bufferSize += int(len);
+        return;
+    }
+
+    if (m_bufferSize) {
+        // Complete the stripe kept from the last update
+        const int fill = 32 - m_bufferSize;
+        memcpy(m_buffer + m_bufferSize, p, fill);
+        m_v1 = xxRound(m_v1, read64(m_buffer));
+        m_v2 = xxRound(m_v2, read64(m_buffer + 8));
+        m_v3 = xxRound(m_v3, read64(m_buffer + 16));
+        m_v4 = xxRound(m_v4, read64(m_buffer + 24));
+        p += fill;
+        m_bufferSize = 0;
+    }
+
+    while (p + 32 <= end) {
+        m_v1 = xxRound(m_v1, read64(p));
+        m_v2 = xxRound(m_v2, read64(p + 8));
+        m_v3 = xxRound(m_v3, read64(p + 16));
+        m_v4 = xxRound(m_v4, read64(p + 24));
+        p += 32;
+    }
+
+    if (p < end) {
+        m_bufferSize = int(end - p);
+        memcpy(m_buffer, p, m_bufferSize);
+    }
+}
+
+quint64 XXHash64::digest() const
+{
+    quint64 h;
+    if (m_totalLength >= 32) {
+        h = rotl(m_v1, 1) + rotl(m_v2, 7) + rotl(m_v3, 12) + rotl(m_v4, 18);
+        h = mergeRound(h, m_v1);
+        h = mergeRound(h, m_v2);
+        h = mergeRound(h, m_v3);
+        h = mergeRound(h, m_v4);
+    } else {
+        h = m_seed + Prime5;
+    }
+    h += m_totalLength;
+
+    const uchar *p = m_buffer;
+    const uchar *end = m_buffer + m_bufferSize;
+    while (p + 8 <= end) {
+        h ^= xxRound(0, read64(p));
+        h = rotl(h, 27) * Prime1 + Prime4;
+        p += 8;
+    }
+
+    if (p + 4 <= end) {
+        h ^= quint64(read32(p)) * Prime1;
+        h = rotl(h, 23) * Prime2 + Prime3;
+        p += 4;
+    }
+
+    while (p < end) {
+        h ^= (*p) * Prime5;
+        h = rotl(h, 11) * Prime1;
+        ++p;
+    }
+
+    // Avalanche
+    h ^= h >> 33;
+    h *= Prime2;
+    h ^= h >> 29;
+    h *= Prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+quint64 XXHash64::hash(const char *data, qint64 len, quint64 seed)
+{
+    XXHash64 hash(seed);
+    hash.update(data, len);
+    return hash.digest();
+}
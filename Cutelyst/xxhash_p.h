@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CUTELYST_XXHASH_P_H
+#define CUTELYST_XXHASH_P_H
+
+#include <QtCore/qglobal.h>
+
+namespace Cutelyst {
+
+/**
+ * Incremental XXH64, a fast non-cryptographic hash
+ * used for ETags and cache keys.
+ */
+class XXHash64
+{
+public:
+    explicit XXHash64(quint64 seed = 0);
+
+    void update(const char *data, qint64 len);
+    quint64 digest() const;
+
+    static quint64 hash(const char *data, qint64 len, quint64 seed = 0);
+
+private:
+    quint64 m_v1;
+    quint64 m_v2;
+    quint64 m_v3;
+    quint64 m_v4;
+    quint64 m_seed;
+    quint64 m_totalLength = 0;
+    uchar m_buffer[32];
+    int m_bufferSize = 0;
+};
+
+}
+
+#endif // CUTELYST_XXHASH_P_H
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef BENCHCONTROLLERS_H
+#define BENCHCONTROLLERS_H
+
+#include <Cutelyst/Controller>
+
+/**
+ * Number of actions each synthetic controller has,
+ * 5 Path actions, a Chained root and 4 Chained endpoints
+ */
+#define BENCH_ACTIONS_PER_CONTROLLER 10
+#define BENCH_PATH_ACTIONS 5
+#define BENCH_CHAINED_ACTIONS 4
+
+/**
+ * Creates the synthetic controller number \p index which is
+ * bound to the "c<index>" namespace, the available amount of
+ * controllers is BENCH_CONTROLLERS and is defined at build time.
+ */
+Cutelyst::Controller *createBenchController(int index, QObject *parent);
+
+#endif // BENCHCONTROLLERS_H
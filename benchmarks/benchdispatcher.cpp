@@ -0,0 +1,366 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "benchcontrollers.h"
+
+#include <Cutelyst/Application>
+#include <Cutelyst/Engine>
+#include <Cutelyst/Context>
+#include <Cutelyst/Dispatcher>
+#include <Cutelyst/request_p.h>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QStringBuilder>
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+using namespace Cutelyst;
+
+// Counts every heap allocation done by the process, the
+// benchmark is single threaded so no locking is needed
+static quint64 s_allocations = 0;
+
+void *operator new(std::size_t size)
+{
+    ++s_allocations;
+    void *ptr = std::malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) Q_DECL_NOTHROW
+{
+    std::free(ptr);
+}
+
+class Measure
+{
+public:
+    void start() {
+        m_allocations = s_allocations;
+        m_timer.start();
+    }
+
+    void stop() {
+        m_nsecs += m_timer.nsecsElapsed();
+        m_totalAllocations += s_allocations - m_allocations;
+        ++m_iterations;
+    }
+
+    void reset() {
+        m_nsecs = 0;
+        m_totalAllocations = 0;
+        m_iterations = 0;
+    }
+
+    void print(int actions, const QString &operation, const QString &route) const {
+        double nsPerOp = m_iterations ? double(m_nsecs) / m_iterations : 0;
+        QJsonObject obj {
+            {QStringLiteral("benchmark"), QStringLiteral("dispatcher")},
+            {QStringLiteral("actions"), actions},
+            {QStringLiteral("operation"), operation},
+            {QStringLiteral("route"), route},
+            {QStringLiteral("iterations"), double(m_iterations)},
+            {QStringLiteral("ns_per_op"), nsPerOp},
+            {QStringLiteral("ops_per_sec"), nsPerOp ? 1000000000.0 / nsPerOp : 0},
+            {QStringLiteral("allocs_per_op"), m_iterations ? double(m_totalAllocations) / m_iterations : 0}
+        };
+        fprintf(stdout, "%s\n", QJsonDocument(obj).toJson(QJsonDocument::Compact).constData());
+        fflush(stdout);
+    }
+
+    quint64 iterations() const { return m_iterations; }
+
+private:
+    QElapsedTimer m_timer;
+    quint64 m_allocations = 0;
+    quint64 m_totalAllocations = 0;
+    qint64 m_nsecs = 0;
+    quint64 m_iterations = 0;
+};
+
+class BenchEngine : public Engine
+{
+public:
+    BenchEngine() : Engine(QVariantHash()) {}
+
+    void request(const QString &path)
+    {
+        RequestPrivate *priv = new RequestPrivate;
+        priv->method = QStringLiteral("GET");
+        priv->protocol = QStringLiteral("HTTP/1.0");
+        priv->serverAddress = QStringLiteral("localhost");
+        priv->path = path;
+
+        handleRequest(new Request(priv), true);
+    }
+
+protected:
+    virtual qint64 doWrite(Context *c, const char *data, qint64 len, void *engineData) Q_DECL_OVERRIDE
+    {
+        Q_UNUSED(c)
+        Q_UNUSED(data)
+        Q_UNUSED(engineData)
+        return len;
+    }
+
+private:
+    virtual bool init() Q_DECL_OVERRIDE
+    {
+        return true;
+    }
+};
+
+class BenchApplication : public Application
+{
+    Q_OBJECT
+public:
+    BenchApplication(int controllers, int iterations) : Application()
+      , m_controllers(controllers)
+      , m_iterations(iterations)
+    {
+    }
+
+    virtual bool init() Q_DECL_OVERRIDE
+    {
+        for (int i = 0; i < m_controllers; ++i) {
+            registerController(createBenchController(i, this));
+        }
+
+        connect(this, &Application::beforePrepareAction, this, &BenchApplication::onBeforePrepareAction);
+        connect(this, &Application::beforeDispatch, this, &BenchApplication::onBeforeDispatch);
+        connect(this, &Application::afterDispatch, this, &BenchApplication::onAfterDispatch);
+
+        return true;
+    }
+
+    void run(BenchEngine *engine)
+    {
+        const int actions = m_controllers * BENCH_ACTIONS_PER_CONTROLLER;
+
+        QStringList pathRoutes;
+        QStringList chainedRoutes;
+        for (int i = 0; i < m_controllers; ++i) {
+            for (int j = 0; j < BENCH_PATH_ACTIONS; ++j) {
+                pathRoutes.append(QLatin1Char('c') % QString::number(i) % QLatin1String("/path") % QString::number(j));
+            }
+            for (int j = 0; j < BENCH_CHAINED_ACTIONS; ++j) {
+                chainedRoutes.append(QLatin1String("chain") % QString::number(i) % QLatin1String("/42/e") % QString::number(j));
+            }
+        }
+
+        // Warm up caches and lazily created data
+        for (int i = 0; i < pathRoutes.size() && i < m_iterations; ++i) {
+            engine->request(pathRoutes.at(i));
+        }
+
+        runRoutes(engine, pathRoutes);
+        m_prepareAction.print(actions, QStringLiteral("prepareAction"), QStringLiteral("path"));
+        m_dispatch.print(actions, QStringLiteral("dispatch"), QStringLiteral("path"));
+
+        runRoutes(engine, chainedRoutes);
+        m_prepareAction.print(actions, QStringLiteral("prepareAction"), QStringLiteral("chained"));
+        m_dispatch.print(actions, QStringLiteral("dispatch"), QStringLiteral("chained"));
+
+        // forward() and uriFor() need a Context, they run
+        // from afterDispatch of this single request
+        m_forwardRoutes = pathRoutes;
+        engine->request(pathRoutes.first());
+        m_forwardRoutes.clear();
+    }
+
+    int misses() const { return m_misses; }
+
+private:
+    void runRoutes(BenchEngine *engine, const QStringList &routes)
+    {
+        m_prepareAction.reset();
+        m_dispatch.reset();
+        for (int i = 0; i < m_iterations; ++i) {
+            engine->request(routes.at(i % routes.size()));
+        }
+    }
+
+    void runForwardAndUriFor(Context *c)
+    {
+        const int actions = m_controllers * BENCH_ACTIONS_PER_CONTROLLER;
+
+        QStringList privatePaths;
+        ActionList pathActions;
+        ActionList chainedActions;
+        Dispatcher *dispatcher = c->app()->dispatcher();
+        for (int i = 0; i < m_controllers; ++i) {
+            const QString ns = QLatin1Char('c') % QString::number(i);
+            for (int j = 0; j < BENCH_PATH_ACTIONS; ++j) {
+                const QString name = QLatin1String("path") % QString::number(j);
+                privatePaths.append(QLatin1Char('/') % ns % QLatin1Char('/') % name);
+                pathActions.append(dispatcher->getAction(name, ns));
+            }
+            for (int j = 0; j < BENCH_CHAINED_ACTIONS; ++j) {
+                chainedActions.append(dispatcher->getAction(QLatin1String("chain") % QString::number(j), ns));
+            }
+        }
+
+        Measure forward;
+        for (int i = 0; i < m_iterations; ++i) {
+            const QString &path = privatePaths.at(i % privatePaths.size());
+            forward.start();
+            bool ret = c->forward(path);
+            forward.stop();
+            if (!ret) {
+                ++m_misses;
+            }
+        }
+        forward.print(actions, QStringLiteral("forward"), QStringLiteral("path"));
+
+        Measure uriFor;
+        for (int i = 0; i < m_iterations; ++i) {
+            Action *action = pathActions.at(i % pathActions.size());
+            uriFor.start();
+            const QUrl &uri = c->uriFor(action);
+            uriFor.stop();
+            if (uri.isEmpty()) {
+                ++m_misses;
+            }
+        }
+        uriFor.print(actions, QStringLiteral("uriFor"), QStringLiteral("path"));
+
+        const QStringList captures = { QStringLiteral("42") };
+        uriFor.reset();
+        for (int i = 0; i < m_iterations; ++i) {
+            Action *action = chainedActions.at(i % chainedActions.size());
+            uriFor.start();
+            const QUrl &uri = c->uriForWithCaptures(action, captures);
+            uriFor.stop();
+            if (uri.isEmpty()) {
+                ++m_misses;
+            }
+        }
+        uriFor.print(actions, QStringLiteral("uriFor"), QStringLiteral("chained"));
+    }
+
+private Q_SLOTS:
+    void onBeforePrepareAction(Context *c, bool *skipMethod)
+    {
+        Q_UNUSED(c)
+        Q_UNUSED(skipMethod)
+        m_prepareAction.start();
+    }
+
+    void onBeforeDispatch(Context *c)
+    {
+        m_prepareAction.stop();
+        if (!c->action()) {
+            ++m_misses;
+        }
+        m_dispatch.start();
+    }
+
+    void onAfterDispatch(Context *c)
+    {
+        m_dispatch.stop();
+        if (!m_forwardRoutes.isEmpty()) {
+            runForwardAndUriFor(c);
+        }
+    }
+
+private:
+    Measure m_prepareAction;
+    Measure m_dispatch;
+    QStringList m_forwardRoutes;
+    int m_controllers;
+    int m_iterations;
+    int m_misses = 0;
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("cutelyst-bench-dispatcher"));
+
+    // Request logging would otherwise dominate the timed loops
+    QLoggingCategory::setFilterRules(QStringLiteral("cutelyst.*.debug=false"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Measures Cutelyst routing, one JSON object is printed per measurement."));
+    parser.addHelpOption();
+
+    QCommandLineOption iterationsOption(QStringList() << QStringLiteral("i") << QStringLiteral("iterations"),
+                                        QStringLiteral("Number of operations per measurement."),
+                                        QStringLiteral("number"),
+                                        QStringLiteral("100000"));
+    parser.addOption(iterationsOption);
+
+    QCommandLineOption actionsOption(QStringList() << QStringLiteral("a") << QStringLiteral("actions"),
+                                     QStringLiteral("Comma separated number of actions of each synthetic application."),
+                                     QStringLiteral("list"),
+                                     QStringLiteral("10,100,1000,10000"));
+    parser.addOption(actionsOption);
+
+    parser.process(app);
+
+    const int iterations = parser.value(iterationsOption).toInt();
+    if (iterations <= 0) {
+        fprintf(stderr, "Invalid number of iterations\n");
+        return 1;
+    }
+
+    int misses = 0;
+    const QStringList actionsList = parser.value(actionsOption).split(QLatin1Char(','), QString::SkipEmptyParts);
+    Q_FOREACH (const QString &actionsValue, actionsList) {
+        int controllers = actionsValue.toInt() / BENCH_ACTIONS_PER_CONTROLLER;
+        if (controllers <= 0 || controllers > BENCH_CONTROLLERS) {
+            fprintf(stderr, "Number of actions must be between %d and %d\n",
+                    BENCH_ACTIONS_PER_CONTROLLER, BENCH_CONTROLLERS * BENCH_ACTIONS_PER_CONTROLLER);
+            return 1;
+        }
+
+        // The engine takes ownership of the application
+        BenchEngine *engine = new BenchEngine;
+        BenchApplication *benchApp = new BenchApplication(controllers, iterations);
+        if (!engine->initApplication(benchApp, false)) {
+            fprintf(stderr, "Failed to setup the application\n");
+            return 1;
+        }
+
+        benchApp->run(engine);
+        misses += benchApp->misses();
+
+        delete engine;
+    }
+
+    if (misses) {
+        // Numbers are meaningless if routes didn't match
+        fprintf(stderr, "%d operations did not match an action\n", misses);
+        return 1;
+    }
+
+    return 0;
+}
+
+#include "benchdispatcher.moc"
@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2015 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <Cutelyst/Upload>
+#include <Cutelyst/multipartformdataparser.h>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringBuilder>
+#include <QTemporaryFile>
+
+#include <cstdio>
+
+using namespace Cutelyst;
+
+#define BENCH_BOUNDARY "----CutelystBenchBoundary7MA4YWxkTrZu0gW"
+
+static qint64 parseSize(const QString &value)
+{
+    QString number = value.trimmed().toUpper();
+    qint64 multiplier = 1;
+    if (number.endsWith(QLatin1Char('K'))) {
+        multiplier = 1024;
+    } else if (number.endsWith(QLatin1Char('M'))) {
+        multiplier = 1024 * 1024;
+    } else if (number.endsWith(QLatin1Char('G'))) {
+        multiplier = 1024 * 1024 * 1024;
+    }
+    if (multiplier != 1) {
+        number.chop(1);
+    }
+
+    bool ok;
+    qint64 size = number.toLongLong(&ok);
+    return ok ? size * multiplier : -1;
+}
+
+// Writes a body with a text field and a file of fileSize bytes, the
+// file content is full of CRLFs and dashes so that the scanner can't
+// skip it easily, like on real binary uploads
+static bool writeBody(QIODevice *body, qint64 fileSize)
+{
+    body->write("--" BENCH_BOUNDARY "\r\n"
+                "Content-Disposition: form-data; name=\"description\"\r\n"
+                "\r\n"
+                "Benchmark upload\r\n"
+                "--" BENCH_BOUNDARY "\r\n"
+                "Content-Disposition: form-data; name=\"file\"; filename=\"bench.bin\"\r\n"
+                "Content-Type: application/octet-stream\r\n"
+                "\r\n");
+
+    QByteArray chunk(1024 * 1024, Qt::Uninitialized);
+    quint32 seed = 42;
+    for (int i = 0; i < chunk.size(); ++i) {
+        seed = seed * 1103515245 + 12345;
+        chunk[i] = char(seed >> 24);
+    }
+    // Near misses of the delimiter
+    for (int i = 0; i + 64 < chunk.size(); i += 4093) {
+        memcpy(chunk.data() + i, "\r\n--" BENCH_BOUNDARY, 24);
+    }
+
+    qint64 remaining = fileSize;
+    while (remaining > 0) {
+        qint64 len = qMin(remaining, qint64(chunk.size()));
+        if (body->write(chunk.constData(), len) != len) {
+            return false;
+        }
+        remaining -= len;
+    }
+
+    body->write("\r\n--" BENCH_BOUNDARY "--\r\n");
+    return body->seek(0);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("cutelyst-bench-multipart"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Measures multipart/form-data parsing, one JSON object is printed per measurement."));
+    parser.addHelpOption();
+
+    QCommandLineOption sizesOption(QStringList() << QStringLiteral("s") << QStringLiteral("sizes"),
+                                   QStringLiteral("Comma separated sizes of the uploaded file, K, M and G suffixes are allowed."),
+                                   QStringLiteral("list"),
+                                   QStringLiteral("1K,64K,1M,16M,256M,1G"));
+    parser.addOption(sizesOption);
+
+    QCommandLineOption bufferOption(QStringList() << QStringLiteral("b") << QStringLiteral("buffer-size"),
+                                    QStringLiteral("Size of the parser read buffer."),
+                                    QStringLiteral("bytes"),
+                                    QStringLiteral("65536"));
+    parser.addOption(bufferOption);
+
+    QCommandLineOption durationOption(QStringList() << QStringLiteral("d") << QStringLiteral("duration"),
+                                      QStringLiteral("Minimum time in milliseconds spent parsing each size."),
+                                      QStringLiteral("msecs"),
+                                      QStringLiteral("1000"));
+    parser.addOption(durationOption);
+
+    parser.process(app);
+
+    const int bufferSize = parser.value(bufferOption).toInt();
+    const qint64 duration = parser.value(durationOption).toLongLong();
+    if (bufferSize <= 0 || duration < 0) {
+        fprintf(stderr, "Invalid buffer size or duration\n");
+        return 1;
+    }
+
+    const QString contentType = QStringLiteral("multipart/form-data; boundary=" BENCH_BOUNDARY);
+    const QStringList sizes = parser.value(sizesOption).split(QLatin1Char(','), QString::SkipEmptyParts);
+    Q_FOREACH (const QString &sizeValue, sizes) {
+        const qint64 fileSize = parseSize(sizeValue);
+        if (fileSize < 0) {
+            fprintf(stderr, "Invalid size %s\n", qPrintable(sizeValue));
+            return 1;
+        }
+
+        // Large bodies live on disk, like uploads buffered by the engines
+        QTemporaryFile body;
+        if (!body.open() || !writeBody(&body, fileSize)) {
+            fprintf(stderr, "Failed to write a %lld bytes body\n", fileSize);
+            return 1;
+        }
+
+        quint64 iterations = 0;
+        qint64 nsecs = 0;
+        QElapsedTimer total;
+        total.start();
+        do {
+            QElapsedTimer timer;
+            timer.start();
+            const Uploads uploads = MultiPartFormDataParser::parse(&body, contentType, bufferSize);
+            nsecs += timer.nsecsElapsed();
+            ++iterations;
+
+            const bool valid = uploads.size() == 2 && uploads.at(1)->size() == fileSize;
+            qDeleteAll(uploads);
+            if (!valid) {
+                // Numbers are meaningless if the body wasn't parsed
+                fprintf(stderr, "Failed to parse a %lld bytes upload\n", fileSize);
+                return 1;
+            }
+        } while (total.elapsed() < duration);
+
+        const double nsPerOp = double(nsecs) / iterations;
+        QJsonObject obj {
+            {QStringLiteral("benchmark"), QStringLiteral("multipart")},
+            {QStringLiteral("file_size"), double(fileSize)},
+            {QStringLiteral("body_size"), double(body.size())},
+            {QStringLiteral("buffer_size"), bufferSize},
+            {QStringLiteral("iterations"), double(iterations)},
+            {QStringLiteral("ns_per_op"), nsPerOp},
+            {QStringLiteral("mb_per_sec"), nsPerOp ? (body.size() / (1024.0 * 1024.0)) / (nsPerOp / 1000000000.0) : 0}
+        };
+        fprintf(stdout, "%s\n", QJsonDocument(obj).toJson(QJsonDocument::Compact).constData());
+        fflush(stdout);
+    }
+
+    return 0;
+}
@@ -15,6 +15,8 @@
 
 #include <QMimeDatabase>
 
+#include "templatecompiler.h"
+
 #include <ostream>
 #include <utime.h>
 
@@ -527,6 +529,14 @@ int main(int argc, char *argv[])
     QCommandLineOption restart = QCommandLineOption({ "restart", "r" },
                                                     "Restarts the development server when the application file changes");
     parser.addOption(restart);
+    QCommandLineOption precompile = QCommandLineOption("precompile-templates",
+                                                       "Compiles the templates of a directory to C++ for the Precompiled view",
+                                                       "templates_dir");
+    parser.addOption(precompile);
+    QCommandLineOption output = QCommandLineOption({ "output", "o" },
+                                                   "File where the precompiled templates are written",
+                                                   "file_name");
+    parser.addOption(output);
 
     // Process the actual command line arguments given by the user
     parser.process(app);
@@ -548,6 +558,16 @@ int main(int argc, char *argv[])
             port = parser.value(serverPort).toInt();
         }
         return runServer(filename, port, parser.isSet(restart));
+    } else if (parser.isSet(precompile)) {
+        if (!parser.isSet(output)) {
+            parser.showHelp(4);
+        }
+
+        TemplateCompiler compiler(parser.value(precompile));
+        if (!compiler.compile(parser.value(output))) {
+            qDebug() << "Error:" << compiler.errorString().toLocal8Bit().data();
+            return 5;
+        }
     } else {
         parser.showHelp(1);
     }
@@ -0,0 +1,516 @@
+#include "templatecompiler.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QRegularExpression>
+#include <QStringBuilder>
+
+TemplateCompiler::TemplateCompiler(const QString &templatesDir) : m_dir(templatesDir)
+{
+}
+
+bool TemplateCompiler::compile(const QString &outputFile)
+{
+    const QDir dir(m_dir);
+    if (!dir.exists()) {
+        m_error = QLatin1String("Templates directory not found: ") % m_dir;
+        return false;
+    }
+
+    QStringList names;
+    QDirIterator it(dir.absolutePath(), QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        names.append(dir.relativeFilePath(it.next()));
+    }
+    // Keep the output stable between runs
+    names.sort();
+
+    QStringList functions;
+    for (int i = 0; i < names.size(); ++i) {
+        m_file = names.at(i);
+
+        QFile file(dir.absoluteFilePath(m_file));
+        if (!file.open(QFile::ReadOnly | QFile::Text)) {
+            m_error = m_file % QLatin1String(": ") % file.errorString();
+            return false;
+        }
+
+        QString code;
+        const QString function = QLatin1String("render_") % QString::number(i);
+        if (!compileTemplate(QString::fromUtf8(file.readAll()), function, &code)) {
+            return false;
+        }
+        functions.append(QLatin1String("// ") % m_file % QLatin1Char('\n') % code);
+    }
+
+    QString output;
+    output.append(QStringLiteral("// Generated by cutelyst --precompile-templates, do not edit\n"
+                                 "#include <Cutelyst/Plugins/precompiledtemplates.h>\n"
+                                 "#include <Cutelyst/segmentedbuffer.h>\n"
+                                 "\n"
+                                 "using namespace Cutelyst;\n"
+                                 "\n"));
+    Q_FOREACH (const QString &declaration, m_pathDeclarations) {
+        output.append(declaration % QLatin1Char('\n'));
+    }
+    output.append(QLatin1Char('\n'));
+    Q_FOREACH (const QString &function, functions) {
+        output.append(function % QLatin1Char('\n'));
+    }
+
+    output.append(QStringLiteral("namespace {\n"
+                                 "struct Registration\n"
+                                 "{\n"
+                                 "    Registration()\n"
+                                 "    {\n"));
+    for (int i = 0; i < names.size(); ++i) {
+        output.append(QLatin1String("        PrecompiledTemplates::registerTemplate(QStringLiteral(")
+                      % cString(names.at(i).toUtf8())
+                      % QLatin1String("), render_") % QString::number(i) % QLatin1String(");\n"));
+    }
+    output.append(QStringLiteral("    }\n"
+                                 "};\n"
+                                 "}\n"
+                                 "\n"
+                                 "static Registration registration;\n"));
+
+    const QByteArray data = output.toUtf8();
+
+    // Don't rebuild the application when nothing changed
+    QFile out(outputFile);
+    if (out.open(QFile::ReadOnly) && out.readAll() == data) {
+        return true;
+    }
+    out.close();
+
+    if (!out.open(QFile::WriteOnly | QFile::Truncate) || out.write(data) != data.size()) {
+        m_error = outputFile % QLatin1String(": ") % out.errorString();
+        return false;
+    }
+    return true;
+}
+
+QString TemplateCompiler::errorString() const
+{
+    return m_error;
+}
+
+bool TemplateCompiler::tokenize(const QString &source, QList<Token> *tokens)
+{
+    static const QRegularExpression open(QStringLiteral("\\{[{%#]"));
+
+    int line = 1;
+    int pos = 0;
+    while (pos < source.size()) {
+        const QRegularExpressionMatch match = open.match(source, pos);
+        const int start = match.hasMatch() ? match.capturedStart() : source.size();
+        if (start > pos) {
+            const QString text = source.mid(pos, start - pos);
+            tokens->append({ Token::Text, text, line });
+            line += text.count(QLatin1Char('\n'));
+        }
+
+        if (!match.hasMatch()) {
+            break;
+        }
+
+        const QChar type = source.at(start + 1);
+        const QString close = (type == QLatin1Char('{') ? QStringLiteral("}") : QString(type)) % QLatin1Char('}');
+        const int end = source.indexOf(close, start + 2);
+        if (end == -1) {
+            setError(line, QStringLiteral("unclosed tag"));
+            return false;
+        }
+
+        const QString content = source.mid(start + 2, end - start - 2);
+        if (type == QLatin1Char('{')) {
+            tokens->append({ Token::Variable, content.trimmed(), line });
+        } else if (type == QLatin1Char('%')) {
+            tokens->append({ Token::Block, content.trimmed(), line });
+        } else {
+            tokens->append({ Token::Comment, QString(), line });
+        }
+        line += content.count(QLatin1Char('\n'));
+        pos = end + 2;
+    }
+    return true;
+}
+
+bool TemplateCompiler::compileTemplate(const QString &source, const QString &function, QString *code)
+{
+    QList<Token> tokens;
+    if (!tokenize(source, &tokens)) {
+        return false;
+    }
+
+    m_code.clear();
+    m_blocks.clear();
+    m_loops = 0;
+    m_indent = 0;
+
+    writeLine(QLatin1String("static void ") % function
+         % QLatin1String("(PrecompiledTemplates::Scope &scope, SegmentedBuffer *out)"));
+    writeLine(QStringLiteral("{"));
+    ++m_indent;
+    writeLine(QStringLiteral("Q_UNUSED(scope)"));
+    writeLine(QStringLiteral("Q_UNUSED(out)"));
+
+    for (int i = 0; i < tokens.size(); ++i) {
+        const Token &token = tokens.at(i);
+        switch (token.type) {
+        case Token::Text:
+        {
+            const QByteArray data = token.content.toUtf8();
+            writeLine(QLatin1String("out->append(") % cString(data)
+                 % QLatin1String(", ") % QString::number(data.size()) % QLatin1String(");"));
+            break;
+        }
+        case Token::Variable:
+            if (!compileVariable(token)) {
+                return false;
+            }
+            break;
+        case Token::Block:
+            if (!compileTag(token, tokens, &i)) {
+                return false;
+            }
+            break;
+        case Token::Comment:
+            break;
+        }
+    }
+
+    if (!m_blocks.isEmpty()) {
+        setError(m_blocks.last().line, QLatin1String("unclosed ") % m_blocks.last().tag);
+        return false;
+    }
+
+    --m_indent;
+    writeLine(QStringLiteral("}"));
+
+    *code = m_code;
+    return true;
+}
+
+bool TemplateCompiler::compileVariable(const Token &token)
+{
+    QStringList parts = token.content.split(QLatin1Char('|'));
+    const QString value = parts.takeFirst().trimmed();
+
+    bool escape = true;
+    Q_FOREACH (const QString &filter, parts) {
+        const QString name = filter.trimmed();
+        if (name == QLatin1String("safe")) {
+            escape = false;
+        } else if (name == QLatin1String("escape")) {
+            escape = true;
+        } else {
+            setError(token.line, QLatin1String("unsupported filter ") % name);
+            return false;
+        }
+    }
+
+    if (isStringLiteral(value)) {
+        // Literals are safe, as in Grantlee
+        const QByteArray data = value.mid(1, value.size() - 2).toUtf8();
+        writeLine(QLatin1String("out->append(") % cString(data)
+             % QLatin1String(", ") % QString::number(data.size()) % QLatin1String(");"));
+    } else if (isPath(value)) {
+        writeLine(QLatin1String("scope.write(out, ") % pathConstant(value)
+             % QLatin1String(escape ? ", true);" : ", false);"));
+    } else {
+        setError(token.line, QLatin1String("unsupported expression ") % value);
+        return false;
+    }
+    return true;
+}
+
+bool TemplateCompiler::compileTag(const Token &token, const QList<Token> &tokens, int *pos)
+{
+    QStringList args = splitArgs(token.content);
+    if (args.isEmpty()) {
+        setError(token.line, QStringLiteral("empty tag"));
+        return false;
+    }
+    const QString tag = args.takeFirst();
+
+    if (tag == QLatin1String("if")) {
+        QString condition;
+        if (!compileCondition(args, &condition)) {
+            setError(token.line, QLatin1String("unsupported condition ") % args.join(QLatin1Char(' ')));
+            return false;
+        }
+        writeLine(QLatin1String("if (") % condition % QLatin1String(") {"));
+        ++m_indent;
+        m_blocks.append({ tag, token.line, false });
+    } else if (tag == QLatin1String("else")) {
+        if (m_blocks.isEmpty() || m_blocks.last().tag != QLatin1String("if") || m_blocks.last().hasElse) {
+            setError(token.line, QStringLiteral("else outside of an if"));
+            return false;
+        }
+        m_blocks.last().hasElse = true;
+        --m_indent;
+        writeLine(QStringLiteral("} else {"));
+        ++m_indent;
+    } else if (tag == QLatin1String("endif")) {
+        if (m_blocks.isEmpty() || m_blocks.last().tag != QLatin1String("if")) {
+            setError(token.line, QStringLiteral("endif without an if"));
+            return false;
+        }
+        m_blocks.removeLast();
+        --m_indent;
+        writeLine(QStringLiteral("}"));
+    } else if (tag == QLatin1String("for")) {
+        if (args.size() != 3 || args.at(1) != QLatin1String("in") || !isPath(args.at(2))
+                || args.at(0).contains(QLatin1Char('.')) || args.at(0).contains(QLatin1Char(','))) {
+            setError(token.line, QLatin1String("unsupported for ") % args.join(QLatin1Char(' ')));
+            return false;
+        }
+
+        const int loop = m_loops++;
+        const QString list = QLatin1String("list_") % QString::number(loop);
+        const QString index = QLatin1String("i_") % QString::number(loop);
+        writeLine(QStringLiteral("{"));
+        ++m_indent;
+        writeLine(QLatin1String("const QVariantList ") % list
+             % QLatin1String(" = PrecompiledTemplates::toList(scope.value(") % pathConstant(args.at(2)) % QLatin1String("));"));
+        writeLine(QLatin1String("if (!") % list % QLatin1String(".isEmpty()) {"));
+        ++m_indent;
+        writeLine(QLatin1String("scope.beginLoop(QStringLiteral(") % cString(args.at(0).toUtf8())
+             % QLatin1String("), ") % list % QLatin1String(".size());"));
+        writeLine(QLatin1String("for (int ") % index % QLatin1String(" = 0; ") % index % QLatin1String(" < ")
+             % list % QLatin1String(".size(); ++") % index % QLatin1String(") {"));
+        ++m_indent;
+        writeLine(QLatin1String("scope.nextLoop(") % index % QLatin1String(", ") % list
+             % QLatin1String(".at(") % index % QLatin1String("));"));
+        m_blocks.append({ tag, token.line, false });
+    } else if (tag == QLatin1String("empty")) {
+        if (m_blocks.isEmpty() || m_blocks.last().tag != QLatin1String("for") || m_blocks.last().hasElse) {
+            setError(token.line, QStringLiteral("empty outside of a for"));
+            return false;
+        }
+        m_blocks.last().hasElse = true;
+        --m_indent;
+        writeLine(QStringLiteral("}"));
+        writeLine(QStringLiteral("scope.endLoop();"));
+        --m_indent;
+        writeLine(QStringLiteral("} else {"));
+        ++m_indent;
+    } else if (tag == QLatin1String("endfor")) {
+        if (m_blocks.isEmpty() || m_blocks.last().tag != QLatin1String("for")) {
+            setError(token.line, QStringLiteral("endfor without a for"));
+            return false;
+        }
+        const Block block = m_blocks.takeLast();
+        if (!block.hasElse) {
+            --m_indent;
+            writeLine(QStringLiteral("}"));
+            writeLine(QStringLiteral("scope.endLoop();"));
+        }
+        --m_indent;
+        writeLine(QStringLiteral("}"));
+        --m_indent;
+        writeLine(QStringLiteral("}"));
+    } else if (tag == QLatin1String("with")) {
+        QString path;
+        QString name;
+        if (args.size() == 3 && args.at(1) == QLatin1String("as")) {
+            path = args.at(0);
+            name = args.at(2);
+        } else if (args.size() == 1 && args.at(0).count(QLatin1Char('=')) == 1) {
+            name = args.at(0).section(QLatin1Char('='), 0, 0);
+            path = args.at(0).section(QLatin1Char('='), 1);
+        }
+
+        if (!isPath(path) || name.isEmpty() || name.contains(QLatin1Char('.')) || !isPath(name)) {
+            setError(token.line, QLatin1String("unsupported with ") % args.join(QLatin1Char(' ')));
+            return false;
+        }
+        writeLine(QStringLiteral("{"));
+        ++m_indent;
+        writeLine(QLatin1String("scope.push(QStringLiteral(") % cString(name.toUtf8())
+             % QLatin1String("), scope.value(") % pathConstant(path) % QLatin1String("));"));
+        m_blocks.append({ tag, token.line, false });
+    } else if (tag == QLatin1String("endwith")) {
+        if (m_blocks.isEmpty() || m_blocks.last().tag != QLatin1String("with")) {
+            setError(token.line, QStringLiteral("endwith without a with"));
+            return false;
+        }
+        m_blocks.removeLast();
+        writeLine(QStringLiteral("scope.pop();"));
+        --m_indent;
+        writeLine(QStringLiteral("}"));
+    } else if (tag == QLatin1String("include")) {
+        if (args.size() != 1) {
+            setError(token.line, QStringLiteral("include takes a single template name"));
+            return false;
+        }
+
+        const QString &name = args.first();
+        if (isStringLiteral(name)) {
+            writeLine(QLatin1String("PrecompiledTemplates::render(QStringLiteral(")
+                 % cString(name.mid(1, name.size() - 2).toUtf8()) % QLatin1String("), scope, out);"));
+        } else if (isPath(name)) {
+            writeLine(QLatin1String("PrecompiledTemplates::render(scope.value(") % pathConstant(name)
+                 % QLatin1String(").toString(), scope, out);"));
+        } else {
+            setError(token.line, QLatin1String("unsupported include ") % name);
+            return false;
+        }
+    } else if (tag == QLatin1String("comment")) {
+        for (++*pos; *pos < tokens.size(); ++*pos) {
+            const Token &next = tokens.at(*pos);
+            if (next.type == Token::Block && next.content == QLatin1String("endcomment")) {
+                return true;
+            }
+        }
+        setError(token.line, QStringLiteral("unclosed comment"));
+        return false;
+    } else if (tag == QLatin1String("cache")) {
+        // Rendering is cheap already, keep the content
+        writeLine(QStringLiteral("{"));
+        ++m_indent;
+        m_blocks.append({ tag, token.line, false });
+    } else if (tag == QLatin1String("endcache")) {
+        if (m_blocks.isEmpty() || m_blocks.last().tag != QLatin1String("cache")) {
+            setError(token.line, QStringLiteral("endcache without a cache"));
+            return false;
+        }
+        m_blocks.removeLast();
+        --m_indent;
+        writeLine(QStringLiteral("}"));
+    } else if (tag == QLatin1String("load")) {
+        // Tag libraries are not needed by the supported tags
+    } else {
+        setError(token.line, QLatin1String("unsupported tag ") % tag);
+        return false;
+    }
+
+    return true;
+}
+
+bool TemplateCompiler::compileCondition(const QStringList &args, QString *condition)
+{
+    // Either "and" or "or" chains, as Grantlee can't mix them
+    QString op;
+    bool negate = false;
+    bool expectOperand = true;
+    Q_FOREACH (const QString &arg, args) {
+        if (expectOperand) {
+            if (arg == QLatin1String("not")) {
+                negate = !negate;
+                continue;
+            }
+
+            if (!isPath(arg)) {
+                return false;
+            }
+            condition->append(QLatin1String(negate ? "!" : "")
+                              % QLatin1String("PrecompiledTemplates::isTrue(scope.value(")
+                              % pathConstant(arg) % QLatin1String("))"));
+            negate = false;
+            expectOperand = false;
+        } else {
+            if (arg != QLatin1String("and") && arg != QLatin1String("or")) {
+                return false;
+            }
+            if (!op.isEmpty() && op != arg) {
+                return false;
+            }
+            op = arg;
+            condition->append(QLatin1String(op == QLatin1String("and") ? " && " : " || "));
+            expectOperand = true;
+        }
+    }
+    return !expectOperand;
+}
+
+QString TemplateCompiler::pathConstant(const QString &path)
+{
+    QHash<QString, QString>::ConstIterator it = m_paths.constFind(path);
+    if (it != m_paths.constEnd()) {
+        return it.value();
+    }
+
+    const QString name = QLatin1String("v") % QString::number(m_paths.size());
+    m_paths.insert(path, name);
+    m_pathDeclarations.append(QLatin1String("static const QStringList ") % name
+                              % QLatin1String(" = PrecompiledTemplates::splitPath(QStringLiteral(")
+                              % cString(path.toUtf8()) % QLatin1String("));"));
+    return name;
+}
+
+void TemplateCompiler::writeLine(const QString &line)
+{
+    m_code.append(QString(m_indent * 4, QLatin1Char(' ')) % line % QLatin1Char('\n'));
+}
+
+void TemplateCompiler::setError(int line, const QString &message)
+{
+    m_error = m_file % QLatin1Char(':') % QString::number(line) % QLatin1String(": ") % message;
+}
+
+QStringList TemplateCompiler::splitArgs(const QString &content)
+{
+    QStringList args;
+    QString current;
+    QChar quote;
+    Q_FOREACH (const QChar &ch, content) {
+        if (!quote.isNull()) {
+            current.append(ch);
+            if (ch == quote) {
+                quote = QChar();
+            }
+        } else if (ch == QLatin1Char('"') || ch == QLatin1Char('\'')) {
+            current.append(ch);
+            quote = ch;
+        } else if (ch.isSpace()) {
+            if (!current.isEmpty()) {
+                args.append(current);
+                current.clear();
+            }
+        } else {
+            current.append(ch);
+        }
+    }
+
+    if (!current.isEmpty()) {
+        args.append(current);
+    }
+    return args;
+}
+
+bool TemplateCompiler::isPath(const QString &arg)
+{
+    static const QRegularExpression path(QStringLiteral("^[A-Za-z_]\\w*(\\.\\w+)*$"));
+    return path.match(arg).hasMatch();
+}
+
+bool TemplateCompiler::isStringLiteral(const QString &arg)
+{
+    return arg.size() >= 2
+            && (arg.startsWith(QLatin1Char('"')) || arg.startsWith(QLatin1Char('\'')))
+            && arg.endsWith(arg.at(0));
+}
+
+QString TemplateCompiler::cString(const QByteArray &data)
+{
+    QString ret(QLatin1Char('"'));
+    Q_FOREACH (const char ch, data) {
+        const uchar c = static_cast<uchar>(ch);
+        if (c == '"' || c == '\\' || c == '?') {
+            // '?' avoids trigraphs
+            ret.append(QLatin1Char('\\') % QLatin1Char(ch));
+        } else if (c == '\n') {
+            ret.append(QStringLiteral("\\n\"\n        \""));
+        } else if (c >= 0x20 && c < 0x7f) {
+            ret.append(QLatin1Char(ch));
+        } else {
+            // Always three digits so a following digit isn't consumed
+            ret.append(QLatin1Char('\\') % QString::number(c, 8).rightJustified(3, QLatin1Char('0')));
+        }
+    }
+    ret.append(QLatin1Char('"'));
+    return ret;
+}
@@ -0,0 +1,76 @@
+#ifndef TEMPLATECOMPILER_H
+#define TEMPLATECOMPILER_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+
+/**
+ * Compiles a directory of templates into C++ render
+ * functions for Cutelyst::PrecompiledTemplates.
+ *
+ * Only a subset of the Grantlee syntax is supported:
+ * variables with the safe and escape filters, if/else,
+ * for/empty, with, include, comment and cache (which is
+ * compiled as a plain block), anything else is an error
+ * and such templates should be rendered by GrantleeView.
+ */
+class TemplateCompiler
+{
+public:
+    explicit TemplateCompiler(const QString &templatesDir);
+
+    /**
+     * Writes the generated code to \p outputFile, only
+     * touching it when the content changed
+     */
+    bool compile(const QString &outputFile);
+
+    QString errorString() const;
+
+private:
+    struct Token {
+        enum Type {
+            Text,
+            Variable,
+            Block,
+            Comment
+        };
+        Type type;
+        QString content;
+        int line;
+    };
+
+    struct Block {
+        QString tag;
+        int line;
+        bool hasElse;
+    };
+
+    bool tokenize(const QString &source, QList<Token> *tokens);
+    bool compileTemplate(const QString &source, const QString &function, QString *code);
+    bool compileVariable(const Token &token);
+    bool compileTag(const Token &token, const QList<Token> &tokens, int *pos);
+    bool compileCondition(const QStringList &args, QString *condition);
+
+    QString pathConstant(const QString &path);
+    void writeLine(const QString &line);
+    void setError(int line, const QString &message);
+
+    static QStringList splitArgs(const QString &content);
+    static bool isPath(const QString &arg);
+    static bool isStringLiteral(const QString &arg);
+    static QString cString(const QByteArray &data);
+
+    QString m_dir;
+    QString m_file;
+    QString m_error;
+    QString m_code;
+    QList<Block> m_blocks;
+    int m_indent = 0;
+    int m_loops = 0;
+    QHash<QString, QString> m_paths;
+    QStringList m_pathDeclarations;
+};
+
+#endif // TEMPLATECOMPILER_H
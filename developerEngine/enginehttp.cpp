@@ -24,6 +24,7 @@
 #include <Cutelyst/request_p.h>
 #include <Cutelyst/application.h>
 #include <Cutelyst/common.h>
+#include <Cutelyst/segmentedbuffer.h>
 
 #include <QCoreApplication>
 #include <QStringList>
@@ -228,6 +229,20 @@ void EngineHttp::finalizeBody(Context *ctx, QIODevice *body)
     EngineHttpRequest *req = d->requests.value(*id);
     QTcpSocket *socket = req->m_socket;
 
+    SegmentedBuffer *segmented = qobject_cast<SegmentedBuffer *>(body);
+    if (segmented) {
+        // QTcpSocket buffers the data anyway, skip the extra copy
+        for (int i = 0; i < segmented->segmentCount(); ++i) {
+            qint64 len = segmented->segmentSize(i);
+            if (len != socket->write(segmented->segmentData(i), len)) {
+                qCWarning(CUTELYST_ENGINE_HTTP) << "Failed to write body";
+                break;
+            }
+        }
+        req->finish();
+        return;
+    }
+
     body->seek(0);
 
     char block[4096];
@@ -288,7 +303,7 @@ void EngineHttp::onNewServerConnection()
             server->blockSignals(true);
         }
 
-        EngineHttpRequest *tcpSocket = new EngineHttpRequest(socket);
+        EngineHttpRequest *tcpSocket = new EngineHttpRequest(socket, this);
         d->requests.insert(socket->socketDescriptor(), tcpSocket);
         connect(tcpSocket, &EngineHttpRequest::requestReady,
                 this, &EngineHttp::processRequest);
@@ -306,12 +321,15 @@ void EngineHttp::onNewServerConnection()
     }
 }
 
-EngineHttpRequest::EngineHttpRequest(QTcpSocket *socket) :
+EngineHttpRequest::EngineHttpRequest(QTcpSocket *socket, Engine *engine) :
     QObject(socket),
     m_socket(socket),
     m_finishedHeaders(false),
     m_processing(false),
     m_connectionId(socket->socketDescriptor()),
+    m_maxBodySize(engine->maxBodySize()),
+    m_maxHeaderSize(engine->maxHeaderSize()),
+    m_bodyBufferSize(engine->bodyBufferSize()),
     m_bufLastIndex(0)
 {
     connect(socket, &QTcpSocket::readyRead,
@@ -398,20 +416,57 @@ void EngineHttpRequest::process()
             if (!section.isEmpty()) {
                 m_headers[section.section(QLatin1Char(':'), 0, 0).toUtf8()] = section.section(QLatin1Char(':'), 1).trimmed().toUtf8();
             } else {
-                m_bodySize = m_headers.header("Content-Length").toULongLong();
+                m_bodySize = m_headers.header("Content-Length").toLongLong();
                 m_finishedHeaders = true;
+                break;
             }
         }
-    }
 
-    if (!m_finishedHeaders) {
-        return;
+        if (m_maxHeaderSize && qint64(m_finishedHeaders ? m_bufLastIndex : m_buffer.size()) > m_maxHeaderSize) {
+            reject(Response::RequestHeaderFieldsTooLarge);
+            return;
+        }
+
+        if (!m_finishedHeaders) {
+            return;
+        }
+
+        // Don't wait for a body we are not going to accept
+        if (m_maxBodySize && m_bodySize > m_maxBodySize) {
+            reject(Response::RequestEntityTooLarge);
+            return;
+        }
+
+        if (m_bodySize > m_bodyBufferSize) {
+            m_bodyFile = Engine::createBodyBuffer(this);
+        }
     }
 
-    m_body = m_buffer.mid(m_bufLastIndex, m_bodySize);
+    QIODevice *body;
+    if (m_bodyFile) {
+        // Write what arrived so far to the file to keep the memory bounded
+        qint64 len = qMin(qint64(m_buffer.size() - m_bufLastIndex), m_bodySize - m_bodyWritten);
+        if (m_bodyFile->write(m_buffer.constData() + m_bufLastIndex, len) != len) {
+            qCWarning(CUTELYST_ENGINE_HTTP) << "Failed to buffer request body" << m_bodyFile->errorString();
+            reject(Response::InternalServerError);
+            return;
+        }
+        m_bodyWritten += len;
+        m_buffer.remove(0, m_bufLastIndex + len);
+        m_bufLastIndex = 0;
+
+        if (m_bodyWritten != m_bodySize) {
+            return;
+        }
+        m_bodyFile->seek(0);
+        body = m_bodyFile;
+    } else {
+        m_body = m_buffer.mid(m_bufLastIndex, m_bodySize);
 //    qDebug() << "m_bodySize " << m_bodySize << m_body.size() << m_body;
-    if (m_bodySize != m_body.size()) {
-        return;
+        if (m_bodySize != m_body.size()) {
+            return;
+        }
+        body = new QBuffer(&m_body);
     }
 
     QUrl url;
@@ -430,14 +485,30 @@ void EngineHttpRequest::process()
                  m_method,
                  m_protocol,
                  m_headers,
-                 new QBuffer(&m_body));
+                 body);
 
+    // The request was processed synchronously
+    delete m_bodyFile;
+    m_bodyFile = 0;
+    m_bodyWritten = 0;
     m_body.clear();
     m_headers.clear();
     m_method.clear();
     m_protocol.clear();
 }
 
+void EngineHttpRequest::reject(quint16 status)
+{
+    qCDebug(CUTELYST_ENGINE_HTTP) << "Rejecting request with" << status;
+
+    m_socket->write(QByteArrayLiteral("HTTP/1.1 ") % Engine::statusCode(status) %
+                    QByteArrayLiteral("\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"));
+    // Whatever the client sends next is discarded
+    m_processing = true;
+    m_socket->disconnectFromHost();
+    deleteLater();
+}
+
 void EngineHttpRequest::timeout()
 {
     QTimer *timer = qobject_cast<QTimer*>(sender());
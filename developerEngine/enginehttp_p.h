@@ -27,6 +27,7 @@
 #include <QTcpServer>
 #include <QTcpSocket>
 #include <QTimer>
+#include <QFile>
 
 namespace Cutelyst {
 
@@ -34,7 +35,7 @@ class EngineHttpRequest : public QObject
 {
     Q_OBJECT
 public:
-    explicit EngineHttpRequest(QTcpSocket *socket);
+    EngineHttpRequest(QTcpSocket *socket, Engine *engine);
 
     int connectionId();
     bool processing();
@@ -46,6 +47,9 @@ public Q_SLOTS:
     void process();
     void timeout();
 
+private:
+    void reject(quint16 status);
+
 Q_SIGNALS:
     void requestReady(void *requestData,
                       const QUrl &url,
@@ -61,7 +65,13 @@ private:
     QVariantHash m_data;
     QByteArray m_buffer;
     QByteArray m_body;
-    int m_bodySize;
+    // Large bodies are written here instead of m_body
+    QFile *m_bodyFile = 0;
+    qint64 m_bodySize;
+    qint64 m_bodyWritten = 0;
+    qint64 m_maxBodySize;
+    int m_maxHeaderSize;
+    qint64 m_bodyBufferSize;
     quint64 m_bufLastIndex;
     QByteArray m_method;
     QString m_path;
@@ -20,17 +20,21 @@
 #include "bodybuffereduwsgi.h"
 #include "engineuwsgi.h"
 
-BodyBufferedUWSGI::BodyBufferedUWSGI(wsgi_request *request, QObject *parent) :
+BodyBufferedUWSGI::BodyBufferedUWSGI(wsgi_request *request, qint64 bufferSize, QObject *parent) :
     QIODevice(parent),
     m_request(request),
-    m_buffer(new QBuffer(this))
+    m_bufferSize(bufferSize)
 {
     open(QIODevice::ReadOnly | QIODevice::Unbuffered);
 }
 
 qint64 BodyBufferedUWSGI::pos() const
 {
-    if (!m_buffer->isOpen()) {
+    if (m_streaming) {
+        return m_streamPos;
+    }
+
+    if (!m_buffer) {
         return 0;
     }
     return m_buffer->pos();
@@ -43,7 +47,15 @@ qint64 BodyBufferedUWSGI::size() const
 
 bool BodyBufferedUWSGI::seek(qint64 off)
 {
-    if (!m_buffer->isOpen()) {
+    if (m_streaming) {
+        // What was read is gone
+        if (off != m_streamPos) {
+            return false;
+        }
+        return QIODevice::seek(off);
+    }
+
+    if (!m_buffer) {
         fillBuffer();
     }
 
@@ -56,12 +68,42 @@ bool BodyBufferedUWSGI::seek(qint64 off)
 
 void BodyBufferedUWSGI::close()
 {
-    m_buffer->close();
+    // Releases the memory or the temporary file
+    delete m_buffer;
+    m_buffer = 0;
+    m_streaming = false;
+    m_streamPos = 0;
+}
+
+bool BodyBufferedUWSGI::isStreaming() const
+{
+    return m_streaming;
+}
+
+void BodyBufferedUWSGI::setStreaming(bool enable)
+{
+    // Too late once buffered
+    if (!m_buffer) {
+        m_streaming = enable;
+    }
 }
 
 qint64 BodyBufferedUWSGI::readData(char *data, qint64 maxlen)
 {
-    if (!m_buffer->isOpen()) {
+    if (m_streaming) {
+        ssize_t body_len = 0;
+        char *body = uwsgi_request_body_read(m_request, maxlen, &body_len);
+        if (!body) {
+            return -1;
+        } else if (body == uwsgi.empty) {
+            return 0;
+        }
+        memcpy(data, body, body_len);
+        m_streamPos += body_len;
+        return body_len;
+    }
+
+    if (!m_buffer) {
         fillBuffer();
     }
     return m_buffer->read(data, maxlen);
@@ -69,7 +111,20 @@ qint64 BodyBufferedUWSGI::readData(char *data, qint64 maxlen)
 
 qint64 BodyBufferedUWSGI::readLineData(char *data, qint64 maxlen)
 {
-    if (!m_buffer->isOpen()) {
+    if (m_streaming) {
+        ssize_t body_len = 0;
+        char *body = uwsgi_request_body_readline(m_request, maxlen, &body_len);
+        if (!body) {
+            return -1;
+        } else if (body == uwsgi.empty) {
+            return 0;
+        }
+        memcpy(data, body, body_len);
+        m_streamPos += body_len;
+        return body_len;
+    }
+
+    if (!m_buffer) {
         fillBuffer();
     }
     return m_buffer->readLine(data, maxlen);
@@ -79,7 +134,7 @@ qint64 BodyBufferedUWSGI::writeData(const char *data, qint64 maxSize)
 {
     Q_UNUSED(data)
     Q_UNUSED(maxSize)
-    if (!m_buffer->isOpen()) {
+    if (!m_buffer) {
         fillBuffer();
     }
     return -1;
@@ -88,17 +143,27 @@ qint64 BodyBufferedUWSGI::writeData(const char *data, qint64 maxSize)
 void BodyBufferedUWSGI::fillBuffer() const
 {
 //    qCDebug(CUTELYST_UWSGI) << "Filling body buffer, size:" << m_request->post_cl;
-    // Truncate is needed to reset buffer's content
-    m_buffer->open(QIODevice::ReadWrite | Truncate);
+    if (qint64(m_request->post_cl) > m_bufferSize) {
+        // Large bodies don't stay in memory
+        m_buffer = Engine::createBodyBuffer(const_cast<BodyBufferedUWSGI *>(this));
+    }
+
+    if (!m_buffer) {
+        QBuffer *buffer = new QBuffer(const_cast<BodyBufferedUWSGI *>(this));
+        buffer->buffer().reserve(m_request->post_cl);
+        buffer->open(QIODevice::ReadWrite);
+        m_buffer = buffer;
+    }
 
     size_t remains = m_request->post_cl;
     while (remains > 0) {
         ssize_t body_len = 0;
-        char *body_data =  uwsgi_request_body_read(m_request, UMIN(remains, 4096) , &body_len);
+        char *body_data = uwsgi_request_body_read(m_request, UMIN(remains, 64 * 1024), &body_len);
         if (!body_data || body_data == uwsgi.empty) {
             break;
         }
         m_buffer->write(body_data, body_len);
+        remains -= body_len;
     }
     m_buffer->seek(0);
 }
@@ -29,7 +29,11 @@ class BodyBufferedUWSGI : public QIODevice
 {
     Q_OBJECT
 public:
-    explicit BodyBufferedUWSGI(struct wsgi_request *request, QObject *parent = 0);
+    /**
+     * Bodies larger than \p bufferSize are
+     * buffered on a temporary file
+     */
+    explicit BodyBufferedUWSGI(struct wsgi_request *request, qint64 bufferSize, QObject *parent = 0);
 
     virtual qint64 pos() const;
     virtual qint64 size() const;
@@ -37,6 +41,13 @@ public:
 
     virtual void close();
 
+    /**
+     * When enabled before the first read the body is read
+     * straight from the connection and can only be read once
+     */
+    bool isStreaming() const;
+    void setStreaming(bool enable);
+
 protected:
     virtual qint64 readData(char *data, qint64 maxlen);
     virtual qint64 readLineData(char *data, qint64 maxlen);
@@ -46,7 +57,10 @@ private:
     void fillBuffer() const;
 
     wsgi_request *m_request;
-    mutable QBuffer *m_buffer;
+    qint64 m_bufferSize;
+    mutable QIODevice *m_buffer = 0;
+    qint64 m_streamPos = 0;
+    bool m_streaming = false;
 };
 
 #endif // BODYBUFFEREDUWSGI_H
@@ -24,12 +24,16 @@
 
 #include <QtCore/QSocketNotifier>
 #include <QtCore/QCoreApplication>
+#include <QtCore/QVarLengthArray>
 
 #include <Cutelyst/common.h>
 #include <Cutelyst/application.h>
 #include <Cutelyst/context.h>
 #include <Cutelyst/response.h>
 #include <Cutelyst/request_p.h>
+#include <Cutelyst/segmentedbuffer.h>
+
+#include <sys/uio.h>
 
 Q_LOGGING_CATEGORY(CUTELYST_UWSGI, "cutelyst.uwsgi")
 
@@ -72,6 +76,36 @@ qint64 uWSGI::doWrite(Context *c, const char *data, qint64 len, void *engineData
     return len;
 }
 
+qint64 uWSGI::doWriteSegments(Context *c, const SegmentedBuffer *buffer, void *engineData)
+{
+    Q_UNUSED(c)
+    // Send the segments in batches without flattening them
+    QVarLengthArray<struct iovec, 64> iov;
+    qint64 written = 0;
+    int i = 0;
+    const int count = buffer->segmentCount();
+    while (i < count) {
+        iov.clear();
+        qint64 len = 0;
+        for (; i < count && iov.size() < 64; ++i) {
+            struct iovec vec;
+            vec.iov_base = const_cast<char *>(buffer->segmentData(i));
+            vec.iov_len = buffer->segmentSize(i);
+            iov.append(vec);
+            len += vec.iov_len;
+        }
+
+        if (uwsgi_response_writev_body_do(static_cast<wsgi_request*>(engineData),
+                                          iov.data(),
+                                          iov.size()) != UWSGI_OK) {
+            qCWarning(CUTELYST_UWSGI) << "Failed to write body";
+            return -1;
+        }
+        written += len;
+    }
+    return written;
+}
+
 void uWSGI::readRequestUWSGI(wsgi_request *wsgi_req)
 {
     for(;;) {
@@ -112,6 +146,18 @@ end:
 
 void uWSGI::processRequest(wsgi_request *req)
 {
+    // Reject requests over the limits before
+    // reading the body or creating a Context
+    if (maxHeaderSize() && req->uh->pktsize > maxHeaderSize()) {
+        rejectRequest(req, Response::RequestHeaderFieldsTooLarge);
+        return;
+    }
+
+    if (maxBodySize() && qint64(req->post_cl) > maxBodySize()) {
+        rejectRequest(req, Response::RequestEntityTooLarge);
+        return;
+    }
+
     CachedRequest *cache = static_cast<CachedRequest *>(req->async_environ);
 
     RequestPrivate *priv = cache->priv;
@@ -189,6 +235,19 @@ void uWSGI::processRequest(wsgi_request *req)
     body->close();
 }
 
+void uWSGI::rejectRequest(wsgi_request *req, quint16 status)
+{
+    qCDebug(CUTELYST_UWSGI) << "Rejecting request with" << status;
+
+    QByteArray statusLine = statusCode(status);
+    if (uwsgi_response_prepare_headers(req, statusLine.data(), statusLine.size()) ||
+            uwsgi_response_add_content_length(req, 0) ||
+            uwsgi_response_add_connection_close(req)) {
+        return;
+    }
+    uwsgi_response_write_headers_do(req);
+}
+
 void uWSGI::reload()
 {
     qCDebug(CUTELYST_UWSGI) << "Reloading application due application request";
@@ -205,7 +264,7 @@ void uWSGI::addUnusedRequest(wsgi_request *wsgi_req)
     cache = new CachedRequest;
     cache->bodyFile = new QFile(this);
     cache->bodyUWSGI = new BodyUWSGI(wsgi_req, this);
-    cache->bodyBufferedUWSGI = new BodyBufferedUWSGI(wsgi_req, this);
+    cache->bodyBufferedUWSGI = new BodyBufferedUWSGI(wsgi_req, bodyBufferSize(), this);
     cache->priv = new RequestPrivate;
     cache->priv->engine = this;
     cache->priv->requestPtr = wsgi_req;
@@ -285,6 +344,17 @@ quint64 uWSGI::time()
     return uwsgi_micros();
 }
 
+bool uWSGI::streamBody(QIODevice *body)
+{
+    // Only the body uWSGI didn't buffer comes from the connection
+    BodyBufferedUWSGI *buffered = qobject_cast<BodyBufferedUWSGI *>(body);
+    if (buffered) {
+        buffered->setStreaming(true);
+        return buffered->isStreaming();
+    }
+    return false;
+}
+
 bool uWSGI::finalizeHeaders(Context *ctx)
 {
     struct wsgi_request *wsgi_req = static_cast<wsgi_request*>(ctx->request()->engineData());
@@ -51,10 +51,16 @@ public:
 
     virtual qint64 doWrite(Context *c, const char *data, qint64 len, void *engineData) Q_DECL_FINAL;
 
+    virtual qint64 doWriteSegments(Context *c, const SegmentedBuffer *buffer, void *engineData) Q_DECL_FINAL;
+
+    virtual bool streamBody(QIODevice *body) Q_DECL_FINAL;
+
     void readRequestUWSGI(wsgi_request *req);
 
     void processRequest(wsgi_request *req);
 
+    void rejectRequest(wsgi_request *req, quint16 status);
+
     virtual void reload() Q_DECL_FINAL;
 
     void addUnusedRequest(wsgi_request *wsgi_req);